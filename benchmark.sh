@@ -0,0 +1,36 @@
+#!/usr/bin/env bash
+
+# Compares a Release build against one configured with the given CMake
+# options, e.g. ./benchmark.sh -DRAK_MEMORY_SLAB=ON
+
+set -e
+
+runs=${RUNS:-5}
+
+dir=$(mktemp -d)
+trap 'rm -fr "$dir"' EXIT
+
+cmake -B "$dir/base" -DCMAKE_BUILD_TYPE=Release > /dev/null
+cmake --build "$dir/base" > /dev/null
+cmake -B "$dir/opts" -DCMAKE_BUILD_TYPE=Release "$@" > /dev/null
+cmake --build "$dir/opts" > /dev/null
+
+best_time() {
+  local best=
+  for ((i = 0; i < runs; i++)); do
+    local start=$(date +%s%N)
+    "$1" "$2" > /dev/null
+    local elapsed=$((($(date +%s%N) - start) / 1000000))
+    if [ -z "$best" ] || [ "$elapsed" -lt "$best" ]; then
+      best=$elapsed
+    fi
+  done
+  echo "$best"
+}
+
+printf "%-32s %10s %10s\n" "benchmark" "base (ms)" "opts (ms)"
+for file in benchmarks/*.rak; do
+  base=$(best_time "$dir/base/rak" "$file")
+  opts=$(best_time "$dir/opts/rak" "$file")
+  printf "%-32s %10d %10d\n" "$file" "$base" "$opts"
+done
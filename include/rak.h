@@ -11,6 +11,7 @@
 #ifndef RAK_H
 #define RAK_H
 
+#include "rak/arena.h"
 #include "rak/array.h"
 #include "rak/builtin.h"
 #include "rak/callable.h"
@@ -21,9 +22,12 @@
 #include "rak/error.h"
 #include "rak/fiber.h"
 #include "rak/function.h"
+#include "rak/gc.h"
+#include "rak/jit.h"
 #include "rak/lexer.h"
 #include "rak/memory.h"
 #include "rak/native.h"
+#include "rak/profiler.h"
 #include "rak/range.h"
 #include "rak/record.h"
 #include "rak/slice.h"
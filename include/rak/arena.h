@@ -0,0 +1,38 @@
+//
+// arena.h
+//
+// Copyright 2025 Fábio de Souza Villaça Medeiros
+//
+// This file is part of the Rak Project.
+// For detailed license information, please refer to the LICENSE file
+// located in the root directory of this project.
+//
+
+#ifndef RAK_ARENA_H
+#define RAK_ARENA_H
+
+#include "memory.h"
+
+#define RAK_ARENA_CHUNK_SIZE ((size_t) 1 << 13)
+#define RAK_ARENA_MAX_CHUNKS (64)
+#define RAK_ARENA_MAX_SIZE   ((size_t) 256)
+
+struct RakArenaChunk;
+
+typedef struct
+{
+  struct RakArenaChunk *chunks;
+  struct RakArenaChunk *spare;
+  int                   nchunks;
+} RakArena;
+
+void rak_arena_init(RakArena *arena);
+void rak_arena_deinit(RakArena *arena);
+void *rak_arena_alloc(RakArena *arena, size_t size, RakError *err);
+void rak_arena_free(void *ptr);
+RakArena *rak_arena_current(void);
+void rak_arena_set_current(RakArena *arena);
+void *rak_arena_alloc_object(size_t size, RakError *err);
+void rak_arena_free_object(void *ptr);
+
+#endif // RAK_ARENA_H
@@ -13,6 +13,8 @@
 
 #include "string.h"
 
+#define RAK_CALLABLE_STACK_RESERVE (4)
+
 typedef enum
 {
   RAK_CALLABLE_TYPE_FUNCTION,
@@ -24,6 +26,7 @@ typedef struct
   RakObject      obj;
   RakString     *name;
   int            arity;
+  int            stackSize;
   RakSlice(int)  inouts;
 } RakCallable;
 
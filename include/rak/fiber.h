@@ -11,12 +11,18 @@
 #ifndef RAK_FIBER_H
 #define RAK_FIBER_H
 
+#include "arena.h"
 #include "array.h"
 #include "closure.h"
 #include "stack.h"
 
-#define RAK_FIBER_VSTK_DEFAULT_SIZE (1024)
-#define RAK_FIBER_CSTK_DEFAULT_SIZE (128)
+#define RAK_FIBER_VSTK_DEFAULT_SIZE (64)
+#define RAK_FIBER_CSTK_DEFAULT_SIZE (8)
+#define RAK_FIBER_VSTK_MAX_SIZE     ((int) 1 << 20)
+#define RAK_FIBER_CSTK_MAX_SIZE     ((int) 1 << 18)
+#define RAK_FIBER_MAX_TRACE_FRAMES  (64)
+#define RAK_FIBER_POOL_MAX_LEN      (64)
+#define RAK_FIBER_POOL_MAX_SIZE     ((size_t) 1 << 18)
 
 typedef enum
 {
@@ -39,8 +45,11 @@ typedef struct RakFiber
   RakArray               *globals;
   RakStack(RakValue)      vstk;
   RakStack(RakCallFrame)  cstk;
+  RakArena                arena;
 } RakFiber;
 
+static inline void rak_fiber_ensure_vstk(RakFiber *fiber, int n, RakError *err);
+static inline void rak_fiber_ensure_cstk(RakFiber *fiber, RakError *err);
 static inline void rak_fiber_push(RakFiber *fiber, RakValue val, RakError *err);
 static inline void rak_fiber_push_nil(RakFiber *fiber, RakError *err);
 static inline void rak_fiber_push_bool(RakFiber *fiber, bool data, RakError *err);
@@ -63,11 +72,26 @@ void rak_fiber_deinit(RakFiber *fiber);
 RakFiber *rak_fiber_new(RakArray *globals, int vstkSize, int cstkSize,
   RakClosure *cl, uint8_t nargs, RakValue *args, RakError *err);
 void rak_fiber_free(RakFiber *fiber);
+void rak_fiber_grow_vstk(RakFiber *fiber, int n, RakError *err);
+void rak_fiber_grow_cstk(RakFiber *fiber, RakError *err);
 void rak_fiber_release(RakFiber *fiber);
 void rak_fiber_run(RakFiber *fiber, RakError *err);
 void rak_fiber_resume(RakFiber *fiber, RakError *err);
+RakFiber *rak_fiber_current(void);
 void rak_fiber_print_error(RakFiber *fiber, RakError *err);
 
+static inline void rak_fiber_ensure_vstk(RakFiber *fiber, int n, RakError *err)
+{
+  if (fiber->vstk.limit - fiber->vstk.top >= n) return;
+  rak_fiber_grow_vstk(fiber, n, err);
+}
+
+static inline void rak_fiber_ensure_cstk(RakFiber *fiber, RakError *err)
+{
+  if (!rak_stack_is_full(&fiber->cstk)) return;
+  rak_fiber_grow_cstk(fiber, err);
+}
+
 static inline void rak_fiber_push(RakFiber *fiber, RakValue val, RakError *err)
 {
   if (rak_stack_is_full(&fiber->vstk))
@@ -22,6 +22,9 @@ typedef struct RakFunction
   RakString                      *file;
   RakChunk                        chunk;
   RakSlice(struct RakFunction *)  nested;
+#ifdef RAK_JIT
+  void                           *jit;
+#endif
 } RakFunction;
 
 RakFunction *rak_function_new(RakString *name, int arity, RakString *file,
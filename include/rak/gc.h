@@ -0,0 +1,73 @@
+//
+// gc.h
+//
+// Copyright 2025 Fábio de Souza Villaça Medeiros
+//
+// This file is part of the Rak Project.
+// For detailed license information, please refer to the LICENSE file
+// located in the root directory of this project.
+//
+
+#ifndef RAK_GC_H
+#define RAK_GC_H
+
+#include "value.h"
+
+#define RAK_GC_THRESHOLD  ((int) 1 << 12)
+#define RAK_GC_STEP_ROOTS ((int) 1 << 10)
+#define RAK_GC_DRAIN_SIZE ((int) 1 << 8)
+
+#ifdef RAK_CYCLE_COLLECTOR
+
+#define rak_gc_possible_root(v) rak_gc_add_root(v)
+
+#define rak_gc_forget(o) \
+  do { \
+    if ((o)->root) rak_gc_remove_root(o); \
+  } while (0)
+
+#else
+
+#define rak_gc_possible_root(v) ((void) 0)
+#define rak_gc_forget(o)        ((void) 0)
+
+#endif
+
+#ifdef RAK_DEFERRED_FREE
+
+#define rak_gc_deferred(v) rak_gc_defer_free(v)
+#define rak_gc_flush()     rak_gc_drain(-1)
+
+#else
+
+#define rak_gc_deferred(v) (false)
+#define rak_gc_flush()     ((void) 0)
+
+#endif
+
+#if defined(RAK_CYCLE_COLLECTOR) || defined(RAK_DEFERRED_FREE)
+  #define rak_gc_safe_point() rak_gc_poll()
+#else
+  #define rak_gc_safe_point() ((void) 0)
+#endif
+
+typedef struct
+{
+  uint64_t collections;
+  uint64_t roots;
+  uint64_t scanned;
+  uint64_t freed;
+  uint64_t deferred;
+} RakGcStats;
+
+void rak_gc_make_immortal(RakValue *val);
+void rak_gc_add_root(RakValue val);
+void rak_gc_remove_root(RakObject *obj);
+bool rak_gc_defer_free(RakValue val);
+void rak_gc_drain(int n);
+void rak_gc_poll(void);
+int rak_gc_collect(void);
+RakGcStats rak_gc_stats(void);
+void rak_gc_print_stats(void);
+
+#endif // RAK_GC_H
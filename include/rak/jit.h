@@ -0,0 +1,20 @@
+//
+// jit.h
+//
+// Copyright 2025 Fábio de Souza Villaça Medeiros
+//
+// This file is part of the Rak Project.
+// For detailed license information, please refer to the LICENSE file
+// located in the root directory of this project.
+//
+
+#ifndef RAK_JIT_H
+#define RAK_JIT_H
+
+#include "fiber.h"
+
+void rak_jit_enable(void);
+bool rak_jit_dispatch(RakFiber *fiber, RakClosure *cl, uint32_t *ip, RakValue *slots, RakError *err);
+void rak_jit_free(void *code);
+
+#endif // RAK_JIT_H
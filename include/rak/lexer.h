@@ -84,6 +84,7 @@ typedef struct
   int        ln;
   int        col;
   RakToken   tok;
+  int        prevLn;
 } RakLexer;
 
 const char *rak_token_kind_to_cstr(RakTokenKind kind);
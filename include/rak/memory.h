@@ -12,10 +12,23 @@
 #define RAK_MEMORY_H
 
 #include <stddef.h>
-#include "error.h"
+#include "value.h"
+
+typedef struct
+{
+  size_t   live;
+  size_t   peak;
+  size_t   limit;
+  uint64_t allocs;
+  uint64_t frees;
+  int64_t  objects[RAK_TYPE_COUNT];
+} RakMemoryStats;
 
 void *rak_memory_alloc(size_t size, RakError *err);
 void *rak_memory_realloc(void *ptr, size_t size, RakError *err);
 void rak_memory_free(void *ptr);
+void rak_memory_set_limit(size_t limit);
+void rak_memory_track_object(RakType type, int delta);
+RakMemoryStats rak_memory_stats(void);
 
 #endif // RAK_MEMORY_H
@@ -0,0 +1,21 @@
+//
+// number.h
+//
+// Copyright 2025 Fábio de Souza Villaça Medeiros
+//
+// This file is part of the Rak Project.
+// For detailed license information, please refer to the LICENSE file
+// located in the root directory of this project.
+//
+
+#ifndef RAK_NUMBER_H
+#define RAK_NUMBER_H
+
+#include <stdbool.h>
+
+#define RAK_NUMBER_MAX_CHARS ((int) 32)
+
+int rak_number_format(double num, char *buf);
+bool rak_number_parse(int len, const char *chars, double *num);
+
+#endif // RAK_NUMBER_H
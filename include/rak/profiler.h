@@ -0,0 +1,26 @@
+//
+// profiler.h
+//
+// Copyright 2025 Fábio de Souza Villaça Medeiros
+//
+// This file is part of the Rak Project.
+// For detailed license information, please refer to the LICENSE file
+// located in the root directory of this project.
+//
+
+#ifndef RAK_PROFILER_H
+#define RAK_PROFILER_H
+
+#include "fiber.h"
+
+#define RAK_PROFILER_INTERVAL   (1000)
+#define RAK_PROFILER_MAX_DEPTH  (64)
+#define RAK_PROFILER_MAX_STACKS ((int) 1 << 14)
+#define RAK_PROFILER_MAX_FRAMES ((int) 1 << 18)
+
+void rak_profiler_start(const char *path, RakError *err);
+void rak_profiler_stop(RakClosure *cl, RakArray *globals, RakError *err);
+void rak_line_profiler_start(RakError *err);
+void rak_line_profiler_stop(RakError *err);
+
+#endif // RAK_PROFILER_H
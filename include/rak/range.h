@@ -33,5 +33,37 @@ void rak_range_release(RakRange *range);
 void rak_range_inplace_set(RakRange *range, double start, double end);
 bool rak_range_equals(RakRange *range1, RakRange *range2);
 void rak_range_print(RakRange *range);
+RakValue rak_range_value_new(double start, double end, RakError *err);
+void rak_range_value_print(RakValue val);
+
+static inline double rak_range_value_start(RakValue val);
+static inline double rak_range_value_end(RakValue val);
+static inline double rak_range_value_len(RakValue val);
+static inline bool rak_range_value_equals(RakValue val1, RakValue val2);
+
+static inline double rak_range_value_start(RakValue val)
+{
+  if (rak_range_is_immediate(val)) return rak_range_immediate_start(val);
+  return rak_as_range(val)->start;
+}
+
+static inline double rak_range_value_end(RakValue val)
+{
+  if (rak_range_is_immediate(val)) return rak_range_immediate_end(val);
+  return rak_as_range(val)->end;
+}
+
+static inline double rak_range_value_len(RakValue val)
+{
+  double start = rak_range_value_start(val);
+  double end = rak_range_value_end(val);
+  return start < end ? end - start : 0;
+}
+
+static inline bool rak_range_value_equals(RakValue val1, RakValue val2)
+{
+  return rak_range_value_start(val1) == rak_range_value_start(val2)
+    && rak_range_value_end(val1) == rak_range_value_end(val2);
+}
 
 #endif // RAK_RANGE_H
@@ -19,6 +19,15 @@
 #define rak_record_is_empty(r) (!rak_record_len(r))
 #define rak_record_get(r, i)   rak_slice_get(&(r)->slice, (i))
 
+typedef struct RakShape
+{
+  RakObject                   obj;
+  struct RakShape            *parent;
+  RakString                  *name;
+  int                         len;
+  RakSlice(struct RakShape *) children;
+} RakShape;
+
 typedef struct
 {
   RakString *name;
@@ -28,9 +37,15 @@ typedef struct
 typedef struct
 {
   RakObject                obj;
+  RakShape                *shape;
   RakSlice(RakRecordField) slice;
 } RakRecord;
 
+RakShape *rak_shape_root(void);
+RakShape *rak_shape_transition(RakShape *shape, RakString *name, RakError *err);
+void rak_shape_free(RakShape *shape);
+void rak_shape_release(RakShape *shape);
+
 void rak_record_init(RakRecord *rec, RakError *err);
 void rak_record_init_with_capacity(RakRecord *rec, int cap, RakError *err);
 void rak_record_init_copy(RakRecord *rec1, RakRecord *rec2, RakError *err);
@@ -45,9 +60,10 @@ int rak_record_index_of(RakRecord *rec, RakString *name);
 RakRecord *rak_record_put(RakRecord *rec, RakString *name, RakValue val, RakError *err);
 RakRecord *rak_record_set(RakRecord *rec, int idx, RakValue val, RakError *err);
 RakRecord *rak_record_remove_at(RakRecord *rec, int idx, RakError *err);
+void rak_record_inplace_append(RakRecord *rec, RakRecordField field, RakError *err);
 void rak_record_inplace_put(RakRecord *rec, RakString *name, RakValue val, RakError *err);
 void rak_record_inplace_set(RakRecord *rec, int idx, RakValue val);
-void rak_record_inplace_remove_at(RakRecord *rec, int idx);
+void rak_record_inplace_remove_at(RakRecord *rec, int idx, RakError *err);
 void rak_record_inplace_clear(RakRecord *rec);
 bool rak_record_equals(RakRecord *rec1, RakRecord *rec2);
 void rak_record_print(RakRecord *rec);
@@ -0,0 +1,16 @@
+//
+// search.h
+//
+// Copyright 2025 Fábio de Souza Villaça Medeiros
+//
+// This file is part of the Rak Project.
+// For detailed license information, please refer to the LICENSE file
+// located in the root directory of this project.
+//
+
+#ifndef RAK_SEARCH_H
+#define RAK_SEARCH_H
+
+int rak_search_find(int len, const char *chars, int nlen, const char *needle);
+
+#endif // RAK_SEARCH_H
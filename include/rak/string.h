@@ -14,16 +14,25 @@
 #include "slice.h"
 #include "value.h"
 
+#define RAK_STRING_INLINE_CAPACITY ((int) 24)
+#define RAK_STRING_VIEW_RATIO      ((int) 8)
+
 #define rak_string_cap(s)      ((s)->slice.cap)
 #define rak_string_len(s)      ((s)->slice.len)
 #define rak_string_chars(s)    ((s)->slice.data)
 #define rak_string_is_empty(s) (!rak_string_len(s))
 #define rak_string_get(s, i)   rak_slice_get(&(s)->slice, (i))
+#define rak_string_is_inline(s) ((s)->slice.data == (s)->buf)
+#define rak_string_is_view(s)   ((s)->parent != NULL)
 
-typedef struct
+typedef struct RakString
 {
-  RakObject      obj;
-  RakSlice(char) slice;
+  RakObject          obj;
+  uint32_t           hash;
+  bool               interned;
+  struct RakString  *parent;
+  RakSlice(char)     slice;
+  char               buf[RAK_STRING_INLINE_CAPACITY];
 } RakString;
 
 void rak_string_init(RakString *str, RakError *err);
@@ -47,7 +56,12 @@ void rak_string_inplace_append_cstr(RakString *str, int len, const char *cstr, R
 void rak_string_inplace_concat(RakString *str1, RakString *str2, RakError *err);
 void rak_string_inplace_slice(RakString *str, int start, int end, RakError *err);
 void rak_string_inplace_clear(RakString *str);
+uint32_t rak_string_hash(RakString *str);
+RakString *rak_string_intern(RakString *str, RakError *err);
 bool rak_string_equals(RakString *str1, RakString *str2);
+int rak_string_find(RakString *str, RakString *sub, int start);
+int rak_string_count(RakString *str, RakString *sub);
+RakString *rak_string_replace(RakString *str, RakString *sub, RakString *rep, RakError *err);
 int rak_string_compare(RakString *str1, RakString *str2);
 void rak_string_print(RakString *str);
 
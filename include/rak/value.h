@@ -14,14 +14,92 @@
 #include <stdint.h>
 #include "error.h"
 
-#define RAK_FLAG_FALSY  (1 << 0)
-#define RAK_FLAG_OBJECT (1 << 1)
-#define RAK_FLAG_SHARED (1 << 2)
-
 #define RAK_NUMBER_EPSILON (1e-9)
 #define RAK_INTEGER_MIN    (-9007199254740992LL)
 #define RAK_INTEGER_MAX    (9007199254740992LL)
 
+#ifdef RAK_NAN_BOXING
+
+#if UINTPTR_MAX != UINT64_MAX
+  #error "NaN boxing requires 64-bit pointers"
+#endif
+
+#define RAK_NAN_BOXING_QNAN       (0x7ff8000000000000ULL)
+#define RAK_NAN_BOXING_TAGGED     (0xfff1000000000000ULL)
+#define RAK_NAN_BOXING_TAG_MASK   (0xffff000000000000ULL)
+#define RAK_NAN_BOXING_PTR_MASK   (0x0000fffffffffff8ULL)
+#define RAK_NAN_BOXING_SHARED     (1ULL)
+#define RAK_NAN_BOXING_IMMORTAL   (2ULL)
+#define RAK_NAN_BOXING_IMMEDIATE  (1ULL << 47)
+#define RAK_NAN_BOXING_BOUND      (1ULL << 22)
+#define RAK_NAN_BOXING_BOUND_MASK ((1ULL << 23) - 1)
+
+#define RAK_RANGE_IMMEDIATE_MIN (-(int64_t) RAK_NAN_BOXING_BOUND)
+#define RAK_RANGE_IMMEDIATE_MAX ((int64_t) RAK_NAN_BOXING_BOUND - 1)
+
+#define rak_nan_boxing_tag(t) (0xfff0000000000000ULL | (((uint64_t) (t) + 1) << 48))
+
+#define rak_nil_value()      ((RakValue) { .bits = rak_nan_boxing_tag(RAK_TYPE_NIL) })
+#define rak_bool_value(d)    ((RakValue) { .bits = rak_nan_boxing_tag(RAK_TYPE_BOOL) | ((d) ? 1 : 0) })
+#define rak_number_value(d)  rak_nan_boxing_box_number(d)
+#define rak_string_value(p)  ((RakValue) { .bits = rak_nan_boxing_tag(RAK_TYPE_STRING) | (uintptr_t) (p) })
+#define rak_array_value(p)   ((RakValue) { .bits = rak_nan_boxing_tag(RAK_TYPE_ARRAY) | (uintptr_t) (p) })
+#define rak_range_value(p)   ((RakValue) { .bits = rak_nan_boxing_tag(RAK_TYPE_RANGE) | (uintptr_t) (p) })
+#define rak_record_value(p)  ((RakValue) { .bits = rak_nan_boxing_tag(RAK_TYPE_RECORD) | (uintptr_t) (p) })
+#define rak_closure_value(p) ((RakValue) { .bits = rak_nan_boxing_tag(RAK_TYPE_CLOSURE) | (uintptr_t) (p) })
+#define rak_fiber_value(p)   ((RakValue) { .bits = rak_nan_boxing_tag(RAK_TYPE_FIBER) | (uintptr_t) (p) })
+#define rak_ref_value(p)     ((RakValue) { .bits = rak_nan_boxing_tag(RAK_TYPE_REF) | (uintptr_t) (p) })
+
+// Pointers never have bit 47 set in user space, so it marks a range whose bounds are
+// packed into the payload instead of pointing to a RakRange.
+#define rak_range_immediate_value(s, e) ((RakValue) { .bits = rak_nan_boxing_tag(RAK_TYPE_RANGE) \
+  | RAK_NAN_BOXING_IMMEDIATE | (((uint64_t) (s) & RAK_NAN_BOXING_BOUND_MASK) << 23) \
+  | ((uint64_t) (e) & RAK_NAN_BOXING_BOUND_MASK) })
+
+#define rak_range_is_immediate(v)    ((bool) ((v).bits & RAK_NAN_BOXING_IMMEDIATE))
+#define rak_range_immediate_start(v) rak_nan_boxing_unpack_bound((v).bits >> 23)
+#define rak_range_immediate_end(v)   rak_nan_boxing_unpack_bound((v).bits)
+
+#define rak_nan_boxing_unpack_bound(b) ((int32_t) (((b) & RAK_NAN_BOXING_BOUND_MASK) \
+  ^ RAK_NAN_BOXING_BOUND) - (int32_t) RAK_NAN_BOXING_BOUND)
+
+#define rak_type_of(v) ((v).bits < RAK_NAN_BOXING_TAGGED ? RAK_TYPE_NUMBER \
+  : (RakType) ((((v).bits >> 48) & 0xf) - 1))
+
+#define rak_as_bool(v)    ((bool) ((v).bits & 1))
+#define rak_as_number(v)  rak_nan_boxing_unbox_number(v)
+#define rak_as_ptr(v)     ((void *) (uintptr_t) ((v).bits & RAK_NAN_BOXING_PTR_MASK))
+
+#define rak_is_tagged(v, t) (((v).bits & RAK_NAN_BOXING_TAG_MASK) == rak_nan_boxing_tag(t))
+
+#define rak_is_nil(v)     ((v).bits == rak_nan_boxing_tag(RAK_TYPE_NIL))
+#define rak_is_bool(v)    rak_is_tagged(v, RAK_TYPE_BOOL)
+#define rak_is_number(v)  ((v).bits < RAK_NAN_BOXING_TAGGED)
+#define rak_is_string(v)  rak_is_tagged(v, RAK_TYPE_STRING)
+#define rak_is_array(v)   rak_is_tagged(v, RAK_TYPE_ARRAY)
+#define rak_is_range(v)   rak_is_tagged(v, RAK_TYPE_RANGE)
+#define rak_is_record(v)  rak_is_tagged(v, RAK_TYPE_RECORD)
+#define rak_is_closure(v) rak_is_tagged(v, RAK_TYPE_CLOSURE)
+#define rak_is_fiber(v)   rak_is_tagged(v, RAK_TYPE_FIBER)
+#define rak_is_ref(v)     rak_is_tagged(v, RAK_TYPE_REF)
+#define rak_is_falsy(v)   ((v).bits == rak_nan_boxing_tag(RAK_TYPE_NIL) \
+  || (v).bits == rak_nan_boxing_tag(RAK_TYPE_BOOL))
+#define rak_is_object(v)  ((v).bits >= rak_nan_boxing_tag(RAK_TYPE_STRING) \
+  && (v).bits < rak_nan_boxing_tag(RAK_TYPE_REF) && !((v).bits & RAK_NAN_BOXING_IMMEDIATE))
+#define rak_is_shared(v)  (rak_is_object(v) && ((v).bits & RAK_NAN_BOXING_SHARED))
+#define rak_is_immortal(v) (rak_is_object(v) && ((v).bits & RAK_NAN_BOXING_IMMORTAL))
+#define rak_is_refcounted(v) (rak_is_object(v) && !((v).bits & RAK_NAN_BOXING_IMMORTAL))
+
+#define rak_set_shared(v)   ((v).bits |= rak_is_object(v) ? RAK_NAN_BOXING_SHARED : 0)
+#define rak_set_immortal(v) ((v).bits |= rak_is_object(v) ? RAK_NAN_BOXING_IMMORTAL : 0)
+
+#else
+
+#define RAK_FLAG_FALSY    (1 << 0)
+#define RAK_FLAG_OBJECT   (1 << 1)
+#define RAK_FLAG_SHARED   (1 << 2)
+#define RAK_FLAG_IMMORTAL (1 << 3)
+
 #define rak_nil_value()      ((RakValue) { .type = RAK_TYPE_NIL, .flags = RAK_FLAG_FALSY })
 #define rak_bool_value(d)    ((RakValue) { .type = RAK_TYPE_BOOL, .flags = (d) ? 0 : RAK_FLAG_FALSY, .opaque.b = (d) })
 #define rak_number_value(d)  ((RakValue) { .type = RAK_TYPE_NUMBER, .flags = 0, .opaque.f64 = (d) })
@@ -33,22 +111,25 @@
 #define rak_fiber_value(p)   ((RakValue) { .type = RAK_TYPE_FIBER, .flags = RAK_FLAG_OBJECT, .opaque.ptr = (p) })
 #define rak_ref_value(p)     ((RakValue) { .type = RAK_TYPE_REF, .flags = 0, .opaque.ptr = (p) })
 
+#define RAK_RANGE_IMMEDIATE_MIN ((int64_t) INT32_MIN)
+#define RAK_RANGE_IMMEDIATE_MAX ((int64_t) INT32_MAX)
+
+#define rak_range_immediate_value(s, e) ((RakValue) { .type = RAK_TYPE_RANGE, .flags = 0, \
+  .opaque.bounds = { (int32_t) (s), (int32_t) (e) } })
+
+#define rak_range_is_immediate(v)    (!((v).flags & RAK_FLAG_OBJECT))
+#define rak_range_immediate_start(v) ((v).opaque.bounds[0])
+#define rak_range_immediate_end(v)   ((v).opaque.bounds[1])
+
+#define rak_type_of(v) ((v).type)
+
 #define rak_as_bool(v)    ((v).opaque.b)
 #define rak_as_number(v)  ((v).opaque.f64)
-#define rak_as_integer(v) ((int64_t) rak_as_number(v))
-#define rak_as_string(v)  ((RakString *) (v).opaque.ptr)
-#define rak_as_array(v)   ((RakArray *) (v).opaque.ptr)
-#define rak_as_range(v)   ((RakRange *) (v).opaque.ptr)
-#define rak_as_record(v)  ((RakRecord *) (v).opaque.ptr)
-#define rak_as_closure(v) ((RakClosure *) (v).opaque.ptr)
-#define rak_as_fiber(v)   ((RakFiber *) (v).opaque.ptr)
-#define rak_as_ref(v)     ((RakValue *) (v).opaque.ptr)
-#define rak_as_object(v)  ((RakObject *) (v).opaque.ptr)
+#define rak_as_ptr(v)     ((v).opaque.ptr)
 
 #define rak_is_nil(v)     ((v).type == RAK_TYPE_NIL)
 #define rak_is_bool(v)    ((v).type == RAK_TYPE_BOOL)
 #define rak_is_number(v)  ((v).type == RAK_TYPE_NUMBER)
-#define rak_is_integer(v) (rak_as_number(v) == rak_as_integer(v))
 #define rak_is_string(v)  ((v).type == RAK_TYPE_STRING)
 #define rak_is_array(v)   ((v).type == RAK_TYPE_ARRAY)
 #define rak_is_range(v)   ((v).type == RAK_TYPE_RANGE)
@@ -59,12 +140,47 @@
 #define rak_is_falsy(v)   ((v).flags & RAK_FLAG_FALSY)
 #define rak_is_object(v)  ((v).flags & RAK_FLAG_OBJECT)
 #define rak_is_shared(v)  ((v).flags & RAK_FLAG_SHARED)
+#define rak_is_immortal(v) ((v).flags & RAK_FLAG_IMMORTAL)
+#define rak_is_refcounted(v) (((v).flags & (RAK_FLAG_OBJECT | RAK_FLAG_IMMORTAL)) \
+  == RAK_FLAG_OBJECT)
+
+#define rak_set_shared(v)   ((v).flags |= RAK_FLAG_SHARED)
+#define rak_set_immortal(v) ((v).flags |= rak_is_object(v) ? RAK_FLAG_IMMORTAL : 0)
+
+#endif
+
+#define rak_as_integer(v) ((int64_t) rak_as_number(v))
+#define rak_as_string(v)  ((RakString *) rak_as_ptr(v))
+#define rak_as_array(v)   ((RakArray *) rak_as_ptr(v))
+#define rak_as_range(v)   ((RakRange *) rak_as_ptr(v))
+#define rak_as_record(v)  ((RakRecord *) rak_as_ptr(v))
+#define rak_as_closure(v) ((RakClosure *) rak_as_ptr(v))
+#define rak_as_fiber(v)   ((RakFiber *) rak_as_ptr(v))
+#define rak_as_ref(v)     ((RakValue *) rak_as_ptr(v))
+#define rak_as_object(v)  ((RakObject *) rak_as_ptr(v))
+
+#define rak_is_integer(v) (rak_as_number(v) == rak_as_integer(v))
+
+#define RAK_OBJECT_IMMORTAL ((int) 1 << 30)
+
+#ifdef RAK_CYCLE_COLLECTOR
 
 #define rak_object_init(o) \
   do { \
     (o)->refCount = 0; \
+    (o)->color = 0; \
+    (o)->root = 0; \
   } while (0);
 
+#else
+
+#define rak_object_init(o) \
+  do { \
+    (o)->refCount = 0; \
+  } while (0);
+
+#endif
+
 #define rak_object_retain(o) \
   do { \
     ++(o)->refCount; \
@@ -72,7 +188,7 @@
 
 #define rak_value_retain(v) \
   do { \
-    if (!rak_is_object(v)) break; \
+    if (!rak_is_refcounted(v)) break; \
     rak_object_retain(rak_as_object(v)); \
   } while (0);
 
@@ -90,11 +206,23 @@ typedef enum
   RAK_TYPE_REF
 } RakType;
 
+#define RAK_TYPE_COUNT ((int) RAK_TYPE_REF + 1)
+
+#ifdef RAK_NAN_BOXING
+
+typedef struct
+{
+  uint64_t bits;
+} RakValue;
+
+#else
+
 typedef union
 {
-  bool    b;
-  double  f64;
-  void   *ptr;
+  bool     b;
+  double   f64;
+  void    *ptr;
+  int32_t  bounds[2];
 } RakOpaque;
 
 typedef struct
@@ -104,9 +232,15 @@ typedef struct
   RakOpaque opaque;
 } RakValue;
 
+#endif
+
 typedef struct
 {
   int refCount;
+#ifdef RAK_CYCLE_COLLECTOR
+  int color;
+  int root;
+#endif
 } RakObject;
 
 const char *rak_type_to_cstr(RakType type);
@@ -118,4 +252,21 @@ bool rak_value_equals(RakValue val1, RakValue val2);
 int rak_value_compare(RakValue val1, RakValue val2, RakError *err);
 void rak_value_print(RakValue val);
 
+#ifdef RAK_NAN_BOXING
+
+static inline RakValue rak_nan_boxing_box_number(double data)
+{
+  union { double f64; uint64_t bits; } num = { .f64 = data };
+  if (data != data) num.bits = RAK_NAN_BOXING_QNAN;
+  return (RakValue) { .bits = num.bits };
+}
+
+static inline double rak_nan_boxing_unbox_number(RakValue val)
+{
+  union { uint64_t bits; double f64; } num = { .bits = val.bits };
+  return num.f64;
+}
+
+#endif
+
 #endif // RAK_VALUE_H
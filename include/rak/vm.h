@@ -14,9 +14,16 @@
 #include <math.h>
 #include "fiber.h"
 #include "function.h"
+#include "gc.h"
 #include "range.h"
 #include "record.h"
 
+#define RAK_VM_STATS_TOP (20)
+
+typedef void (*RakVmHook)(RakFiber *fiber, RakClosure *cl, uint32_t *ip, RakError *err);
+
+static inline int rak_vm_field_index(RakChunk *chunk, uint32_t instr, RakRecord *rec);
+static inline bool rak_vm_is_overwritten(RakValue val, uint32_t *ip, RakValue *slots);
 static inline void rak_vm_push_nil(RakFiber *fiber, RakClosure *cl, uint32_t *ip, RakValue *slots, RakError *err);
 static inline void rak_vm_push_false(RakFiber *fiber, RakClosure *cl, uint32_t *ip, RakValue *slots, RakError *err);
 static inline void rak_vm_push_true(RakFiber *fiber, RakClosure *cl, uint32_t *ip, RakValue *slots, RakError *err);
@@ -57,6 +64,24 @@ static inline void rak_vm_gt(RakFiber *fiber, RakClosure *cl, uint32_t *ip, RakV
 static inline void rak_vm_ge(RakFiber *fiber, RakClosure *cl, uint32_t *ip, RakValue *slots, RakError *err);
 static inline void rak_vm_lt(RakFiber *fiber, RakClosure *cl, uint32_t *ip, RakValue *slots, RakError *err);
 static inline void rak_vm_le(RakFiber *fiber, RakClosure *cl, uint32_t *ip, RakValue *slots, RakError *err);
+static inline void rak_vm_eq_locals_jump_if_false(RakFiber *fiber, RakClosure *cl, uint32_t *ip, RakValue *slots, RakError *err);
+static inline void rak_vm_eq_const_jump_if_false(RakFiber *fiber, RakClosure *cl, uint32_t *ip, RakValue *slots, RakError *err);
+static inline void rak_vm_eq_int_jump_if_false(RakFiber *fiber, RakClosure *cl, uint32_t *ip, RakValue *slots, RakError *err);
+static inline void rak_vm_ne_locals_jump_if_false(RakFiber *fiber, RakClosure *cl, uint32_t *ip, RakValue *slots, RakError *err);
+static inline void rak_vm_ne_const_jump_if_false(RakFiber *fiber, RakClosure *cl, uint32_t *ip, RakValue *slots, RakError *err);
+static inline void rak_vm_ne_int_jump_if_false(RakFiber *fiber, RakClosure *cl, uint32_t *ip, RakValue *slots, RakError *err);
+static inline void rak_vm_gt_locals_jump_if_false(RakFiber *fiber, RakClosure *cl, uint32_t *ip, RakValue *slots, RakError *err);
+static inline void rak_vm_gt_const_jump_if_false(RakFiber *fiber, RakClosure *cl, uint32_t *ip, RakValue *slots, RakError *err);
+static inline void rak_vm_gt_int_jump_if_false(RakFiber *fiber, RakClosure *cl, uint32_t *ip, RakValue *slots, RakError *err);
+static inline void rak_vm_ge_locals_jump_if_false(RakFiber *fiber, RakClosure *cl, uint32_t *ip, RakValue *slots, RakError *err);
+static inline void rak_vm_ge_const_jump_if_false(RakFiber *fiber, RakClosure *cl, uint32_t *ip, RakValue *slots, RakError *err);
+static inline void rak_vm_ge_int_jump_if_false(RakFiber *fiber, RakClosure *cl, uint32_t *ip, RakValue *slots, RakError *err);
+static inline void rak_vm_lt_locals_jump_if_false(RakFiber *fiber, RakClosure *cl, uint32_t *ip, RakValue *slots, RakError *err);
+static inline void rak_vm_lt_const_jump_if_false(RakFiber *fiber, RakClosure *cl, uint32_t *ip, RakValue *slots, RakError *err);
+static inline void rak_vm_lt_int_jump_if_false(RakFiber *fiber, RakClosure *cl, uint32_t *ip, RakValue *slots, RakError *err);
+static inline void rak_vm_le_locals_jump_if_false(RakFiber *fiber, RakClosure *cl, uint32_t *ip, RakValue *slots, RakError *err);
+static inline void rak_vm_le_const_jump_if_false(RakFiber *fiber, RakClosure *cl, uint32_t *ip, RakValue *slots, RakError *err);
+static inline void rak_vm_le_int_jump_if_false(RakFiber *fiber, RakClosure *cl, uint32_t *ip, RakValue *slots, RakError *err);
 static inline void rak_vm_add(RakFiber *fiber, RakClosure *cl, uint32_t *ip, RakValue *slots, RakError *err);
 static inline void rak_vm_add2(RakFiber *fiber, RakClosure *cl, uint32_t *ip, RakValue *slots, RakError *err);
 static inline void rak_vm_add3(RakFiber *fiber, RakClosure *cl, uint32_t *ip, RakValue *slots, RakError *err);
@@ -79,8 +104,51 @@ static inline void rak_vm_tail_call(RakFiber *fiber, RakClosure *cl, uint32_t *i
 static inline void rak_vm_yield(RakFiber *fiber, RakClosure *cl, uint32_t *ip, RakValue *slots, RakError *err);
 static inline void rak_vm_return(RakFiber *fiber, RakClosure *cl, uint32_t *ip, RakValue *slots, RakError *err);
 static inline void rak_vm_return_nil(RakFiber *fiber, RakClosure *cl, uint32_t *ip, RakValue *slots, RakError *err);
+static inline void rak_vm_eq_num(RakFiber *fiber, RakClosure *cl, uint32_t *ip, RakValue *slots, RakError *err);
+static inline void rak_vm_ne_num(RakFiber *fiber, RakClosure *cl, uint32_t *ip, RakValue *slots, RakError *err);
+static inline void rak_vm_gt_num(RakFiber *fiber, RakClosure *cl, uint32_t *ip, RakValue *slots, RakError *err);
+static inline void rak_vm_ge_num(RakFiber *fiber, RakClosure *cl, uint32_t *ip, RakValue *slots, RakError *err);
+static inline void rak_vm_lt_num(RakFiber *fiber, RakClosure *cl, uint32_t *ip, RakValue *slots, RakError *err);
+static inline void rak_vm_le_num(RakFiber *fiber, RakClosure *cl, uint32_t *ip, RakValue *slots, RakError *err);
+static inline void rak_vm_add_num(RakFiber *fiber, RakClosure *cl, uint32_t *ip, RakValue *slots, RakError *err);
+static inline void rak_vm_add2_num(RakFiber *fiber, RakClosure *cl, uint32_t *ip, RakValue *slots, RakError *err);
+static inline void rak_vm_add3_num(RakFiber *fiber, RakClosure *cl, uint32_t *ip, RakValue *slots, RakError *err);
 
 void rak_vm_dispatch(RakFiber *fiber, RakClosure *cl, uint32_t *ip, RakValue *slots, RakError *err);
+bool rak_vm_set_hook(RakVmHook hook);
+#ifdef RAK_VM_STATS
+void rak_vm_print_stats(int n);
+#endif
+
+static inline int rak_vm_field_index(RakChunk *chunk, uint32_t instr, RakRecord *rec)
+{
+  RakInlineCache *cache = &rak_slice_get(&chunk->caches, rak_instr_b(instr));
+  RakShape *shape = rec->shape;
+  if (cache->shape == shape) return cache->idx;
+  RakString *name = rak_as_string(rak_slice_get(&chunk->consts, rak_instr_a(instr)));
+  int idx = rak_record_index_of(rec, name);
+  if (idx == -1) return -1;
+  rak_object_retain(&shape->obj);
+  if (cache->shape) rak_shape_release(cache->shape);
+  cache->shape = shape;
+  cache->idx = idx;
+  return idx;
+}
+
+static inline bool rak_vm_is_overwritten(RakValue val, uint32_t *ip, RakValue *slots)
+{
+  // True when the only other owner of the value is the local the next instruction stores into.
+  if (!rak_is_refcounted(val) || rak_is_shared(val)) return false;
+  if (rak_as_object(val)->refCount != 2) return false;
+  uint32_t instr = ip[1];
+  RakOpcode op = rak_instr_opcode(instr);
+  RakValue *slot = &slots[rak_instr_a(instr)];
+  if (op == RAK_OP_STORE_LOCAL_REF)
+    slot = rak_as_ref(*slot);
+  else if (op != RAK_OP_STORE_LOCAL)
+    return false;
+  return rak_is_object(*slot) && rak_as_object(*slot) == rak_as_object(val);
+}
 
 static inline void rak_vm_push_nil(RakFiber *fiber, RakClosure *cl, uint32_t *ip, RakValue *slots, RakError *err)
 {
@@ -157,7 +225,7 @@ static inline void rak_vm_fetch_local(RakFiber *fiber, RakClosure *cl, uint32_t
   uint8_t idx = rak_instr_a(*ip);
   RakValue val = slots[idx];
   if (rak_is_object(val) && rak_as_object(val)->refCount > 1)
-    val.flags |= RAK_FLAG_SHARED;
+    rak_set_shared(val);
   rak_fiber_push_value(fiber, val, err);
 }
 
@@ -168,7 +236,7 @@ static inline void rak_vm_ref_local(RakFiber *fiber, RakClosure *cl, uint32_t *i
   RakValue *slot = &slots[idx];
   RakValue val = *slot;
   if (rak_is_object(val) && rak_as_object(val)->refCount > 1)
-    slot->flags |= RAK_FLAG_SHARED;
+    rak_set_shared(*slot);
   rak_fiber_push_value(fiber, rak_ref_value(slot), err);
 }
 
@@ -230,11 +298,10 @@ static inline void rak_vm_new_range(RakFiber *fiber, RakClosure *cl, uint32_t *i
   }
   double start = rak_as_number(val1);
   double end = rak_as_number(val2);
-  RakRange *range = rak_range_new(start, end, err);
+  RakValue res = rak_range_value_new(start, end, err);
   if (!rak_is_ok(err)) return;
-  RakValue res = rak_range_value(range);
   rak_stack_set(&fiber->vstk, 1, res);
-  rak_object_retain(&range->obj);
+  rak_value_retain(res);
   rak_fiber_pop(fiber);
 }
 
@@ -271,7 +338,7 @@ static inline void rak_vm_new_record(RakFiber *fiber, RakClosure *cl, uint32_t *
       .name = name,
       .val = val,
     };
-    rak_slice_ensure_append(&rec->slice, field, err);
+    rak_record_inplace_append(rec, field, err);
     if (rak_is_ok(err)) continue;
     rak_record_free(rec);
     return;
@@ -331,12 +398,18 @@ static inline void rak_vm_get_element(RakFiber *fiber, RakClosure *cl, uint32_t
     if (!rak_is_range(val2))
     {
       rak_fiber_set_error(fiber, ip, err, "cannot index string with value of type %s",
-        rak_type_to_cstr(val2.type));
+        rak_type_to_cstr(rak_type_of(val2)));
+      return;
+    }
+    int start = (int) rak_range_value_start(val2);
+    int end = (int) rak_range_value_end(val2);
+    if (rak_vm_is_overwritten(val1, ip, slots))
+    {
+      rak_string_inplace_slice(str, start, end, err);
+      if (!rak_is_ok(err)) return;
+      rak_fiber_pop(fiber);
       return;
     }
-    RakRange *range = rak_as_range(val2);
-    int start = (int) range->start;
-    int end = (int) range->end;
     RakString *_str = rak_string_slice(str, start, end, err);
     if (!rak_is_ok(err)) return;
     RakValue res = rak_string_value(_str);
@@ -368,12 +441,11 @@ static inline void rak_vm_get_element(RakFiber *fiber, RakClosure *cl, uint32_t
     if (!rak_is_range(val2))
     {
       rak_fiber_set_error(fiber, ip, err, "cannot index array with value of type %s",
-        rak_type_to_cstr(val2.type));
+        rak_type_to_cstr(rak_type_of(val2)));
       return;
     }
-    RakRange *range = rak_as_range(val2);
-    int start = (int) range->start;
-    int end = (int) range->end;
+    int start = (int) rak_range_value_start(val2);
+    int end = (int) rak_range_value_end(val2);
     RakArray *_arr = rak_array_slice(arr, start, end, err);
     if (!rak_is_ok(err)) return;
     RakValue res = rak_array_value(_arr);
@@ -383,19 +455,18 @@ static inline void rak_vm_get_element(RakFiber *fiber, RakClosure *cl, uint32_t
   }
   if (rak_is_range(val1))
   {
-    RakRange *range = rak_as_range(val1);
     if (!rak_is_number(val2) || !rak_is_integer(val2))
     {
       rak_fiber_set_error(fiber, ip, err, "cannot index range with non-integer number");
       return;
     }
     int64_t idx = rak_as_integer(val2);
-    if (idx < 0 || idx >= rak_range_len(range))
+    if (idx < 0 || idx >= rak_range_value_len(val1))
     {
       rak_fiber_set_error(fiber, ip, err, "index out of bounds");
       return;
     }
-    RakValue res = rak_number_value(rak_range_get(range, (int) idx));
+    RakValue res = rak_number_value(rak_range_value_start(val1) + (int) idx);
     rak_fiber_set_value(fiber, 1, res);
     rak_fiber_pop(fiber);
     return;
@@ -403,14 +474,14 @@ static inline void rak_vm_get_element(RakFiber *fiber, RakClosure *cl, uint32_t
   if (!rak_is_record(val1))
   {
     rak_fiber_set_error(fiber, ip, err, "cannot index value of type %s",
-      rak_type_to_cstr(val1.type));
+      rak_type_to_cstr(rak_type_of(val1)));
     return;
   }
   RakRecord *rec = rak_as_record(val1);
   if (!rak_is_string(val2))
   {
     rak_fiber_set_error(fiber, ip, err, "cannot index record with value of type %s",
-      rak_type_to_cstr(val2.type));
+      rak_type_to_cstr(rak_type_of(val2)));
     return;
   }
   RakString *name = rak_as_string(val2);
@@ -466,29 +537,33 @@ static inline void rak_vm_set_element(RakFiber *fiber, RakClosure *cl, uint32_t
   if (!rak_is_record(val1))
   {
     rak_fiber_set_error(fiber, ip, err, "cannot index value of type %s",
-      rak_type_to_cstr(val1.type));
+      rak_type_to_cstr(rak_type_of(val1)));
     return;
   }
   RakRecord *rec = rak_as_record(val1);
   if (!rak_is_string(val2))
   {
     rak_fiber_set_error(fiber, ip, err, "cannot index record with value of type %s",
-      rak_type_to_cstr(val2.type));
+      rak_type_to_cstr(rak_type_of(val2)));
     return;
   }
-  RakString *name = rak_as_string(val2);
+  // Field names are interned, so records with equal keys share shapes.
+  RakString *name = rak_string_intern(rak_as_string(val2), err);
+  if (!rak_is_ok(err)) return;
   if (rak_is_shared(val1))
   {
     RakRecord *_rec = rak_record_put(rec, name, val3, err);
     if (!rak_is_ok(err)) return;
     RakValue res = rak_record_value(_rec);
     rak_fiber_set_object(fiber, 2, res);
+    rak_value_release(val2);
     rak_value_release(val3);
     fiber->vstk.top -= 2;
     return;
   }
   rak_record_inplace_put(rec, name, val3, err);
   if (!rak_is_ok(err)) return;
+  rak_value_release(val2);
   rak_value_release(val3);
   fiber->vstk.top -= 2;
 }
@@ -521,14 +596,14 @@ static inline void rak_vm_load_element(RakFiber *fiber, RakClosure *cl, uint32_t
   if (!rak_is_record(val1))
   {
     rak_fiber_set_error(fiber, ip, err, "cannot index value of type %s",
-      rak_type_to_cstr(val1.type));
+      rak_type_to_cstr(rak_type_of(val1)));
     return;
   }
   RakRecord *rec = rak_as_record(val1);
   if (!rak_is_string(val2))
   {
     rak_fiber_set_error(fiber, ip, err, "cannot index record with value of type %s",
-      rak_type_to_cstr(val2.type));
+      rak_type_to_cstr(rak_type_of(val2)));
     return;
   }
   RakString *name = rak_as_string(val2);
@@ -568,21 +643,21 @@ static inline void rak_vm_fetch_element(RakFiber *fiber, RakClosure *cl, uint32_
     }
     RakValue res = rak_array_get(arr, (int) idx);
     if (rak_is_shared(val1) || (rak_is_object(res) && rak_as_object(res)->refCount > 1))
-      res.flags |= RAK_FLAG_SHARED;
+      rak_set_shared(res);
     rak_fiber_push_value(fiber, res, err);
     return;
   }
   if (!rak_is_record(val1))
   {
     rak_fiber_set_error(fiber, ip, err, "cannot index value of type %s",
-      rak_type_to_cstr(val1.type));
+      rak_type_to_cstr(rak_type_of(val1)));
     return;
   }
   RakRecord *rec = rak_as_record(val1);
   if (!rak_is_string(val2))
   {
     rak_fiber_set_error(fiber, ip, err, "cannot index record with value of type %s",
-      rak_type_to_cstr(val2.type));
+      rak_type_to_cstr(rak_type_of(val2)));
     return;
   }
   RakString *name = rak_as_string(val2);
@@ -597,7 +672,7 @@ static inline void rak_vm_fetch_element(RakFiber *fiber, RakClosure *cl, uint32_
   rak_string_release(name);
   RakValue res = rak_record_get(rec, idx).val;
   if (rak_is_shared(val1) || (rak_is_object(res) && rak_as_object(res)->refCount > 1))
-    res.flags |= RAK_FLAG_SHARED;
+    rak_set_shared(res);
   rak_fiber_push_value(fiber, res, err);
 }
 
@@ -652,15 +727,15 @@ static inline void rak_vm_get_field(RakFiber *fiber, RakClosure *cl, uint32_t *i
   if (!rak_is_record(val))
   {
     rak_fiber_set_error(fiber, ip, err, "cannot index value of type %s",
-      rak_type_to_cstr(val.type));
+      rak_type_to_cstr(rak_type_of(val)));
     return;
   }
   RakRecord *rec = rak_as_record(val);
   RakChunk *chunk = &((RakFunction *) cl->callable)->chunk;
-  RakString *name = rak_as_string(rak_slice_get(&chunk->consts, idx));
-  int _idx = rak_record_index_of(rec, name);
+  int _idx = rak_vm_field_index(chunk, *ip, rec);
   if (_idx == -1)
   {
+    RakString *name = rak_as_string(rak_slice_get(&chunk->consts, idx));
     rak_fiber_set_error(fiber, ip, err, "record has no field named '%.*s'",
       rak_string_len(name), rak_string_chars(name));
     return;
@@ -678,11 +753,19 @@ static inline void rak_vm_put_field(RakFiber *fiber, RakClosure *cl, uint32_t *i
   if (!rak_is_record(val1))
   {
     rak_fiber_set_error(fiber, ip, err, "cannot index value of type %s",
-      rak_type_to_cstr(val1.type));
+      rak_type_to_cstr(rak_type_of(val1)));
     return;
   }
   RakRecord *rec = rak_as_record(val1);
   RakChunk *chunk = &((RakFunction *) cl->callable)->chunk;
+  int _idx = rak_vm_field_index(chunk, *ip, rec);
+  if (_idx >= 0 && !rak_is_shared(val1))
+  {
+    rak_record_inplace_set(rec, _idx, val2);
+    rak_value_release(val2);
+    rak_stack_pop(&fiber->vstk);
+    return;
+  }
   RakString *name = rak_as_string(rak_slice_get(&chunk->consts, idx));
   if (rak_is_shared(val1))
   {
@@ -708,15 +791,15 @@ static inline void rak_vm_load_field(RakFiber *fiber, RakClosure *cl, uint32_t *
   if (!rak_is_record(val))
   {
     rak_fiber_set_error(fiber, ip, err, "cannot index value of type %s",
-      rak_type_to_cstr(val.type));
+      rak_type_to_cstr(rak_type_of(val)));
     return;
   }
   RakRecord *rec = rak_as_record(val);
   RakChunk *chunk = &((RakFunction *) cl->callable)->chunk;
-  RakString *name = rak_as_string(rak_slice_get(&chunk->consts, idx));
-  int _idx = rak_record_index_of(rec, name);
+  int _idx = rak_vm_field_index(chunk, *ip, rec);
   if (_idx == -1)
   {
+    RakString *name = rak_as_string(rak_slice_get(&chunk->consts, idx));
     rak_fiber_set_error(fiber, ip, err, "record has no field named '%.*s'",
       rak_string_len(name), rak_string_chars(name));
     return;
@@ -735,15 +818,15 @@ static inline void rak_vm_fetch_field(RakFiber *fiber, RakClosure *cl, uint32_t
   if (!rak_is_record(val))
   {
     rak_fiber_set_error(fiber, ip, err, "cannot index value of type %s",
-      rak_type_to_cstr(val.type));
+      rak_type_to_cstr(rak_type_of(val)));
     return;
   }
   RakRecord *rec = rak_as_record(val);
   RakChunk *chunk = &((RakFunction *) cl->callable)->chunk;
-  RakString *name = rak_as_string(rak_slice_get(&chunk->consts, idx));
-  int _idx = rak_record_index_of(rec, name);
+  int _idx = rak_vm_field_index(chunk, *ip, rec);
   if (_idx == -1)
   {
+    RakString *name = rak_as_string(rak_slice_get(&chunk->consts, idx));
     rak_fiber_set_error(fiber, ip, err, "record has no field named '%.*s'",
       rak_string_len(name), rak_string_chars(name));
     return;
@@ -752,7 +835,7 @@ static inline void rak_vm_fetch_field(RakFiber *fiber, RakClosure *cl, uint32_t
   if (!rak_is_ok(err)) return;
   RakValue res = rak_record_get(rec, _idx).val;
   if (rak_is_shared(val) || (rak_is_object(res) && rak_as_object(res)->refCount > 1))
-    res.flags |= RAK_FLAG_SHARED;
+    rak_set_shared(res);
   rak_fiber_push_value(fiber, res, err);
 }
 
@@ -791,7 +874,7 @@ static inline void rak_vm_unpack_elements(RakFiber *fiber, RakClosure *cl, uint3
   if (!rak_is_array(val))
   {
     rak_fiber_set_error(fiber, ip, err, "cannot unpack elements from value of type %s",
-      rak_type_to_cstr(val.type));
+      rak_type_to_cstr(rak_type_of(val)));
     return;
   }
   RakArray *arr = rak_as_array(val);
@@ -819,7 +902,7 @@ static inline void rak_vm_unpack_fields(RakFiber *fiber, RakClosure *cl, uint32_
   if (!rak_is_record(val))
   {
     rak_fiber_set_error(fiber, ip, err, "cannot unpack fields from value of type %s",
-      rak_type_to_cstr(val.type));
+      rak_type_to_cstr(rak_type_of(val)));
     return;
   }
   RakRecord *rec = rak_as_record(val);
@@ -861,6 +944,7 @@ static inline void rak_vm_jump(RakFiber *fiber, RakClosure *cl, uint32_t *ip, Ra
 {
   (void) slots;
   (void) err;
+  rak_gc_safe_point();
   uint16_t off = rak_instr_ab(*ip);
   RakChunk *chunk = &((RakFunction *) cl->callable)->chunk;
   RakCallFrame *frame = &rak_stack_get(&fiber->cstk, 0);
@@ -916,11 +1000,12 @@ static inline void rak_vm_jump_if_true_or_pop(RakFiber *fiber, RakClosure *cl, u
 static inline void rak_vm_eq(RakFiber *fiber, RakClosure *cl, uint32_t *ip, RakValue *slots, RakError *err)
 {
   (void) cl;
-  (void) ip;
   (void) slots;
   (void) err;
   RakValue val1 = rak_fiber_get(fiber, 1);
   RakValue val2 = rak_fiber_get(fiber, 0);
+  if (rak_is_number(val1) && rak_is_number(val2))
+    *ip = rak_instr_with_opcode(*ip, RAK_OP_EQ_NUM);
   RakValue res = rak_bool_value(rak_value_equals(val1, val2));
   rak_fiber_set(fiber, 1, res);
   rak_fiber_pop(fiber);
@@ -929,11 +1014,12 @@ static inline void rak_vm_eq(RakFiber *fiber, RakClosure *cl, uint32_t *ip, RakV
 static inline void rak_vm_ne(RakFiber *fiber, RakClosure *cl, uint32_t *ip, RakValue *slots, RakError *err)
 {
   (void) cl;
-  (void) ip;
   (void) slots;
   (void) err;
   RakValue val1 = rak_fiber_get(fiber, 1);
   RakValue val2 = rak_fiber_get(fiber, 0);
+  if (rak_is_number(val1) && rak_is_number(val2))
+    *ip = rak_instr_with_opcode(*ip, RAK_OP_NE_NUM);
   RakValue res = rak_bool_value(!rak_value_equals(val1, val2));
   rak_fiber_set(fiber, 1, res);
   rak_fiber_pop(fiber);
@@ -942,10 +1028,11 @@ static inline void rak_vm_ne(RakFiber *fiber, RakClosure *cl, uint32_t *ip, RakV
 static inline void rak_vm_gt(RakFiber *fiber, RakClosure *cl, uint32_t *ip, RakValue *slots, RakError *err)
 {
   (void) cl;
-  (void) ip;
   (void) slots;
   RakValue val1 = rak_fiber_get(fiber, 1);
   RakValue val2 = rak_fiber_get(fiber, 0);
+  if (rak_is_number(val1) && rak_is_number(val2))
+    *ip = rak_instr_with_opcode(*ip, RAK_OP_GT_NUM);
   int cmp = rak_value_compare(val1, val2, err);
   if (!rak_is_ok(err)) return;
   RakValue res = rak_bool_value(cmp > 0);
@@ -956,10 +1043,11 @@ static inline void rak_vm_gt(RakFiber *fiber, RakClosure *cl, uint32_t *ip, RakV
 static inline void rak_vm_ge(RakFiber *fiber, RakClosure *cl, uint32_t *ip, RakValue *slots, RakError *err)
 {
   (void) cl;
-  (void) ip;
   (void) slots;
   RakValue val1 = rak_fiber_get(fiber, 1);
   RakValue val2 = rak_fiber_get(fiber, 0);
+  if (rak_is_number(val1) && rak_is_number(val2))
+    *ip = rak_instr_with_opcode(*ip, RAK_OP_GE_NUM);
   int cmp = rak_value_compare(val1, val2, err);
   if (!rak_is_ok(err)) return;
   RakValue res = rak_bool_value(cmp >= 0);
@@ -970,10 +1058,11 @@ static inline void rak_vm_ge(RakFiber *fiber, RakClosure *cl, uint32_t *ip, RakV
 static inline void rak_vm_lt(RakFiber *fiber, RakClosure *cl, uint32_t *ip, RakValue *slots, RakError *err)
 {
   (void) cl;
-  (void) ip;
   (void) slots;
   RakValue val1 = rak_fiber_get(fiber, 1);
   RakValue val2 = rak_fiber_get(fiber, 0);
+  if (rak_is_number(val1) && rak_is_number(val2))
+    *ip = rak_instr_with_opcode(*ip, RAK_OP_LT_NUM);
   int cmp = rak_value_compare(val1, val2, err);
   if (!rak_is_ok(err)) return;
   RakValue res = rak_bool_value(cmp < 0);
@@ -984,10 +1073,11 @@ static inline void rak_vm_lt(RakFiber *fiber, RakClosure *cl, uint32_t *ip, RakV
 static inline void rak_vm_le(RakFiber *fiber, RakClosure *cl, uint32_t *ip, RakValue *slots, RakError *err)
 {
   (void) cl;
-  (void) ip;
   (void) slots;
   RakValue val1 = rak_fiber_get(fiber, 1);
   RakValue val2 = rak_fiber_get(fiber, 0);
+  if (rak_is_number(val1) && rak_is_number(val2))
+    *ip = rak_instr_with_opcode(*ip, RAK_OP_LE_NUM);
   int cmp = rak_value_compare(val1, val2, err);
   if (!rak_is_ok(err)) return;
   RakValue res = rak_bool_value(cmp <= 0);
@@ -995,10 +1085,249 @@ static inline void rak_vm_le(RakFiber *fiber, RakClosure *cl, uint32_t *ip, RakV
   rak_fiber_pop(fiber);
 }
 
+static inline void rak_vm_eq_locals_jump_if_false(RakFiber *fiber, RakClosure *cl, uint32_t *ip, RakValue *slots, RakError *err)
+{
+  (void) cl;
+  (void) err;
+  RakValue val1 = slots[rak_instr_a(*ip)];
+  RakValue val2 = slots[rak_instr_b(*ip)];
+  RakCallFrame *frame = &rak_stack_get(&fiber->cstk, 0);
+  frame->state = rak_value_equals(val1, val2) ? ip + 2 : ip + 1;
+}
+
+static inline void rak_vm_eq_const_jump_if_false(RakFiber *fiber, RakClosure *cl, uint32_t *ip, RakValue *slots, RakError *err)
+{
+  (void) err;
+  RakChunk *chunk = &((RakFunction *) cl->callable)->chunk;
+  RakValue val1 = slots[rak_instr_a(*ip)];
+  RakValue val2 = rak_slice_get(&chunk->consts, rak_instr_b(*ip));
+  RakCallFrame *frame = &rak_stack_get(&fiber->cstk, 0);
+  frame->state = rak_value_equals(val1, val2) ? ip + 2 : ip + 1;
+}
+
+static inline void rak_vm_eq_int_jump_if_false(RakFiber *fiber, RakClosure *cl, uint32_t *ip, RakValue *slots, RakError *err)
+{
+  (void) cl;
+  (void) err;
+  RakValue val1 = slots[rak_instr_a(*ip)];
+  RakValue val2 = rak_number_value(rak_instr_b(*ip));
+  RakCallFrame *frame = &rak_stack_get(&fiber->cstk, 0);
+  frame->state = rak_value_equals(val1, val2) ? ip + 2 : ip + 1;
+}
+
+static inline void rak_vm_ne_locals_jump_if_false(RakFiber *fiber, RakClosure *cl, uint32_t *ip, RakValue *slots, RakError *err)
+{
+  (void) cl;
+  (void) err;
+  RakValue val1 = slots[rak_instr_a(*ip)];
+  RakValue val2 = slots[rak_instr_b(*ip)];
+  RakCallFrame *frame = &rak_stack_get(&fiber->cstk, 0);
+  frame->state = !rak_value_equals(val1, val2) ? ip + 2 : ip + 1;
+}
+
+static inline void rak_vm_ne_const_jump_if_false(RakFiber *fiber, RakClosure *cl, uint32_t *ip, RakValue *slots, RakError *err)
+{
+  (void) err;
+  RakChunk *chunk = &((RakFunction *) cl->callable)->chunk;
+  RakValue val1 = slots[rak_instr_a(*ip)];
+  RakValue val2 = rak_slice_get(&chunk->consts, rak_instr_b(*ip));
+  RakCallFrame *frame = &rak_stack_get(&fiber->cstk, 0);
+  frame->state = !rak_value_equals(val1, val2) ? ip + 2 : ip + 1;
+}
+
+static inline void rak_vm_ne_int_jump_if_false(RakFiber *fiber, RakClosure *cl, uint32_t *ip, RakValue *slots, RakError *err)
+{
+  (void) cl;
+  (void) err;
+  RakValue val1 = slots[rak_instr_a(*ip)];
+  RakValue val2 = rak_number_value(rak_instr_b(*ip));
+  RakCallFrame *frame = &rak_stack_get(&fiber->cstk, 0);
+  frame->state = !rak_value_equals(val1, val2) ? ip + 2 : ip + 1;
+}
+
+static inline void rak_vm_gt_locals_jump_if_false(RakFiber *fiber, RakClosure *cl, uint32_t *ip, RakValue *slots, RakError *err)
+{
+  (void) cl;
+  RakValue val1 = slots[rak_instr_a(*ip)];
+  RakValue val2 = slots[rak_instr_b(*ip)];
+  RakCallFrame *frame = &rak_stack_get(&fiber->cstk, 0);
+  int cmp = rak_value_compare(val1, val2, err);
+  if (!rak_is_ok(err))
+  {
+    frame->state = ip + 1;
+    return;
+  }
+  frame->state = cmp > 0 ? ip + 2 : ip + 1;
+}
+
+static inline void rak_vm_gt_const_jump_if_false(RakFiber *fiber, RakClosure *cl, uint32_t *ip, RakValue *slots, RakError *err)
+{
+  RakChunk *chunk = &((RakFunction *) cl->callable)->chunk;
+  RakValue val1 = slots[rak_instr_a(*ip)];
+  RakValue val2 = rak_slice_get(&chunk->consts, rak_instr_b(*ip));
+  RakCallFrame *frame = &rak_stack_get(&fiber->cstk, 0);
+  int cmp = rak_value_compare(val1, val2, err);
+  if (!rak_is_ok(err))
+  {
+    frame->state = ip + 1;
+    return;
+  }
+  frame->state = cmp > 0 ? ip + 2 : ip + 1;
+}
+
+static inline void rak_vm_gt_int_jump_if_false(RakFiber *fiber, RakClosure *cl, uint32_t *ip, RakValue *slots, RakError *err)
+{
+  (void) cl;
+  RakValue val1 = slots[rak_instr_a(*ip)];
+  RakValue val2 = rak_number_value(rak_instr_b(*ip));
+  RakCallFrame *frame = &rak_stack_get(&fiber->cstk, 0);
+  int cmp = rak_value_compare(val1, val2, err);
+  if (!rak_is_ok(err))
+  {
+    frame->state = ip + 1;
+    return;
+  }
+  frame->state = cmp > 0 ? ip + 2 : ip + 1;
+}
+
+static inline void rak_vm_ge_locals_jump_if_false(RakFiber *fiber, RakClosure *cl, uint32_t *ip, RakValue *slots, RakError *err)
+{
+  (void) cl;
+  RakValue val1 = slots[rak_instr_a(*ip)];
+  RakValue val2 = slots[rak_instr_b(*ip)];
+  RakCallFrame *frame = &rak_stack_get(&fiber->cstk, 0);
+  int cmp = rak_value_compare(val1, val2, err);
+  if (!rak_is_ok(err))
+  {
+    frame->state = ip + 1;
+    return;
+  }
+  frame->state = cmp >= 0 ? ip + 2 : ip + 1;
+}
+
+static inline void rak_vm_ge_const_jump_if_false(RakFiber *fiber, RakClosure *cl, uint32_t *ip, RakValue *slots, RakError *err)
+{
+  RakChunk *chunk = &((RakFunction *) cl->callable)->chunk;
+  RakValue val1 = slots[rak_instr_a(*ip)];
+  RakValue val2 = rak_slice_get(&chunk->consts, rak_instr_b(*ip));
+  RakCallFrame *frame = &rak_stack_get(&fiber->cstk, 0);
+  int cmp = rak_value_compare(val1, val2, err);
+  if (!rak_is_ok(err))
+  {
+    frame->state = ip + 1;
+    return;
+  }
+  frame->state = cmp >= 0 ? ip + 2 : ip + 1;
+}
+
+static inline void rak_vm_ge_int_jump_if_false(RakFiber *fiber, RakClosure *cl, uint32_t *ip, RakValue *slots, RakError *err)
+{
+  (void) cl;
+  RakValue val1 = slots[rak_instr_a(*ip)];
+  RakValue val2 = rak_number_value(rak_instr_b(*ip));
+  RakCallFrame *frame = &rak_stack_get(&fiber->cstk, 0);
+  int cmp = rak_value_compare(val1, val2, err);
+  if (!rak_is_ok(err))
+  {
+    frame->state = ip + 1;
+    return;
+  }
+  frame->state = cmp >= 0 ? ip + 2 : ip + 1;
+}
+
+static inline void rak_vm_lt_locals_jump_if_false(RakFiber *fiber, RakClosure *cl, uint32_t *ip, RakValue *slots, RakError *err)
+{
+  (void) cl;
+  RakValue val1 = slots[rak_instr_a(*ip)];
+  RakValue val2 = slots[rak_instr_b(*ip)];
+  RakCallFrame *frame = &rak_stack_get(&fiber->cstk, 0);
+  int cmp = rak_value_compare(val1, val2, err);
+  if (!rak_is_ok(err))
+  {
+    frame->state = ip + 1;
+    return;
+  }
+  frame->state = cmp < 0 ? ip + 2 : ip + 1;
+}
+
+static inline void rak_vm_lt_const_jump_if_false(RakFiber *fiber, RakClosure *cl, uint32_t *ip, RakValue *slots, RakError *err)
+{
+  RakChunk *chunk = &((RakFunction *) cl->callable)->chunk;
+  RakValue val1 = slots[rak_instr_a(*ip)];
+  RakValue val2 = rak_slice_get(&chunk->consts, rak_instr_b(*ip));
+  RakCallFrame *frame = &rak_stack_get(&fiber->cstk, 0);
+  int cmp = rak_value_compare(val1, val2, err);
+  if (!rak_is_ok(err))
+  {
+    frame->state = ip + 1;
+    return;
+  }
+  frame->state = cmp < 0 ? ip + 2 : ip + 1;
+}
+
+static inline void rak_vm_lt_int_jump_if_false(RakFiber *fiber, RakClosure *cl, uint32_t *ip, RakValue *slots, RakError *err)
+{
+  (void) cl;
+  RakValue val1 = slots[rak_instr_a(*ip)];
+  RakValue val2 = rak_number_value(rak_instr_b(*ip));
+  RakCallFrame *frame = &rak_stack_get(&fiber->cstk, 0);
+  int cmp = rak_value_compare(val1, val2, err);
+  if (!rak_is_ok(err))
+  {
+    frame->state = ip + 1;
+    return;
+  }
+  frame->state = cmp < 0 ? ip + 2 : ip + 1;
+}
+
+static inline void rak_vm_le_locals_jump_if_false(RakFiber *fiber, RakClosure *cl, uint32_t *ip, RakValue *slots, RakError *err)
+{
+  (void) cl;
+  RakValue val1 = slots[rak_instr_a(*ip)];
+  RakValue val2 = slots[rak_instr_b(*ip)];
+  RakCallFrame *frame = &rak_stack_get(&fiber->cstk, 0);
+  int cmp = rak_value_compare(val1, val2, err);
+  if (!rak_is_ok(err))
+  {
+    frame->state = ip + 1;
+    return;
+  }
+  frame->state = cmp <= 0 ? ip + 2 : ip + 1;
+}
+
+static inline void rak_vm_le_const_jump_if_false(RakFiber *fiber, RakClosure *cl, uint32_t *ip, RakValue *slots, RakError *err)
+{
+  RakChunk *chunk = &((RakFunction *) cl->callable)->chunk;
+  RakValue val1 = slots[rak_instr_a(*ip)];
+  RakValue val2 = rak_slice_get(&chunk->consts, rak_instr_b(*ip));
+  RakCallFrame *frame = &rak_stack_get(&fiber->cstk, 0);
+  int cmp = rak_value_compare(val1, val2, err);
+  if (!rak_is_ok(err))
+  {
+    frame->state = ip + 1;
+    return;
+  }
+  frame->state = cmp <= 0 ? ip + 2 : ip + 1;
+}
+
+static inline void rak_vm_le_int_jump_if_false(RakFiber *fiber, RakClosure *cl, uint32_t *ip, RakValue *slots, RakError *err)
+{
+  (void) cl;
+  RakValue val1 = slots[rak_instr_a(*ip)];
+  RakValue val2 = rak_number_value(rak_instr_b(*ip));
+  RakCallFrame *frame = &rak_stack_get(&fiber->cstk, 0);
+  int cmp = rak_value_compare(val1, val2, err);
+  if (!rak_is_ok(err))
+  {
+    frame->state = ip + 1;
+    return;
+  }
+  frame->state = cmp <= 0 ? ip + 2 : ip + 1;
+}
+
 static inline void rak_vm_add(RakFiber *fiber, RakClosure *cl, uint32_t *ip, RakValue *slots, RakError *err)
 {
   (void) cl;
-  (void) ip;
   (void) slots;
   RakValue val1 = rak_fiber_get(fiber, 1);
   RakValue val2 = rak_fiber_get(fiber, 0);
@@ -1007,9 +1336,10 @@ static inline void rak_vm_add(RakFiber *fiber, RakClosure *cl, uint32_t *ip, Rak
     if (!rak_is_number(val2))
     {
       rak_fiber_set_error(fiber, ip, err, "cannot add number and %s",
-        rak_type_to_cstr(val2.type));
+        rak_type_to_cstr(rak_type_of(val2)));
       return;
     }
+    *ip = rak_instr_with_opcode(*ip, RAK_OP_ADD_NUM);
     double num1 = rak_as_number(val1);
     double num2 = rak_as_number(val2);
     RakValue res = rak_number_value(num1 + num2);
@@ -1022,19 +1352,20 @@ static inline void rak_vm_add(RakFiber *fiber, RakClosure *cl, uint32_t *ip, Rak
     if (!rak_is_string(val2))
     {
       rak_fiber_set_error(fiber, ip, err, "cannot add string and %s",
-        rak_type_to_cstr(val2.type));
+        rak_type_to_cstr(rak_type_of(val2)));
       return;
     }
     RakString *str1 = rak_as_string(val1);
     RakString *str2 = rak_as_string(val2);
-    RakString *str3 = rak_string_new_copy(str1, err);
-    if (!rak_is_ok(err)) return;
-    rak_string_inplace_concat(str3, str2, err);
-    if (!rak_is_ok(err))
+    if (rak_vm_is_overwritten(val1, ip, slots))
     {
-      rak_string_free(str3);
+      rak_string_inplace_concat(str1, str2, err);
+      if (!rak_is_ok(err)) return;
+      rak_fiber_pop(fiber);
       return;
     }
+    RakString *str3 = rak_string_concat(str1, str2, err);
+    if (!rak_is_ok(err)) return;
     RakValue res = rak_string_value(str3);
     rak_fiber_set_object(fiber, 1, res);
     rak_fiber_pop(fiber);
@@ -1045,7 +1376,7 @@ static inline void rak_vm_add(RakFiber *fiber, RakClosure *cl, uint32_t *ip, Rak
     if (!rak_is_array(val2))
     {
       rak_fiber_set_error(fiber, ip, err, "cannot add array and %s",
-        rak_type_to_cstr(val2.type));
+        rak_type_to_cstr(rak_type_of(val2)));
       return;
     }
     RakArray *arr1 = rak_as_array(val1);
@@ -1064,7 +1395,7 @@ static inline void rak_vm_add(RakFiber *fiber, RakClosure *cl, uint32_t *ip, Rak
     return;
   }
   rak_fiber_set_error(fiber, ip, err, "cannot add %s and %s",
-    rak_type_to_cstr(val1.type), rak_type_to_cstr(val2.type));
+    rak_type_to_cstr(rak_type_of(val1)), rak_type_to_cstr(rak_type_of(val2)));
 }
 
 static inline void rak_vm_add2(RakFiber *fiber, RakClosure *cl, uint32_t *ip, RakValue *slots, RakError *err)
@@ -1079,9 +1410,10 @@ static inline void rak_vm_add2(RakFiber *fiber, RakClosure *cl, uint32_t *ip, Ra
     if (!rak_is_number(val2))
     {
       rak_fiber_set_error(fiber, ip, err, "cannot add number and %s",
-        rak_type_to_cstr(val2.type));
+        rak_type_to_cstr(rak_type_of(val2)));
       return;
     }
+    *ip = rak_instr_with_opcode(*ip, RAK_OP_ADD2_NUM);
     double num1 = rak_as_number(val1);
     double num2 = rak_as_number(val2);
     RakValue res = rak_number_value(num1 + num2);
@@ -1093,21 +1425,17 @@ static inline void rak_vm_add2(RakFiber *fiber, RakClosure *cl, uint32_t *ip, Ra
     if (!rak_is_string(val2))
     {
       rak_fiber_set_error(fiber, ip, err, "cannot add string and %s",
-        rak_type_to_cstr(val2.type));
+        rak_type_to_cstr(rak_type_of(val2)));
       return;
     }
     RakString *str1 = rak_as_string(val1);
     RakString *str2 = rak_as_string(val2);
-    RakString *str3 = rak_string_new_copy(str1, err);
+    RakString *str3 = rak_string_concat(str1, str2, err);
     if (!rak_is_ok(err)) return;
-    rak_string_inplace_concat(str3, str2, err);
-    if (!rak_is_ok(err))
-    {
-      rak_string_free(str3);
-      return;
-    }
     RakValue res = rak_string_value(str3);
     rak_fiber_push_object(fiber, res, err);
+    if (rak_is_ok(err)) return;
+    rak_string_free(str3);
     return;
   }
   if (rak_is_array(val1))
@@ -1115,7 +1443,7 @@ static inline void rak_vm_add2(RakFiber *fiber, RakClosure *cl, uint32_t *ip, Ra
     if (!rak_is_array(val2))
     {
       rak_fiber_set_error(fiber, ip, err, "cannot add array and %s",
-        rak_type_to_cstr(val2.type));
+        rak_type_to_cstr(rak_type_of(val2)));
       return;
     }
     RakArray *arr1 = rak_as_array(val1);
@@ -1133,7 +1461,7 @@ static inline void rak_vm_add2(RakFiber *fiber, RakClosure *cl, uint32_t *ip, Ra
     return;
   }
   rak_fiber_set_error(fiber, ip, err, "cannot add %s and %s",
-    rak_type_to_cstr(val1.type), rak_type_to_cstr(val2.type));
+    rak_type_to_cstr(rak_type_of(val1)), rak_type_to_cstr(rak_type_of(val2)));
 }
 
 static inline void rak_vm_add3(RakFiber *fiber, RakClosure *cl, uint32_t *ip, RakValue *slots, RakError *err)
@@ -1149,9 +1477,10 @@ static inline void rak_vm_add3(RakFiber *fiber, RakClosure *cl, uint32_t *ip, Ra
     if (!rak_is_number(val2))
     {
       rak_fiber_set_error(fiber, ip, err, "cannot add number and %s",
-        rak_type_to_cstr(val2.type));
+        rak_type_to_cstr(rak_type_of(val2)));
       return;
     }
+    *ip = rak_instr_with_opcode(*ip, RAK_OP_ADD3_NUM);
     double num1 = rak_as_number(val1);
     double num2 = rak_as_number(val2);
     RakValue res = rak_number_value(num1 + num2);
@@ -1164,19 +1493,19 @@ static inline void rak_vm_add3(RakFiber *fiber, RakClosure *cl, uint32_t *ip, Ra
     if (!rak_is_string(val2))
     {
       rak_fiber_set_error(fiber, ip, err, "cannot add string and %s",
-        rak_type_to_cstr(val2.type));
+        rak_type_to_cstr(rak_type_of(val2)));
       return;
     }
     RakString *str1 = rak_as_string(val1);
     RakString *str2 = rak_as_string(val2);
-    RakString *str3 = rak_string_new_copy(str1, err);
-    if (!rak_is_ok(err)) return;
-    rak_string_inplace_concat(str3, str2, err);
-    if (!rak_is_ok(err))
+    if (dst == lhs && rak_is_refcounted(val1) && !rak_is_shared(val1)
+     && rak_as_object(val1)->refCount == 1)
     {
-      rak_string_free(str3);
+      rak_string_inplace_concat(str1, str2, err);
       return;
     }
+    RakString *str3 = rak_string_concat(str1, str2, err);
+    if (!rak_is_ok(err)) return;
     RakValue res = rak_string_value(str3);
     rak_value_release(slots[dst]);
     slots[dst] = res;
@@ -1188,7 +1517,7 @@ static inline void rak_vm_add3(RakFiber *fiber, RakClosure *cl, uint32_t *ip, Ra
     if (!rak_is_array(val2))
     {
       rak_fiber_set_error(fiber, ip, err, "cannot add array and %s",
-        rak_type_to_cstr(val2.type));
+        rak_type_to_cstr(rak_type_of(val2)));
       return;
     }
     RakArray *arr1 = rak_as_array(val1);
@@ -1208,7 +1537,7 @@ static inline void rak_vm_add3(RakFiber *fiber, RakClosure *cl, uint32_t *ip, Ra
     return;
   }
   rak_fiber_set_error(fiber, ip, err, "cannot add %s and %s",
-    rak_type_to_cstr(val1.type), rak_type_to_cstr(val2.type));
+    rak_type_to_cstr(rak_type_of(val1)), rak_type_to_cstr(rak_type_of(val2)));
 }
 
 static inline void rak_vm_sub(RakFiber *fiber, RakClosure *cl, uint32_t *ip, RakValue *slots, RakError *err)
@@ -1470,6 +1799,7 @@ static inline void rak_vm_call(RakFiber *fiber, RakClosure *cl, uint32_t *ip, Ra
 {
   (void) cl;
   (void) slots;
+  rak_gc_safe_point();
   uint8_t nargs = rak_instr_a(*ip);
   RakValue *_slots = &rak_stack_get(&fiber->vstk, nargs);
   RakValue val = _slots[0];
@@ -1478,12 +1808,16 @@ static inline void rak_vm_call(RakFiber *fiber, RakClosure *cl, uint32_t *ip, Ra
     rak_fiber_set_error(fiber, ip, err, "cannot call non-closure value");
     return;
   }
-  if (rak_stack_is_full(&fiber->cstk))
+  RakClosure *_cl = rak_as_closure(val);
+  rak_fiber_ensure_cstk(fiber, err);
+  if (rak_is_ok(err))
+    rak_fiber_ensure_vstk(fiber, _cl->callable->stackSize - nargs - 1, err);
+  if (!rak_is_ok(err))
   {
-    rak_fiber_set_error(fiber, ip, err, "too many nested calls");
+    rak_stack_get(&fiber->cstk, 0).state = ip + 1;
     return;
   }
-  RakClosure *_cl = rak_as_closure(val);
+  _slots = &rak_stack_get(&fiber->vstk, nargs);
   int arity = _cl->callable->arity;
   while (nargs > arity)
   {
@@ -1503,7 +1837,7 @@ static inline void rak_vm_call(RakFiber *fiber, RakClosure *cl, uint32_t *ip, Ra
     RakValue _val = _slots[idx];
     if (rak_is_ref(_val)) continue;
     rak_fiber_set_error(fiber, ip, err, "argument #%d must be a reference, got %s",
-      idx, rak_type_to_cstr(_val.type));
+      idx, rak_type_to_cstr(rak_type_of(_val)));
     return;
   }
   RakCallFrame *frame = &rak_stack_get(&fiber->cstk, 0);
@@ -1525,6 +1859,7 @@ static inline void rak_vm_call(RakFiber *fiber, RakClosure *cl, uint32_t *ip, Ra
 
 static inline void rak_vm_tail_call(RakFiber *fiber, RakClosure *cl, uint32_t *ip, RakValue *slots, RakError *err)
 {
+  rak_gc_safe_point();
   uint8_t nargs = rak_instr_a(*ip);
   RakValue *_slots = &rak_stack_get(&fiber->vstk, nargs);
   RakValue val = _slots[0];
@@ -1534,6 +1869,14 @@ static inline void rak_vm_tail_call(RakFiber *fiber, RakClosure *cl, uint32_t *i
     return;
   }
   RakClosure *_cl = rak_as_closure(val);
+  rak_fiber_ensure_vstk(fiber, _cl->callable->stackSize - nargs - 1, err);
+  if (!rak_is_ok(err))
+  {
+    rak_stack_get(&fiber->cstk, 0).state = ip + 1;
+    return;
+  }
+  slots = rak_stack_get(&fiber->cstk, 0).slots;
+  _slots = &rak_stack_get(&fiber->vstk, nargs);
   int arity = _cl->callable->arity;
   while (nargs > arity)
   {
@@ -1553,7 +1896,7 @@ static inline void rak_vm_tail_call(RakFiber *fiber, RakClosure *cl, uint32_t *i
     RakValue _val = _slots[idx];
     if (rak_is_ref(_val)) continue;
     rak_fiber_set_error(fiber, ip, err, "argument #%d must be a reference, got %s",
-      idx, rak_type_to_cstr(_val.type));
+      idx, rak_type_to_cstr(rak_type_of(_val)));
     return;
   }
   rak_closure_release(cl);
@@ -1598,4 +1941,157 @@ static inline void rak_vm_return_nil(RakFiber *fiber, RakClosure *cl, uint32_t *
   rak_vm_return(fiber, cl, ip, slots, err);
 }
 
+static inline void rak_vm_eq_num(RakFiber *fiber, RakClosure *cl, uint32_t *ip, RakValue *slots, RakError *err)
+{
+  RakValue val1 = rak_fiber_get(fiber, 1);
+  RakValue val2 = rak_fiber_get(fiber, 0);
+  if (!rak_is_number(val1) || !rak_is_number(val2))
+  {
+    *ip = rak_instr_with_opcode(*ip, RAK_OP_EQ);
+    rak_vm_eq(fiber, cl, ip, slots, err);
+    return;
+  }
+  double num1 = rak_as_number(val1);
+  double num2 = rak_as_number(val2);
+  RakValue res = rak_bool_value(!rak_number_compare(num1, num2));
+  rak_stack_set(&fiber->vstk, 1, res);
+  rak_stack_pop(&fiber->vstk);
+}
+
+static inline void rak_vm_ne_num(RakFiber *fiber, RakClosure *cl, uint32_t *ip, RakValue *slots, RakError *err)
+{
+  RakValue val1 = rak_fiber_get(fiber, 1);
+  RakValue val2 = rak_fiber_get(fiber, 0);
+  if (!rak_is_number(val1) || !rak_is_number(val2))
+  {
+    *ip = rak_instr_with_opcode(*ip, RAK_OP_NE);
+    rak_vm_ne(fiber, cl, ip, slots, err);
+    return;
+  }
+  double num1 = rak_as_number(val1);
+  double num2 = rak_as_number(val2);
+  RakValue res = rak_bool_value(rak_number_compare(num1, num2) != 0);
+  rak_stack_set(&fiber->vstk, 1, res);
+  rak_stack_pop(&fiber->vstk);
+}
+
+static inline void rak_vm_gt_num(RakFiber *fiber, RakClosure *cl, uint32_t *ip, RakValue *slots, RakError *err)
+{
+  RakValue val1 = rak_fiber_get(fiber, 1);
+  RakValue val2 = rak_fiber_get(fiber, 0);
+  if (!rak_is_number(val1) || !rak_is_number(val2))
+  {
+    *ip = rak_instr_with_opcode(*ip, RAK_OP_GT);
+    rak_vm_gt(fiber, cl, ip, slots, err);
+    return;
+  }
+  double num1 = rak_as_number(val1);
+  double num2 = rak_as_number(val2);
+  RakValue res = rak_bool_value(rak_number_compare(num1, num2) > 0);
+  rak_stack_set(&fiber->vstk, 1, res);
+  rak_stack_pop(&fiber->vstk);
+}
+
+static inline void rak_vm_ge_num(RakFiber *fiber, RakClosure *cl, uint32_t *ip, RakValue *slots, RakError *err)
+{
+  RakValue val1 = rak_fiber_get(fiber, 1);
+  RakValue val2 = rak_fiber_get(fiber, 0);
+  if (!rak_is_number(val1) || !rak_is_number(val2))
+  {
+    *ip = rak_instr_with_opcode(*ip, RAK_OP_GE);
+    rak_vm_ge(fiber, cl, ip, slots, err);
+    return;
+  }
+  double num1 = rak_as_number(val1);
+  double num2 = rak_as_number(val2);
+  RakValue res = rak_bool_value(rak_number_compare(num1, num2) >= 0);
+  rak_stack_set(&fiber->vstk, 1, res);
+  rak_stack_pop(&fiber->vstk);
+}
+
+static inline void rak_vm_lt_num(RakFiber *fiber, RakClosure *cl, uint32_t *ip, RakValue *slots, RakError *err)
+{
+  RakValue val1 = rak_fiber_get(fiber, 1);
+  RakValue val2 = rak_fiber_get(fiber, 0);
+  if (!rak_is_number(val1) || !rak_is_number(val2))
+  {
+    *ip = rak_instr_with_opcode(*ip, RAK_OP_LT);
+    rak_vm_lt(fiber, cl, ip, slots, err);
+    return;
+  }
+  double num1 = rak_as_number(val1);
+  double num2 = rak_as_number(val2);
+  RakValue res = rak_bool_value(rak_number_compare(num1, num2) < 0);
+  rak_stack_set(&fiber->vstk, 1, res);
+  rak_stack_pop(&fiber->vstk);
+}
+
+static inline void rak_vm_le_num(RakFiber *fiber, RakClosure *cl, uint32_t *ip, RakValue *slots, RakError *err)
+{
+  RakValue val1 = rak_fiber_get(fiber, 1);
+  RakValue val2 = rak_fiber_get(fiber, 0);
+  if (!rak_is_number(val1) || !rak_is_number(val2))
+  {
+    *ip = rak_instr_with_opcode(*ip, RAK_OP_LE);
+    rak_vm_le(fiber, cl, ip, slots, err);
+    return;
+  }
+  double num1 = rak_as_number(val1);
+  double num2 = rak_as_number(val2);
+  RakValue res = rak_bool_value(rak_number_compare(num1, num2) <= 0);
+  rak_stack_set(&fiber->vstk, 1, res);
+  rak_stack_pop(&fiber->vstk);
+}
+
+static inline void rak_vm_add_num(RakFiber *fiber, RakClosure *cl, uint32_t *ip, RakValue *slots, RakError *err)
+{
+  RakValue val1 = rak_fiber_get(fiber, 1);
+  RakValue val2 = rak_fiber_get(fiber, 0);
+  if (!rak_is_number(val1) || !rak_is_number(val2))
+  {
+    *ip = rak_instr_with_opcode(*ip, RAK_OP_ADD);
+    rak_vm_add(fiber, cl, ip, slots, err);
+    return;
+  }
+  double num1 = rak_as_number(val1);
+  double num2 = rak_as_number(val2);
+  RakValue res = rak_number_value(num1 + num2);
+  rak_stack_set(&fiber->vstk, 1, res);
+  rak_stack_pop(&fiber->vstk);
+}
+
+static inline void rak_vm_add2_num(RakFiber *fiber, RakClosure *cl, uint32_t *ip, RakValue *slots, RakError *err)
+{
+  RakValue val1 = slots[rak_instr_a(*ip)];
+  RakValue val2 = slots[rak_instr_b(*ip)];
+  if (!rak_is_number(val1) || !rak_is_number(val2))
+  {
+    *ip = rak_instr_with_opcode(*ip, RAK_OP_ADD2);
+    rak_vm_add2(fiber, cl, ip, slots, err);
+    return;
+  }
+  double num1 = rak_as_number(val1);
+  double num2 = rak_as_number(val2);
+  RakValue res = rak_number_value(num1 + num2);
+  rak_fiber_push(fiber, res, err);
+}
+
+static inline void rak_vm_add3_num(RakFiber *fiber, RakClosure *cl, uint32_t *ip, RakValue *slots, RakError *err)
+{
+  uint8_t dst = rak_instr_a(*ip);
+  RakValue val1 = slots[rak_instr_b(*ip)];
+  RakValue val2 = slots[rak_instr_c(*ip)];
+  if (!rak_is_number(val1) || !rak_is_number(val2))
+  {
+    *ip = rak_instr_with_opcode(*ip, RAK_OP_ADD3);
+    rak_vm_add3(fiber, cl, ip, slots, err);
+    return;
+  }
+  double num1 = rak_as_number(val1);
+  double num2 = rak_as_number(val2);
+  RakValue res = rak_number_value(num1 + num2);
+  rak_value_release(slots[dst]);
+  slots[dst] = res;
+}
+
 #endif // RAK_VM_H
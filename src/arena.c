@@ -0,0 +1,270 @@
+//
+// arena.c
+//
+// Copyright 2025 Fábio de Souza Villaça Medeiros
+//
+// This file is part of the Rak Project.
+// For detailed license information, please refer to the LICENSE file
+// located in the root directory of this project.
+//
+
+#include "rak/arena.h"
+
+struct RakArenaChunk;
+
+typedef union Header
+{
+  struct
+  {
+    struct RakArenaChunk *chunk;
+    size_t                size;
+  };
+  max_align_t align;
+} Header;
+
+#define NUM_CLASSES (RAK_ARENA_MAX_SIZE / sizeof(Header) + 2)
+
+typedef struct RakArenaChunk
+{
+  RakArena             *arena;
+  struct RakArenaChunk *prev;
+  struct RakArenaChunk *next;
+  char                 *top;
+  int                   live;
+  size_t                used;
+  Header               *free[NUM_CLASSES];
+} Chunk;
+
+#define chunk_data(c) ((char *) (c) + align_size(sizeof(Chunk)))
+#define chunk_end(c)  ((char *) (c) + RAK_ARENA_CHUNK_SIZE)
+#define next_free(h)  (*(Header **) &(h)[1])
+
+#define ORPHAN_MAX_USED (RAK_ARENA_CHUNK_SIZE / 2)
+
+static RakArena *current = NULL;
+static RakArena orphans = { .chunks = NULL, .spare = NULL, .nchunks = 0 };
+
+static inline size_t align_size(size_t size);
+static inline Header *take_block(Chunk *chunk, size_t total);
+static Chunk *new_chunk(RakArena *arena, RakError *err);
+static Chunk *adopt_chunk(RakArena *arena);
+static void reset_chunk(Chunk *chunk);
+static void link_chunk(RakArena *arena, Chunk *chunk);
+static void unlink_chunk(RakArena *arena, Chunk *chunk);
+static void orphan_chunk(Chunk *chunk);
+
+static inline size_t align_size(size_t size)
+{
+  size_t align = sizeof(Header);
+  return (size + align - 1) / align * align;
+}
+
+static inline Header *take_block(Chunk *chunk, size_t total)
+{
+  size_t cls = total / sizeof(Header);
+  Header *hdr = chunk->free[cls];
+  if (hdr)
+  {
+    chunk->free[cls] = next_free(hdr);
+    return hdr;
+  }
+  if (chunk->top + total > chunk_end(chunk)) return NULL;
+  hdr = (Header *) chunk->top;
+  hdr->chunk = chunk;
+  hdr->size = total;
+  chunk->top += total;
+  return hdr;
+}
+
+static Chunk *new_chunk(RakArena *arena, RakError *err)
+{
+  Chunk *chunk = arena->spare;
+  if (chunk)
+    arena->spare = NULL;
+  else
+  {
+    if (arena->nchunks == RAK_ARENA_MAX_CHUNKS) return NULL;
+    chunk = adopt_chunk(arena);
+    if (chunk) return chunk;
+    chunk = rak_memory_alloc(RAK_ARENA_CHUNK_SIZE, err);
+    if (!rak_is_ok(err)) return NULL;
+    ++arena->nchunks;
+  }
+  reset_chunk(chunk);
+  link_chunk(arena, chunk);
+  return chunk;
+}
+
+static Chunk *adopt_chunk(RakArena *arena)
+{
+  // A chunk left behind by a dead fiber is mostly free slots around its survivors, so
+  // the next arena fills them instead of every fiber pinning a chunk of its own.
+  Chunk *chunk = orphans.chunks;
+  if (!chunk) return NULL;
+  unlink_chunk(&orphans, chunk);
+  link_chunk(arena, chunk);
+  ++arena->nchunks;
+  return chunk;
+}
+
+static void reset_chunk(Chunk *chunk)
+{
+  chunk->top = chunk_data(chunk);
+  chunk->live = 0;
+  chunk->used = 0;
+  for (size_t i = 0; i < NUM_CLASSES; ++i)
+    chunk->free[i] = NULL;
+}
+
+static void link_chunk(RakArena *arena, Chunk *chunk)
+{
+  chunk->arena = arena;
+  chunk->prev = NULL;
+  chunk->next = arena->chunks;
+  if (arena->chunks) arena->chunks->prev = chunk;
+  arena->chunks = chunk;
+}
+
+static void unlink_chunk(RakArena *arena, Chunk *chunk)
+{
+  if (chunk->prev)
+    chunk->prev->next = chunk->next;
+  else
+    arena->chunks = chunk->next;
+  if (chunk->next) chunk->next->prev = chunk->prev;
+}
+
+static void orphan_chunk(Chunk *chunk)
+{
+  if (chunk->used > ORPHAN_MAX_USED)
+  {
+    chunk->arena = NULL;
+    return;
+  }
+  link_chunk(&orphans, chunk);
+}
+
+void rak_arena_init(RakArena *arena)
+{
+  arena->chunks = NULL;
+  arena->spare = NULL;
+  arena->nchunks = 0;
+}
+
+void rak_arena_deinit(RakArena *arena)
+{
+  Chunk *chunk = arena->chunks;
+  while (chunk)
+  {
+    Chunk *next = chunk->next;
+    // Chunks holding objects that escaped the fiber are freed by their last object.
+    if (chunk->live)
+      orphan_chunk(chunk);
+    else
+      rak_memory_free(chunk);
+    chunk = next;
+  }
+  if (arena->spare) rak_memory_free(arena->spare);
+  rak_arena_init(arena);
+}
+
+void *rak_arena_alloc(RakArena *arena, size_t size, RakError *err)
+{
+  if (size > RAK_ARENA_MAX_SIZE) return NULL;
+  size_t total = sizeof(Header) + align_size(size);
+  Chunk *chunk = arena->chunks;
+  Header *hdr = chunk ? take_block(chunk, total) : NULL;
+  if (!hdr)
+  {
+    chunk = new_chunk(arena, err);
+    if (!chunk) return NULL;
+    hdr = take_block(chunk, total);
+    if (!hdr) return NULL;
+  }
+  ++chunk->live;
+  chunk->used += total;
+  return &hdr[1];
+}
+
+void rak_arena_free(void *ptr)
+{
+  Header *hdr = &((Header *) ptr)[-1];
+  Chunk *chunk = hdr->chunk;
+  --chunk->live;
+  chunk->used -= hdr->size;
+  RakArena *arena = chunk->arena;
+  if (chunk->live)
+  {
+    if (!arena) return;
+    size_t cls = hdr->size / sizeof(Header);
+    next_free(hdr) = chunk->free[cls];
+    chunk->free[cls] = hdr;
+    return;
+  }
+  if (!arena)
+  {
+    rak_memory_free(chunk);
+    return;
+  }
+  if (arena == &orphans)
+  {
+    unlink_chunk(arena, chunk);
+    rak_memory_free(chunk);
+    return;
+  }
+  if (chunk == arena->chunks)
+  {
+    reset_chunk(chunk);
+    return;
+  }
+  unlink_chunk(arena, chunk);
+  if (!arena->spare)
+  {
+    arena->spare = chunk;
+    return;
+  }
+  rak_memory_free(chunk);
+  --arena->nchunks;
+}
+
+RakArena *rak_arena_current(void)
+{
+  return current;
+}
+
+void rak_arena_set_current(RakArena *arena)
+{
+  current = arena;
+}
+
+void *rak_arena_alloc_object(size_t size, RakError *err)
+{
+#ifdef RAK_FIBER_ARENA
+  if (current)
+  {
+    void *ptr = rak_arena_alloc(current, size, err);
+    if (ptr || !rak_is_ok(err)) return ptr;
+  }
+  Header *hdr = rak_memory_alloc(sizeof(*hdr) + size, err);
+  if (!rak_is_ok(err)) return NULL;
+  hdr->chunk = NULL;
+  return &hdr[1];
+#else
+  return rak_memory_alloc(size, err);
+#endif
+}
+
+void rak_arena_free_object(void *ptr)
+{
+#ifdef RAK_FIBER_ARENA
+  Header *hdr = &((Header *) ptr)[-1];
+  if (hdr->chunk)
+  {
+    rak_arena_free(ptr);
+    return;
+  }
+  rak_memory_free(hdr);
+#else
+  rak_memory_free(ptr);
+#endif
+}
@@ -10,6 +10,8 @@
 
 #include "rak/array.h"
 #include <stdio.h>
+#include "rak/arena.h"
+#include "rak/gc.h"
 
 static inline void release_elements(RakArray *arr);
 
@@ -27,12 +29,16 @@ void rak_array_init(RakArray *arr, RakError *err)
 {
   rak_object_init(&arr->obj);
   rak_slice_init(&arr->slice, err);
+  if (!rak_is_ok(err)) return;
+  rak_memory_track_object(RAK_TYPE_ARRAY, 1);
 }
 
 void rak_array_init_with_capacity(RakArray *arr, int cap, RakError *err)
 {
   rak_object_init(&arr->obj);
   rak_slice_init_with_capacity(&arr->slice, cap, err);
+  if (!rak_is_ok(err)) return;
+  rak_memory_track_object(RAK_TYPE_ARRAY, 1);
 }
 
 void rak_array_init_from_values(RakArray *arr, int len, RakValue *values, RakError *err)
@@ -59,59 +65,66 @@ void rak_array_deinit(RakArray *arr)
 {
   release_elements(arr);
   rak_slice_deinit(&arr->slice);
+  rak_memory_track_object(RAK_TYPE_ARRAY, -1);
 }
 
 RakArray *rak_array_new(RakError *err)
 {
-  RakArray *arr = rak_memory_alloc(sizeof(*arr), err);
+  RakArray *arr = rak_arena_alloc_object(sizeof(*arr), err);
   if (!rak_is_ok(err)) return NULL;
   rak_array_init(arr, err);
   if (rak_is_ok(err)) return arr;
-  rak_memory_free(arr);
+  rak_arena_free_object(arr);
   return NULL;
 }
 
 RakArray *rak_array_new_with_capacity(int cap, RakError *err)
 {
-  RakArray *arr = rak_memory_alloc(sizeof(*arr), err);
+  RakArray *arr = rak_arena_alloc_object(sizeof(*arr), err);
   if (!rak_is_ok(err)) return NULL;
   rak_array_init_with_capacity(arr, cap, err);
   if (rak_is_ok(err)) return arr;
-  rak_memory_free(arr);
+  rak_arena_free_object(arr);
   return NULL;
 }
 
 RakArray *rak_array_new_from_values(int len, RakValue *values, RakError *err)
 {
-  RakArray *arr = rak_memory_alloc(sizeof(*arr), err);
+  RakArray *arr = rak_arena_alloc_object(sizeof(*arr), err);
   if (!rak_is_ok(err)) return NULL;
   rak_array_init_from_values(arr, len, values, err);
   if (rak_is_ok(err)) return arr;
-  rak_memory_free(arr);
+  rak_arena_free_object(arr);
   return NULL;
 }
 
 RakArray *rak_array_new_copy(RakArray *arr, RakError *err)
 {
-  RakArray *_arr = rak_memory_alloc(sizeof(*_arr), err);
+  RakArray *_arr = rak_arena_alloc_object(sizeof(*_arr), err);
   if (!rak_is_ok(err)) return NULL;
   rak_array_init_copy(_arr, arr, err);
   if (rak_is_ok(err)) return _arr;
-  rak_memory_free(_arr);
+  rak_arena_free_object(_arr);
   return NULL;
 }
 
 void rak_array_free(RakArray *arr)
 {
+  rak_gc_forget(&arr->obj);
   rak_array_deinit(arr);
-  rak_memory_free(arr);
+  rak_arena_free_object(arr);
 }
 
 void rak_array_release(RakArray *arr)
 {
   RakObject *obj = &arr->obj;
   --obj->refCount;
-  if (obj->refCount) return;
+  if (obj->refCount)
+  {
+    rak_gc_possible_root(rak_array_value(arr));
+    return;
+  }
+  if (rak_gc_deferred(rak_array_value(arr))) return;
   rak_array_free(arr);
 }
 
@@ -12,7 +12,9 @@
 #include <float.h>
 #include <stdio.h>
 #include <string.h>
+#include "rak/gc.h"
 #include "rak/native.h"
+#include "rak/number.h"
 #include "rak/vm.h"
 
 static const char *globals[] = {
@@ -58,11 +60,21 @@ static const char *globals[] = {
   "resume",
   "print",
   "println",
-  "panic"
+  "panic",
+  "collect",
+  "mem_stats",
+  "find",
+  "contains",
+  "split",
+  "count",
+  "replace",
+  "to_string"
 };
 
 static inline void append_native_function(RakArray *arr, const char *name, int arity,
   RakNativeFunctionCall call, RakError *err);
+static inline void put_field(RakRecord *rec, const char *name, RakValue val, RakError *err);
+static inline bool check_strings(RakValue *slots, int n, RakError *err);
 
 static void type_native_call(RakFiber *fiber, RakClosure *cl, void *state, RakValue *slots, RakError *err);
 static void is_nil_native_call(RakFiber *fiber, RakClosure *cl, void *state, RakValue *slots, RakError *err);
@@ -92,6 +104,14 @@ static void resume_native_call(RakFiber *fiber, RakClosure *cl, void *state, Rak
 static void print_native_call(RakFiber *fiber, RakClosure *cl, void *state, RakValue *slots, RakError *err);
 static void println_native_call(RakFiber *fiber, RakClosure *cl, void *state, RakValue *slots, RakError *err);
 static void panic_native_call(RakFiber *fiber, RakClosure *cl, void *state, RakValue *slots, RakError *err);
+static void collect_native_call(RakFiber *fiber, RakClosure *cl, void *state, RakValue *slots, RakError *err);
+static void mem_stats_native_call(RakFiber *fiber, RakClosure *cl, void *state, RakValue *slots, RakError *err);
+static void find_native_call(RakFiber *fiber, RakClosure *cl, void *state, RakValue *slots, RakError *err);
+static void contains_native_call(RakFiber *fiber, RakClosure *cl, void *state, RakValue *slots, RakError *err);
+static void split_native_call(RakFiber *fiber, RakClosure *cl, void *state, RakValue *slots, RakError *err);
+static void count_native_call(RakFiber *fiber, RakClosure *cl, void *state, RakValue *slots, RakError *err);
+static void replace_native_call(RakFiber *fiber, RakClosure *cl, void *state, RakValue *slots, RakError *err);
+static void to_string_native_call(RakFiber *fiber, RakClosure *cl, void *state, RakValue *slots, RakError *err);
 
 static inline void append_native_function(RakArray *arr, const char *name, int arity,
   RakNativeFunctionCall call, RakError *err)
@@ -111,15 +131,44 @@ static inline void append_native_function(RakArray *arr, const char *name, int a
     return;
   }
   rak_array_inplace_append(arr, rak_closure_value(cl), err);
-  if (rak_is_ok(err)) return;
-  rak_closure_free(cl);
+  if (!rak_is_ok(err))
+  {
+    rak_closure_free(cl);
+    return;
+  }
+  rak_gc_make_immortal(&arr->slice.data[rak_array_len(arr) - 1]);
+}
+
+static inline void put_field(RakRecord *rec, const char *name, RakValue val, RakError *err)
+{
+  RakString *_name = rak_string_new_from_cstr(-1, name, err);
+  if (!rak_is_ok(err)) return;
+  RakString *str = rak_string_intern(_name, err);
+  if (str != _name) rak_string_free(_name);
+  if (!rak_is_ok(err)) return;
+  rak_object_retain(&str->obj);
+  rak_record_inplace_put(rec, str, val, err);
+  rak_string_release(str);
+}
+
+static inline bool check_strings(RakValue *slots, int n, RakError *err)
+{
+  for (int i = 1; i <= n; ++i)
+  {
+    RakValue val = slots[i];
+    if (rak_is_string(val)) continue;
+    rak_error_set(err, "argument #%d must be a string, got %s", i,
+      rak_type_to_cstr(rak_type_of(val)));
+    return false;
+  }
+  return true;
 }
 
 static void type_native_call(RakFiber *fiber, RakClosure *cl, void *state, RakValue *slots, RakError *err)
 {
   (void) state;
   RakValue val = slots[1];
-  rak_fiber_push_number(fiber, val.type, err);
+  rak_fiber_push_number(fiber, rak_type_of(val), err);
   if (!rak_is_ok(err)) return;
   rak_fiber_return(fiber, cl, slots);
 }
@@ -246,7 +295,7 @@ static void ptr_native_call(RakFiber *fiber, RakClosure *cl, void *state, RakVal
 {
   (void) state;
   RakValue val = slots[1];
-  void *ptr = rak_is_object(val) ? val.opaque.ptr : NULL;
+  void *ptr = rak_is_object(val) ? rak_as_ptr(val) : NULL;
   rak_fiber_push_number(fiber, (double) (uintptr_t) ptr, err);
   if (!rak_is_ok(err)) return;
   rak_fiber_return(fiber, cl, slots);
@@ -256,7 +305,7 @@ static void ref_count_native_call(RakFiber *fiber, RakClosure *cl, void *state,
 {
   (void) state;
   RakValue val = slots[1];
-  int refCount = rak_is_object(val) ? rak_as_object(val)->refCount : -1;
+  int refCount = rak_is_refcounted(val) ? rak_as_object(val)->refCount : -1;
   rak_fiber_push_number(fiber, refCount, err);
   if (!rak_is_ok(err)) return;
   rak_fiber_return(fiber, cl, slots);
@@ -279,7 +328,7 @@ static void array_native_call(RakFiber *fiber, RakClosure *cl, void *state, RakV
   if (!rak_is_number(val2) || !rak_is_integer(val2))
   {
     rak_error_set(err, "argument #2 must be nil or an integer number, got %s",
-      rak_type_to_cstr(val2.type));
+      rak_type_to_cstr(rak_type_of(val2)));
     return;
   }
   int len = (int) rak_as_number(val2);
@@ -300,7 +349,7 @@ static void array_native_call(RakFiber *fiber, RakClosure *cl, void *state, RakV
   if (!rak_is_number(val3) || !rak_is_integer(val3))
   {
     rak_error_set(err, "argument #3 must be nil or an integer number, got %s",
-      rak_type_to_cstr(val3.type));
+      rak_type_to_cstr(rak_type_of(val3)));
     return;
   }
   int cap = (int) rak_as_number(val3);
@@ -322,7 +371,7 @@ static void append_native_call(RakFiber *fiber, RakClosure *cl, void *state, Rak
   if (!rak_is_ref(val1))
   {
     rak_error_set(err, "argument #1 must be a reference to an array, got %s",
-      rak_type_to_cstr(val1.type));
+      rak_type_to_cstr(rak_type_of(val1)));
     return;
   }
   RakValue *slot = rak_as_ref(val1);
@@ -330,7 +379,7 @@ static void append_native_call(RakFiber *fiber, RakClosure *cl, void *state, Rak
   if (!rak_is_array(_val1))
   {
     rak_error_set(err, "argument #1 must be a reference to an array, got a reference to %s",
-      rak_type_to_cstr(_val1.type));
+      rak_type_to_cstr(rak_type_of(_val1)));
     return;
   }
   RakArray *arr = rak_as_array(_val1);
@@ -383,7 +432,7 @@ static void cap_native_call(RakFiber *fiber, RakClosure *cl, void *state, RakVal
     rak_fiber_return(fiber, cl, slots);
     return;
   }
-  rak_error_set(err, "%s does not have a capacity", rak_type_to_cstr(val.type));
+  rak_error_set(err, "%s does not have a capacity", rak_type_to_cstr(rak_type_of(val)));
 }
 
 static void len_native_call(RakFiber *fiber, RakClosure *cl, void *state, RakValue *slots, RakError *err)
@@ -408,8 +457,7 @@ static void len_native_call(RakFiber *fiber, RakClosure *cl, void *state, RakVal
   }
   if (rak_is_range(val))
   {
-    RakRange *rng = rak_as_range(val);
-    rak_fiber_push_number(fiber, rak_range_len(rng), err);
+    rak_fiber_push_number(fiber, rak_range_value_len(val), err);
     if (!rak_is_ok(err)) return;
     rak_fiber_return(fiber, cl, slots);
     return;
@@ -422,7 +470,7 @@ static void len_native_call(RakFiber *fiber, RakClosure *cl, void *state, RakVal
     rak_fiber_return(fiber, cl, slots);
     return;
   }
-  rak_error_set(err, "%s does not have a length", rak_type_to_cstr(val.type));
+  rak_error_set(err, "%s does not have a length", rak_type_to_cstr(rak_type_of(val)));
 }
 
 static void is_empty_native_call(RakFiber *fiber, RakClosure *cl, void *state, RakValue *slots, RakError *err)
@@ -445,6 +493,13 @@ static void is_empty_native_call(RakFiber *fiber, RakClosure *cl, void *state, R
     rak_fiber_return(fiber, cl, slots);
     return;
   }
+  if (rak_is_range(val))
+  {
+    rak_fiber_push_bool(fiber, !rak_range_value_len(val), err);
+    if (!rak_is_ok(err)) return;
+    rak_fiber_return(fiber, cl, slots);
+    return;
+  }
   if (rak_is_record(val))
   {
     RakRecord *rec = rak_as_record(val);
@@ -453,7 +508,7 @@ static void is_empty_native_call(RakFiber *fiber, RakClosure *cl, void *state, R
     rak_fiber_return(fiber, cl, slots);
     return;
   }
-  rak_error_set(err, "%s does not have a length", rak_type_to_cstr(val.type));
+  rak_error_set(err, "%s does not have a length", rak_type_to_cstr(rak_type_of(val)));
 }
 
 static void fiber_native_call(RakFiber *fiber, RakClosure *cl, void *state, RakValue *slots, RakError *err)
@@ -464,7 +519,7 @@ static void fiber_native_call(RakFiber *fiber, RakClosure *cl, void *state, RakV
   if (!rak_is_closure(val1))
   {
     rak_error_set(err, "argument #1 must be a closure, got %s",
-      rak_type_to_cstr(val1.type));
+      rak_type_to_cstr(rak_type_of(val1)));
     return;
   }
   RakClosure *_cl = rak_as_closure(val1);
@@ -474,7 +529,7 @@ static void fiber_native_call(RakFiber *fiber, RakClosure *cl, void *state, RakV
   if (!rak_is_array(val2))
   {
     rak_error_set(err, "argument #2 must be nil or an array, got %s",
-      rak_type_to_cstr(val2.type));
+      rak_type_to_cstr(rak_type_of(val2)));
     return;
   }
   RakArray *arr = rak_as_array(val2);
@@ -508,7 +563,7 @@ static void is_suspended_native_call(RakFiber *fiber, RakClosure *cl, void *stat
   if (!rak_is_fiber(val))
   {
     rak_error_set(err, "argument #1 must be a fiber, got %s",
-      rak_type_to_cstr(val.type));
+      rak_type_to_cstr(rak_type_of(val)));
     return;
   }
   RakFiber *_fiber = rak_as_fiber(val);
@@ -524,7 +579,7 @@ static void is_done_native_call(RakFiber *fiber, RakClosure *cl, void *state, Ra
   if (!rak_is_fiber(val))
   {
     rak_error_set(err, "argument #1 must be a fiber, got %s",
-      rak_type_to_cstr(val.type));
+      rak_type_to_cstr(rak_type_of(val)));
     return;
   }
   RakFiber *_fiber = rak_as_fiber(val);
@@ -540,7 +595,7 @@ static void resume_native_call(RakFiber *fiber, RakClosure *cl, void *state, Rak
   if (!rak_is_fiber(val))
   {
     rak_error_set(err, "argument #1 must be a fiber, got %s",
-      rak_type_to_cstr(val.type));
+      rak_type_to_cstr(rak_type_of(val)));
     return;
   }
   RakFiber *_fiber = rak_as_fiber(val);
@@ -586,7 +641,7 @@ static void panic_native_call(RakFiber *fiber, RakClosure *cl, void *state, RakV
   if (!rak_is_string(val))
   {
     rak_error_set(err, "argument #1 must be a string, got %s",
-      rak_type_to_cstr(val.type));
+      rak_type_to_cstr(rak_type_of(val)));
     return;
   }
   RakString *str = rak_as_string(val);
@@ -594,6 +649,191 @@ static void panic_native_call(RakFiber *fiber, RakClosure *cl, void *state, RakV
   rak_fiber_return(fiber, cl, slots);
 }
 
+static void collect_native_call(RakFiber *fiber, RakClosure *cl, void *state, RakValue *slots, RakError *err)
+{
+  (void) state;
+  int n = rak_gc_collect();
+#ifdef RAK_CYCLE_COLLECTOR
+  rak_fiber_push_number(fiber, n, err);
+#else
+  (void) n;
+  rak_fiber_push_nil(fiber, err);
+#endif
+  if (!rak_is_ok(err)) return;
+  rak_fiber_return(fiber, cl, slots);
+}
+
+static void mem_stats_native_call(RakFiber *fiber, RakClosure *cl, void *state, RakValue *slots, RakError *err)
+{
+  (void) state;
+  RakMemoryStats stats = rak_memory_stats();
+  RakRecord *objects = rak_record_new(err);
+  if (!rak_is_ok(err)) return;
+  for (RakType type = RAK_TYPE_STRING; type <= RAK_TYPE_FIBER; ++type)
+  {
+    RakValue val = rak_number_value((double) stats.objects[type]);
+    put_field(objects, rak_type_to_cstr(type), val, err);
+    if (!rak_is_ok(err))
+    {
+      rak_record_free(objects);
+      return;
+    }
+  }
+  RakRecord *rec = rak_record_new(err);
+  if (!rak_is_ok(err))
+  {
+    rak_record_free(objects);
+    return;
+  }
+  put_field(rec, "live", rak_number_value((double) stats.live), err);
+  if (!rak_is_ok(err)) goto fail;
+  put_field(rec, "peak", rak_number_value((double) stats.peak), err);
+  if (!rak_is_ok(err)) goto fail;
+  put_field(rec, "limit", rak_number_value((double) stats.limit), err);
+  if (!rak_is_ok(err)) goto fail;
+  put_field(rec, "allocs", rak_number_value((double) stats.allocs), err);
+  if (!rak_is_ok(err)) goto fail;
+  put_field(rec, "frees", rak_number_value((double) stats.frees), err);
+  if (!rak_is_ok(err)) goto fail;
+  put_field(rec, "objects", rak_record_value(objects), err);
+  if (!rak_is_ok(err)) goto fail;
+  rak_fiber_push_object(fiber, rak_record_value(rec), err);
+  if (!rak_is_ok(err))
+  {
+    rak_record_free(rec);
+    return;
+  }
+  rak_fiber_return(fiber, cl, slots);
+  return;
+fail:
+  rak_record_free(rec);
+  rak_record_free(objects);
+}
+
+static void find_native_call(RakFiber *fiber, RakClosure *cl, void *state, RakValue *slots, RakError *err)
+{
+  (void) state;
+  if (!check_strings(slots, 2, err)) return;
+  RakString *str = rak_as_string(slots[1]);
+  RakString *sub = rak_as_string(slots[2]);
+  rak_fiber_push_number(fiber, rak_string_find(str, sub, 0), err);
+  if (!rak_is_ok(err)) return;
+  rak_fiber_return(fiber, cl, slots);
+}
+
+static void contains_native_call(RakFiber *fiber, RakClosure *cl, void *state, RakValue *slots, RakError *err)
+{
+  (void) state;
+  if (!check_strings(slots, 2, err)) return;
+  RakString *str = rak_as_string(slots[1]);
+  RakString *sub = rak_as_string(slots[2]);
+  rak_fiber_push_bool(fiber, rak_string_find(str, sub, 0) >= 0, err);
+  if (!rak_is_ok(err)) return;
+  rak_fiber_return(fiber, cl, slots);
+}
+
+static void split_native_call(RakFiber *fiber, RakClosure *cl, void *state, RakValue *slots, RakError *err)
+{
+  (void) state;
+  if (!check_strings(slots, 2, err)) return;
+  RakString *str = rak_as_string(slots[1]);
+  RakString *sep = rak_as_string(slots[2]);
+  if (rak_string_is_empty(sep))
+  {
+    rak_error_set(err, "argument #2 must not be an empty string");
+    return;
+  }
+  RakArray *arr = rak_array_new_with_capacity(rak_string_count(str, sep) + 1, err);
+  if (!rak_is_ok(err)) return;
+  int len = rak_string_len(sep);
+  int start = 0;
+  for (;;)
+  {
+    int idx = rak_string_find(str, sep, start);
+    int end = idx < 0 ? rak_string_len(str) : idx;
+    RakString *part = rak_string_slice(str, start, end, err);
+    if (!rak_is_ok(err)) goto fail;
+    rak_array_inplace_append(arr, rak_string_value(part), err);
+    if (!rak_is_ok(err))
+    {
+      rak_string_free(part);
+      goto fail;
+    }
+    if (idx < 0) break;
+    start = idx + len;
+  }
+  rak_fiber_push_object(fiber, rak_array_value(arr), err);
+  if (!rak_is_ok(err)) goto fail;
+  rak_fiber_return(fiber, cl, slots);
+  return;
+fail:
+  rak_array_free(arr);
+}
+
+static void count_native_call(RakFiber *fiber, RakClosure *cl, void *state, RakValue *slots, RakError *err)
+{
+  (void) state;
+  if (!check_strings(slots, 2, err)) return;
+  RakString *str = rak_as_string(slots[1]);
+  RakString *sub = rak_as_string(slots[2]);
+  rak_fiber_push_number(fiber, rak_string_count(str, sub), err);
+  if (!rak_is_ok(err)) return;
+  rak_fiber_return(fiber, cl, slots);
+}
+
+static void replace_native_call(RakFiber *fiber, RakClosure *cl, void *state, RakValue *slots, RakError *err)
+{
+  (void) state;
+  if (!check_strings(slots, 3, err)) return;
+  RakString *str = rak_as_string(slots[1]);
+  RakString *sub = rak_as_string(slots[2]);
+  RakString *rep = rak_as_string(slots[3]);
+  if (rak_string_is_empty(sub))
+  {
+    rak_error_set(err, "argument #2 must not be an empty string");
+    return;
+  }
+  RakString *_str = rak_string_replace(str, sub, rep, err);
+  if (!rak_is_ok(err)) return;
+  if (_str == str)
+  {
+    rak_fiber_push_value(fiber, slots[1], err);
+    if (!rak_is_ok(err)) return;
+    rak_fiber_return(fiber, cl, slots);
+    return;
+  }
+  rak_fiber_push_object(fiber, rak_string_value(_str), err);
+  if (!rak_is_ok(err))
+  {
+    rak_string_free(_str);
+    return;
+  }
+  rak_fiber_return(fiber, cl, slots);
+}
+
+static void to_string_native_call(RakFiber *fiber, RakClosure *cl, void *state, RakValue *slots, RakError *err)
+{
+  (void) state;
+  RakValue val = slots[1];
+  if (!rak_is_number(val))
+  {
+    rak_error_set(err, "argument #1 must be a number, got %s",
+      rak_type_to_cstr(rak_type_of(val)));
+    return;
+  }
+  char buf[RAK_NUMBER_MAX_CHARS];
+  int len = rak_number_format(rak_as_number(val), buf);
+  RakString *str = rak_string_new_from_cstr(len, buf, err);
+  if (!rak_is_ok(err)) return;
+  rak_fiber_push_object(fiber, rak_string_value(str), err);
+  if (!rak_is_ok(err))
+  {
+    rak_string_free(str);
+    return;
+  }
+  rak_fiber_return(fiber, cl, slots);
+}
+
 RakArray *rak_builtin_globals(RakError *err)
 {
   int len = (int) (sizeof(globals) / sizeof(*globals));
@@ -685,6 +925,22 @@ RakArray *rak_builtin_globals(RakError *err)
   if (!rak_is_ok(err)) return NULL;
   append_native_function(arr, globals[42], 1, panic_native_call, err);
   if (!rak_is_ok(err)) return NULL;
+  append_native_function(arr, globals[43], 0, collect_native_call, err);
+  if (!rak_is_ok(err)) return NULL;
+  append_native_function(arr, globals[44], 0, mem_stats_native_call, err);
+  if (!rak_is_ok(err)) return NULL;
+  append_native_function(arr, globals[45], 2, find_native_call, err);
+  if (!rak_is_ok(err)) return NULL;
+  append_native_function(arr, globals[46], 2, contains_native_call, err);
+  if (!rak_is_ok(err)) return NULL;
+  append_native_function(arr, globals[47], 2, split_native_call, err);
+  if (!rak_is_ok(err)) return NULL;
+  append_native_function(arr, globals[48], 2, count_native_call, err);
+  if (!rak_is_ok(err)) return NULL;
+  append_native_function(arr, globals[49], 3, replace_native_call, err);
+  if (!rak_is_ok(err)) return NULL;
+  append_native_function(arr, globals[50], 1, to_string_native_call, err);
+  if (!rak_is_ok(err)) return NULL;
   return arr;
 }
 
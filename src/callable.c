@@ -17,6 +17,7 @@ void rak_callable_init(RakCallable *callable, RakString *name, int arity,
   callable->name = name;
   if (name) rak_object_retain(&name->obj);
   callable->arity = arity;
+  callable->stackSize = arity + 1 + RAK_CALLABLE_STACK_RESERVE;
   rak_slice_init(&callable->inouts, err);
 }
 
@@ -9,8 +9,12 @@
 //
 
 #include "rak/chunk.h"
+#include "rak/gc.h"
 
 static inline void release_consts(RakChunk *chunk);
+static inline void release_caches(RakChunk *chunk);
+static inline int stack_effect(uint32_t instr);
+static inline bool merge_depth(int *depths, int off, int depth);
 
 static inline void release_consts(RakChunk *chunk)
 {
@@ -22,74 +26,233 @@ static inline void release_consts(RakChunk *chunk)
   }
 }
 
+static inline void release_caches(RakChunk *chunk)
+{
+  int len = chunk->caches.len;
+  for (int i = 0; i < len; ++i)
+  {
+    RakShape *shape = rak_slice_get(&chunk->caches, i).shape;
+    if (!shape) continue;
+    rak_shape_release(shape);
+  }
+}
+
+static inline int stack_effect(uint32_t instr)
+{
+  int n = 0;
+  switch (rak_instr_opcode(instr))
+  {
+  case RAK_OP_NOP:
+  case RAK_OP_MOVE:
+  case RAK_OP_GET_FIELD:
+  case RAK_OP_JUMP:
+  case RAK_OP_EQ_LOCALS_JUMP_IF_FALSE:
+  case RAK_OP_EQ_CONST_JUMP_IF_FALSE:
+  case RAK_OP_EQ_INT_JUMP_IF_FALSE:
+  case RAK_OP_NE_LOCALS_JUMP_IF_FALSE:
+  case RAK_OP_NE_CONST_JUMP_IF_FALSE:
+  case RAK_OP_NE_INT_JUMP_IF_FALSE:
+  case RAK_OP_GT_LOCALS_JUMP_IF_FALSE:
+  case RAK_OP_GT_CONST_JUMP_IF_FALSE:
+  case RAK_OP_GT_INT_JUMP_IF_FALSE:
+  case RAK_OP_GE_LOCALS_JUMP_IF_FALSE:
+  case RAK_OP_GE_CONST_JUMP_IF_FALSE:
+  case RAK_OP_GE_INT_JUMP_IF_FALSE:
+  case RAK_OP_LT_LOCALS_JUMP_IF_FALSE:
+  case RAK_OP_LT_CONST_JUMP_IF_FALSE:
+  case RAK_OP_LT_INT_JUMP_IF_FALSE:
+  case RAK_OP_LE_LOCALS_JUMP_IF_FALSE:
+  case RAK_OP_LE_CONST_JUMP_IF_FALSE:
+  case RAK_OP_LE_INT_JUMP_IF_FALSE:
+  case RAK_OP_ADD3:
+  case RAK_OP_SUB3:
+  case RAK_OP_MUL3:
+  case RAK_OP_DIV3:
+  case RAK_OP_MOD3:
+  case RAK_OP_NOT:
+  case RAK_OP_NEG:
+  case RAK_OP_TAIL_CALL:
+  case RAK_OP_RETURN:
+  case RAK_OP_ADD3_NUM:
+    break;
+  case RAK_OP_PUSH_NIL:
+  case RAK_OP_PUSH_FALSE:
+  case RAK_OP_PUSH_TRUE:
+  case RAK_OP_PUSH_INT:
+  case RAK_OP_LOAD_CONST:
+  case RAK_OP_LOAD_GLOBAL:
+  case RAK_OP_LOAD_LOCAL:
+  case RAK_OP_FETCH_LOCAL:
+  case RAK_OP_REF_LOCAL:
+  case RAK_OP_LOAD_LOCAL_REF:
+  case RAK_OP_NEW_CLOSURE:
+  case RAK_OP_LOAD_ELEMENT:
+  case RAK_OP_FETCH_ELEMENT:
+  case RAK_OP_ADD2:
+  case RAK_OP_SUB2:
+  case RAK_OP_MUL2:
+  case RAK_OP_DIV2:
+  case RAK_OP_MOD2:
+  case RAK_OP_RETURN_NIL:
+  case RAK_OP_ADD2_NUM:
+    n = 1;
+    break;
+  case RAK_OP_LOAD_FIELD:
+  case RAK_OP_FETCH_FIELD:
+    n = 2;
+    break;
+  case RAK_OP_STORE_LOCAL:
+  case RAK_OP_STORE_LOCAL_REF:
+  case RAK_OP_NEW_RANGE:
+  case RAK_OP_POP:
+  case RAK_OP_GET_ELEMENT:
+  case RAK_OP_PUT_FIELD:
+  case RAK_OP_UNPACK_ELEMENTS:
+  case RAK_OP_UNPACK_FIELDS:
+  case RAK_OP_JUMP_IF_FALSE:
+  case RAK_OP_JUMP_IF_FALSE_OR_POP:
+  case RAK_OP_JUMP_IF_TRUE_OR_POP:
+  case RAK_OP_EQ:
+  case RAK_OP_NE:
+  case RAK_OP_GT:
+  case RAK_OP_GE:
+  case RAK_OP_LT:
+  case RAK_OP_LE:
+  case RAK_OP_ADD:
+  case RAK_OP_SUB:
+  case RAK_OP_MUL:
+  case RAK_OP_DIV:
+  case RAK_OP_MOD:
+  case RAK_OP_YIELD:
+  case RAK_OP_EQ_NUM:
+  case RAK_OP_NE_NUM:
+  case RAK_OP_GT_NUM:
+  case RAK_OP_GE_NUM:
+  case RAK_OP_LT_NUM:
+  case RAK_OP_LE_NUM:
+  case RAK_OP_ADD_NUM:
+    n = -1;
+    break;
+  case RAK_OP_SET_ELEMENT:
+  case RAK_OP_UPDATE_ELEMENT:
+  case RAK_OP_UPDATE_FIELD:
+    n = -2;
+    break;
+  case RAK_OP_NEW_ARRAY:
+    n = 1 - rak_instr_a(instr);
+    break;
+  case RAK_OP_NEW_RECORD:
+    n = 1 - (rak_instr_a(instr) << 1);
+    break;
+  case RAK_OP_CALL:
+    n = - rak_instr_a(instr);
+    break;
+  }
+  return n;
+}
+
+static inline bool merge_depth(int *depths, int off, int depth)
+{
+  if (depth <= depths[off]) return false;
+  depths[off] = depth;
+  return true;
+}
+
 const char *rak_opcode_to_cstr(RakOpcode op)
 {
   char *cstr = NULL;
   switch (op)
   {
-  case RAK_OP_NOP:                  cstr = "NOP";                  break;
-  case RAK_OP_PUSH_NIL:             cstr = "PUSH_NIL";             break;
-  case RAK_OP_PUSH_FALSE:           cstr = "PUSH_FALSE";           break;
-  case RAK_OP_PUSH_TRUE:            cstr = "PUSH_TRUE";            break;
-  case RAK_OP_PUSH_INT:             cstr = "PUSH_INT";             break;
-  case RAK_OP_LOAD_CONST:           cstr = "LOAD_CONST";           break;
-  case RAK_OP_LOAD_GLOBAL:          cstr = "LOAD_GLOBAL";          break;
-  case RAK_OP_LOAD_LOCAL:           cstr = "LOAD_LOCAL";           break;
-  case RAK_OP_STORE_LOCAL:          cstr = "STORE_LOCAL";          break;
-  case RAK_OP_FETCH_LOCAL:          cstr = "FETCH_LOCAL";          break;
-  case RAK_OP_REF_LOCAL:            cstr = "REF_LOCAL";            break;
-  case RAK_OP_LOAD_LOCAL_REF:       cstr = "LOAD_LOCAL_REF";       break;
-  case RAK_OP_STORE_LOCAL_REF:      cstr = "STORE_LOCAL_REF";      break;
-  case RAK_OP_NEW_ARRAY:            cstr = "NEW_ARRAY";            break;
-  case RAK_OP_NEW_RANGE:            cstr = "NEW_RANGE";            break;
-  case RAK_OP_NEW_RECORD:           cstr = "NEW_RECORD";           break;
-  case RAK_OP_NEW_CLOSURE:          cstr = "NEW_CLOSURE";          break;
-  case RAK_OP_MOVE:                 cstr = "MOVE";                 break;
-  case RAK_OP_POP:                  cstr = "POP";                  break;
-  case RAK_OP_GET_ELEMENT:          cstr = "GET_ELEMENT";          break;
-  case RAK_OP_SET_ELEMENT:          cstr = "SET_ELEMENT";          break;
-  case RAK_OP_LOAD_ELEMENT:         cstr = "LOAD_ELEMENT";         break;
-  case RAK_OP_FETCH_ELEMENT:        cstr = "FETCH_ELEMENT";        break;
-  case RAK_OP_UPDATE_ELEMENT:       cstr = "UPDATE_ELEMENT";       break;
-  case RAK_OP_GET_FIELD:            cstr = "GET_FIELD";            break;
-  case RAK_OP_PUT_FIELD:            cstr = "PUT_FIELD";            break;
-  case RAK_OP_LOAD_FIELD:           cstr = "LOAD_FIELD";           break;
-  case RAK_OP_FETCH_FIELD:          cstr = "FETCH_FIELD";          break;
-  case RAK_OP_UPDATE_FIELD:         cstr = "UPDATE_FIELD";         break;
-  case RAK_OP_UNPACK_ELEMENTS:      cstr = "UNPACK_ELEMENTS";      break;
-  case RAK_OP_UNPACK_FIELDS:        cstr = "UNPACK_FIELDS";        break;
-  case RAK_OP_JUMP:                 cstr = "JUMP";                 break;
-  case RAK_OP_JUMP_IF_FALSE:        cstr = "JUMP_IF_FALSE";        break;
-  case RAK_OP_JUMP_IF_FALSE_OR_POP: cstr = "JUMP_IF_FALSE_OR_POP"; break;
-  case RAK_OP_JUMP_IF_TRUE_OR_POP:  cstr = "JUMP_IF_TRUE_OR_POP";  break;
-  case RAK_OP_EQ:                   cstr = "EQ";                   break;
-  case RAK_OP_NE:                   cstr = "NE";                   break;
-  case RAK_OP_GT:                   cstr = "GT";                   break;
-  case RAK_OP_GE:                   cstr = "GE";                   break;
-  case RAK_OP_LT:                   cstr = "LT";                   break;
-  case RAK_OP_LE:                   cstr = "LE";                   break;
-  case RAK_OP_ADD:                  cstr = "ADD";                  break;
-  case RAK_OP_ADD2:                 cstr = "ADD2";                 break;
-  case RAK_OP_ADD3:                 cstr = "ADD3";                 break;
-  case RAK_OP_SUB:                  cstr = "SUB";                  break;
-  case RAK_OP_SUB2:                 cstr = "SUB2";                 break;
-  case RAK_OP_SUB3:                 cstr = "SUB3";                 break;
-  case RAK_OP_MUL:                  cstr = "MUL";                  break;
-  case RAK_OP_MUL2:                 cstr = "MUL2";                 break;
-  case RAK_OP_MUL3:                 cstr = "MUL3";                 break;
-  case RAK_OP_DIV:                  cstr = "DIV";                  break;
-  case RAK_OP_DIV2:                 cstr = "DIV2";                 break;
-  case RAK_OP_DIV3:                 cstr = "DIV3";                 break;
-  case RAK_OP_MOD:                  cstr = "MOD";                  break;
-  case RAK_OP_MOD2:                 cstr = "MOD2";                 break;
-  case RAK_OP_MOD3:                 cstr = "MOD3";                 break;
-  case RAK_OP_NOT:                  cstr = "NOT";                  break;
-  case RAK_OP_NEG:                  cstr = "NEG";                  break;
-  case RAK_OP_CALL:                 cstr = "CALL";                 break;
-  case RAK_OP_TAIL_CALL:            cstr = "TAIL_CALL";            break;
-  case RAK_OP_YIELD:                cstr = "YIELD";                break;
-  case RAK_OP_RETURN:               cstr = "RETURN";               break;
-  case RAK_OP_RETURN_NIL:           cstr = "RETURN_NIL";           break;
+  case RAK_OP_NOP:                     cstr = "NOP";                     break;
+  case RAK_OP_PUSH_NIL:                cstr = "PUSH_NIL";                break;
+  case RAK_OP_PUSH_FALSE:              cstr = "PUSH_FALSE";              break;
+  case RAK_OP_PUSH_TRUE:               cstr = "PUSH_TRUE";               break;
+  case RAK_OP_PUSH_INT:                cstr = "PUSH_INT";                break;
+  case RAK_OP_LOAD_CONST:              cstr = "LOAD_CONST";              break;
+  case RAK_OP_LOAD_GLOBAL:             cstr = "LOAD_GLOBAL";             break;
+  case RAK_OP_LOAD_LOCAL:              cstr = "LOAD_LOCAL";              break;
+  case RAK_OP_STORE_LOCAL:             cstr = "STORE_LOCAL";             break;
+  case RAK_OP_FETCH_LOCAL:             cstr = "FETCH_LOCAL";             break;
+  case RAK_OP_REF_LOCAL:               cstr = "REF_LOCAL";               break;
+  case RAK_OP_LOAD_LOCAL_REF:          cstr = "LOAD_LOCAL_REF";          break;
+  case RAK_OP_STORE_LOCAL_REF:         cstr = "STORE_LOCAL_REF";         break;
+  case RAK_OP_NEW_ARRAY:               cstr = "NEW_ARRAY";               break;
+  case RAK_OP_NEW_RANGE:               cstr = "NEW_RANGE";               break;
+  case RAK_OP_NEW_RECORD:              cstr = "NEW_RECORD";              break;
+  case RAK_OP_NEW_CLOSURE:             cstr = "NEW_CLOSURE";             break;
+  case RAK_OP_MOVE:                    cstr = "MOVE";                    break;
+  case RAK_OP_POP:                     cstr = "POP";                     break;
+  case RAK_OP_GET_ELEMENT:             cstr = "GET_ELEMENT";             break;
+  case RAK_OP_SET_ELEMENT:             cstr = "SET_ELEMENT";             break;
+  case RAK_OP_LOAD_ELEMENT:            cstr = "LOAD_ELEMENT";            break;
+  case RAK_OP_FETCH_ELEMENT:           cstr = "FETCH_ELEMENT";           break;
+  case RAK_OP_UPDATE_ELEMENT:          cstr = "UPDATE_ELEMENT";          break;
+  case RAK_OP_GET_FIELD:               cstr = "GET_FIELD";               break;
+  case RAK_OP_PUT_FIELD:               cstr = "PUT_FIELD";               break;
+  case RAK_OP_LOAD_FIELD:              cstr = "LOAD_FIELD";              break;
+  case RAK_OP_FETCH_FIELD:             cstr = "FETCH_FIELD";             break;
+  case RAK_OP_UPDATE_FIELD:            cstr = "UPDATE_FIELD";            break;
+  case RAK_OP_UNPACK_ELEMENTS:         cstr = "UNPACK_ELEMENTS";         break;
+  case RAK_OP_UNPACK_FIELDS:           cstr = "UNPACK_FIELDS";           break;
+  case RAK_OP_JUMP:                    cstr = "JUMP";                    break;
+  case RAK_OP_JUMP_IF_FALSE:           cstr = "JUMP_IF_FALSE";           break;
+  case RAK_OP_JUMP_IF_FALSE_OR_POP:    cstr = "JUMP_IF_FALSE_OR_POP";    break;
+  case RAK_OP_JUMP_IF_TRUE_OR_POP:     cstr = "JUMP_IF_TRUE_OR_POP";     break;
+  case RAK_OP_EQ:                      cstr = "EQ";                      break;
+  case RAK_OP_NE:                      cstr = "NE";                      break;
+  case RAK_OP_GT:                      cstr = "GT";                      break;
+  case RAK_OP_GE:                      cstr = "GE";                      break;
+  case RAK_OP_LT:                      cstr = "LT";                      break;
+  case RAK_OP_LE:                      cstr = "LE";                      break;
+  case RAK_OP_EQ_LOCALS_JUMP_IF_FALSE: cstr = "EQ_LOCALS_JUMP_IF_FALSE"; break;
+  case RAK_OP_EQ_CONST_JUMP_IF_FALSE:  cstr = "EQ_CONST_JUMP_IF_FALSE";  break;
+  case RAK_OP_EQ_INT_JUMP_IF_FALSE:    cstr = "EQ_INT_JUMP_IF_FALSE";    break;
+  case RAK_OP_NE_LOCALS_JUMP_IF_FALSE: cstr = "NE_LOCALS_JUMP_IF_FALSE"; break;
+  case RAK_OP_NE_CONST_JUMP_IF_FALSE:  cstr = "NE_CONST_JUMP_IF_FALSE";  break;
+  case RAK_OP_NE_INT_JUMP_IF_FALSE:    cstr = "NE_INT_JUMP_IF_FALSE";    break;
+  case RAK_OP_GT_LOCALS_JUMP_IF_FALSE: cstr = "GT_LOCALS_JUMP_IF_FALSE"; break;
+  case RAK_OP_GT_CONST_JUMP_IF_FALSE:  cstr = "GT_CONST_JUMP_IF_FALSE";  break;
+  case RAK_OP_GT_INT_JUMP_IF_FALSE:    cstr = "GT_INT_JUMP_IF_FALSE";    break;
+  case RAK_OP_GE_LOCALS_JUMP_IF_FALSE: cstr = "GE_LOCALS_JUMP_IF_FALSE"; break;
+  case RAK_OP_GE_CONST_JUMP_IF_FALSE:  cstr = "GE_CONST_JUMP_IF_FALSE";  break;
+  case RAK_OP_GE_INT_JUMP_IF_FALSE:    cstr = "GE_INT_JUMP_IF_FALSE";    break;
+  case RAK_OP_LT_LOCALS_JUMP_IF_FALSE: cstr = "LT_LOCALS_JUMP_IF_FALSE"; break;
+  case RAK_OP_LT_CONST_JUMP_IF_FALSE:  cstr = "LT_CONST_JUMP_IF_FALSE";  break;
+  case RAK_OP_LT_INT_JUMP_IF_FALSE:    cstr = "LT_INT_JUMP_IF_FALSE";    break;
+  case RAK_OP_LE_LOCALS_JUMP_IF_FALSE: cstr = "LE_LOCALS_JUMP_IF_FALSE"; break;
+  case RAK_OP_LE_CONST_JUMP_IF_FALSE:  cstr = "LE_CONST_JUMP_IF_FALSE";  break;
+  case RAK_OP_LE_INT_JUMP_IF_FALSE:    cstr = "LE_INT_JUMP_IF_FALSE";    break;
+  case RAK_OP_ADD:                     cstr = "ADD";                     break;
+  case RAK_OP_ADD2:                    cstr = "ADD2";                    break;
+  case RAK_OP_ADD3:                    cstr = "ADD3";                    break;
+  case RAK_OP_SUB:                     cstr = "SUB";                     break;
+  case RAK_OP_SUB2:                    cstr = "SUB2";                    break;
+  case RAK_OP_SUB3:                    cstr = "SUB3";                    break;
+  case RAK_OP_MUL:                     cstr = "MUL";                     break;
+  case RAK_OP_MUL2:                    cstr = "MUL2";                    break;
+  case RAK_OP_MUL3:                    cstr = "MUL3";                    break;
+  case RAK_OP_DIV:                     cstr = "DIV";                     break;
+  case RAK_OP_DIV2:                    cstr = "DIV2";                    break;
+  case RAK_OP_DIV3:                    cstr = "DIV3";                    break;
+  case RAK_OP_MOD:                     cstr = "MOD";                     break;
+  case RAK_OP_MOD2:                    cstr = "MOD2";                    break;
+  case RAK_OP_MOD3:                    cstr = "MOD3";                    break;
+  case RAK_OP_NOT:                     cstr = "NOT";                     break;
+  case RAK_OP_NEG:                     cstr = "NEG";                     break;
+  case RAK_OP_CALL:                    cstr = "CALL";                    break;
+  case RAK_OP_TAIL_CALL:               cstr = "TAIL_CALL";               break;
+  case RAK_OP_YIELD:                   cstr = "YIELD";                   break;
+  case RAK_OP_RETURN:                  cstr = "RETURN";                  break;
+  case RAK_OP_RETURN_NIL:              cstr = "RETURN_NIL";              break;
+  case RAK_OP_EQ_NUM:                  cstr = "EQ_NUM";                  break;
+  case RAK_OP_NE_NUM:                  cstr = "NE_NUM";                  break;
+  case RAK_OP_GT_NUM:                  cstr = "GT_NUM";                  break;
+  case RAK_OP_GE_NUM:                  cstr = "GE_NUM";                  break;
+  case RAK_OP_LT_NUM:                  cstr = "LT_NUM";                  break;
+  case RAK_OP_LE_NUM:                  cstr = "LE_NUM";                  break;
+  case RAK_OP_ADD_NUM:                 cstr = "ADD_NUM";                 break;
+  case RAK_OP_ADD2_NUM:                cstr = "ADD2_NUM";                break;
+  case RAK_OP_ADD3_NUM:                cstr = "ADD3_NUM";                break;
   }
   return cstr;
 }
@@ -105,17 +268,27 @@ void rak_chunk_init(RakChunk *chunk, RakError *err)
     return;
   }
   rak_slice_init(&chunk->maps, err);
+  if (!rak_is_ok(err))
+  {
+    rak_slice_deinit(&chunk->consts);
+    rak_slice_deinit(&chunk->instrs);
+    return;
+  }
+  rak_slice_init(&chunk->caches, err);
   if (rak_is_ok(err)) return;
   rak_slice_deinit(&chunk->consts);
   rak_slice_deinit(&chunk->instrs);
+  rak_slice_deinit(&chunk->maps);
 }
 
 void rak_chunk_deinit(RakChunk *chunk)
 {
   release_consts(chunk);
+  release_caches(chunk);
   rak_slice_deinit(&chunk->consts);
   rak_slice_deinit(&chunk->instrs);
   rak_slice_deinit(&chunk->maps);
+  rak_slice_deinit(&chunk->caches);
 }
 
 uint8_t rak_chunk_append_const(RakChunk *chunk, RakValue val, RakError *err)
@@ -129,6 +302,7 @@ uint8_t rak_chunk_append_const(RakChunk *chunk, RakValue val, RakError *err)
   rak_slice_ensure_append(&chunk->consts, val, err);
   if (!rak_is_ok(err)) return 0;
   rak_value_retain(val);
+  rak_gc_make_immortal(&chunk->consts.data[len]);
   return (uint8_t) len;
 }
 
@@ -161,6 +335,23 @@ uint16_t rak_chunk_append_instr(RakChunk *chunk, uint32_t instr, int ln, RakErro
   return map.off;
 }
 
+uint8_t rak_chunk_append_cache(RakChunk *chunk, RakError *err)
+{
+  int len = chunk->caches.len;
+  if (len == RAK_CHUNK_MAX_CACHES)
+  {
+    rak_error_set(err, "too many inline caches");
+    return 0;
+  }
+  RakInlineCache cache = {
+    .shape = NULL,
+    .idx   = -1
+  };
+  rak_slice_ensure_append(&chunk->caches, cache, err);
+  if (!rak_is_ok(err)) return 0;
+  return (uint8_t) len;
+}
+
 int rak_chunk_get_line(const RakChunk *chunk, uint16_t off)
 {
   int len = chunk->maps.len;
@@ -180,10 +371,81 @@ int rak_chunk_get_line(const RakChunk *chunk, uint16_t off)
   return ln;
 }
 
+int rak_chunk_stack_size(const RakChunk *chunk, int base, RakError *err)
+{
+  int len = chunk->instrs.len;
+  if (!len) return base;
+  int *depths = rak_memory_alloc(sizeof(*depths) * len, err);
+  if (!rak_is_ok(err)) return 0;
+  for (int i = 0; i < len; ++i)
+    depths[i] = -1;
+  depths[0] = base;
+  int size = base;
+  // The compiler keeps the stack balanced across jumps, so this settles after a
+  // second pass; taking the deepest path at each merge only ever overestimates.
+  bool changed = true;
+  while (changed)
+  {
+    changed = false;
+    for (int i = 0; i < len; ++i)
+    {
+      int depth = depths[i];
+      if (depth < 0) continue;
+      uint32_t instr = rak_slice_get(&chunk->instrs, i);
+      int _depth = depth + stack_effect(instr);
+      if (_depth > size) size = _depth;
+      switch (rak_instr_opcode(instr))
+      {
+      case RAK_OP_JUMP:
+        changed |= merge_depth(depths, rak_instr_ab(instr), depth);
+        continue;
+      case RAK_OP_JUMP_IF_FALSE:
+        changed |= merge_depth(depths, rak_instr_ab(instr), _depth);
+        break;
+      case RAK_OP_JUMP_IF_FALSE_OR_POP:
+      case RAK_OP_JUMP_IF_TRUE_OR_POP:
+        changed |= merge_depth(depths, rak_instr_ab(instr), depth);
+        break;
+      case RAK_OP_EQ_LOCALS_JUMP_IF_FALSE:
+      case RAK_OP_EQ_CONST_JUMP_IF_FALSE:
+      case RAK_OP_EQ_INT_JUMP_IF_FALSE:
+      case RAK_OP_NE_LOCALS_JUMP_IF_FALSE:
+      case RAK_OP_NE_CONST_JUMP_IF_FALSE:
+      case RAK_OP_NE_INT_JUMP_IF_FALSE:
+      case RAK_OP_GT_LOCALS_JUMP_IF_FALSE:
+      case RAK_OP_GT_CONST_JUMP_IF_FALSE:
+      case RAK_OP_GT_INT_JUMP_IF_FALSE:
+      case RAK_OP_GE_LOCALS_JUMP_IF_FALSE:
+      case RAK_OP_GE_CONST_JUMP_IF_FALSE:
+      case RAK_OP_GE_INT_JUMP_IF_FALSE:
+      case RAK_OP_LT_LOCALS_JUMP_IF_FALSE:
+      case RAK_OP_LT_CONST_JUMP_IF_FALSE:
+      case RAK_OP_LT_INT_JUMP_IF_FALSE:
+      case RAK_OP_LE_LOCALS_JUMP_IF_FALSE:
+      case RAK_OP_LE_CONST_JUMP_IF_FALSE:
+      case RAK_OP_LE_INT_JUMP_IF_FALSE:
+        if (i + 2 < len) changed |= merge_depth(depths, i + 2, depth);
+        break;
+      case RAK_OP_TAIL_CALL:
+      case RAK_OP_RETURN:
+      case RAK_OP_RETURN_NIL:
+        continue;
+      default:
+        break;
+      }
+      if (i + 1 < len) changed |= merge_depth(depths, i + 1, _depth);
+    }
+  }
+  rak_memory_free(depths);
+  return size;
+}
+
 void rak_chunk_clear(RakChunk *chunk)
 {
   release_consts(chunk);
+  release_caches(chunk);
   rak_slice_clear(&chunk->consts);
   rak_slice_clear(&chunk->instrs);
   rak_slice_clear(&chunk->maps);
+  rak_slice_clear(&chunk->caches);
 }
@@ -20,11 +20,13 @@ RakClosure *rak_closure_new(RakCallableType type, RakCallable *callable, RakErro
   cl->type = type;
   cl->callable = callable;
   rak_object_retain(&callable->obj);
+  rak_memory_track_object(RAK_TYPE_CLOSURE, 1);
   return cl;
 }
 
 void rak_closure_free(RakClosure *cl)
 {
+  rak_memory_track_object(RAK_TYPE_CLOSURE, -1);
   if (cl->type == RAK_CALLABLE_TYPE_FUNCTION)
   {
     RakFunction *fn = (RakFunction *) cl->callable;
@@ -64,6 +64,7 @@ typedef struct Compiler
 static inline void compiler_init(Compiler *comp, Compiler *parent, RakLexer *lex,
   RakString *fnName, int arity, RakError *err);
 static inline void compiler_deinit(Compiler *comp);
+static inline void compute_stack_size(Compiler *comp, RakError *err);
 static inline void compile_chunk(Compiler *comp, RakChunk *chunk, RakError *err);
 static inline void compile_stmt(Compiler *comp, RakChunk *chunk, RakError *err);
 static inline void compile_block(Compiler *comp, RakChunk *chunk, RakError *err);
@@ -121,13 +122,18 @@ static inline Symbol *resolve_local(Compiler *comp, RakToken tok);
 static inline bool ident_equals(RakToken tok1, RakToken tok2);
 static inline void emit_store_local_instr(Compiler *comp, RakChunk *chunk, uint8_t dst, RakError *err);
 static inline void emit_return_instr(Compiler *comp, RakChunk *chunk, RakError *err);
+static inline uint16_t emit_jump_if_false_instr(Compiler *comp, RakChunk *chunk, uint16_t start, RakError *err);
+static inline uint32_t fused_jump_if_false_instr(RakOpcode op, uint8_t lhs, uint8_t rhs, RakOpcode form);
+static inline int find_number_const(RakChunk *chunk, double num);
 static inline void emit_add_instr(Compiler *comp, RakChunk *chunk, RakError *err);
 static inline void emit_sub_instr(Compiler *comp, RakChunk *chunk, RakError *err);
 static inline void emit_mul_instr(Compiler *comp, RakChunk *chunk, RakError *err);
 static inline void emit_div_instr(Compiler *comp, RakChunk *chunk, RakError *err);
 static inline void emit_mod_instr(Compiler *comp, RakChunk *chunk, RakError *err);
 static inline uint16_t emit_instr(Compiler *comp, RakChunk *chunk, uint32_t instr, RakError *err);
+static inline uint8_t append_string_const(RakChunk *chunk, RakString *str, RakError *err);
 static inline void patch_instr(RakChunk *chunk, uint16_t off, uint32_t instr);
+static inline void patch_jump_if_false_instr(RakChunk *chunk, uint16_t off, uint16_t target);
 static inline void unexpected_token_error(RakError *err, RakToken tok);
 static inline void expected_token_error(RakError *err, RakTokenKind kind, RakToken tok);
 
@@ -150,6 +156,14 @@ static inline void compiler_deinit(Compiler *comp)
   rak_function_release(comp->fn);
 }
 
+static inline void compute_stack_size(Compiler *comp, RakError *err)
+{
+  RakCallable *callable = &comp->fn->callable;
+  int size = rak_chunk_stack_size(&comp->fn->chunk, callable->arity + 1, err);
+  if (!rak_is_ok(err)) return;
+  callable->stackSize = size;
+}
+
 static inline void compile_chunk(Compiler *comp, RakChunk *chunk, RakError *err)
 {
   while (!match(comp, RAK_TOKEN_KIND_EOF))
@@ -369,13 +383,8 @@ static inline void compile_destruct_fields(Compiler *comp, RakChunk *chunk, RakE
     if (!rak_is_ok(err)) return;
     RakString *str = rak_string_new_from_cstr(tok.len, tok.chars, err);
     if (!rak_is_ok(err)) return;
-    RakValue val = rak_string_value(str);
-    uint8_t idx = rak_chunk_append_const(chunk, val, err);
-    if (!rak_is_ok(err))
-    {
-      rak_string_free(str);
-      return;
-    }
+    uint8_t idx = append_string_const(chunk, str, err);
+    if (!rak_is_ok(err)) return;
     emit_instr(comp, chunk, rak_load_const_instr(idx), err);
     if (!rak_is_ok(err)) return;
   }
@@ -421,12 +430,18 @@ static inline void compile_assign_stmt(Compiler *comp, RakChunk *chunk, RakError
   if (!rak_is_ok(err)) return;
   if (instr)
   {
-    emit_instr(comp, chunk, rak_load_local_instr(idx), err);
+    uint32_t _instr = isRef
+      ? rak_load_local_ref_instr(idx)
+      : rak_load_local_instr(idx);
+    emit_instr(comp, chunk, _instr, err);
     if (!rak_is_ok(err)) return;
     compile_expr(comp, chunk, err);
     if (!rak_is_ok(err)) return;
     consume(comp, RAK_TOKEN_KIND_SEMICOLON, err);
-    emit_instr(comp, chunk, instr, err);
+    if (instr == rak_add_instr())
+      emit_add_instr(comp, chunk, err);
+    else
+      emit_instr(comp, chunk, instr, err);
     if (!rak_is_ok(err)) return;
     if (isRef)
     {
@@ -536,19 +551,16 @@ static inline void compile_assign_stmt_cont(Compiler *comp, RakChunk *chunk, Rak
   next(comp, err);
   RakString *str = rak_string_new_from_cstr(tok.len, tok.chars, err);
   if (!rak_is_ok(err)) return;
-  RakValue val = rak_string_value(str);
-  uint8_t idx = rak_chunk_append_const(chunk, val, err);
-  if (!rak_is_ok(err))
-  {
-    rak_string_free(str);
-    return;
-  }
+  uint8_t idx = append_string_const(chunk, str, err);
+  if (!rak_is_ok(err)) return;
+  uint8_t cache = rak_chunk_append_cache(chunk, err);
+  if (!rak_is_ok(err)) return;
   if (match(comp, RAK_TOKEN_KIND_EQ))
   {
     next(comp, err);
     compile_expr(comp, chunk, err);
     if (!rak_is_ok(err)) return;
-    emit_instr(comp, chunk, rak_put_field_instr(idx), err);
+    emit_instr(comp, chunk, rak_put_field_instr(idx, cache), err);
     return;
   }
   uint32_t instr = 0;
@@ -556,7 +568,7 @@ static inline void compile_assign_stmt_cont(Compiler *comp, RakChunk *chunk, Rak
   if (!rak_is_ok(err)) return;
   if (instr)
   {
-    emit_instr(comp, chunk, rak_load_field_instr(idx), err);
+    emit_instr(comp, chunk, rak_load_field_instr(idx, cache), err);
     if (!rak_is_ok(err)) return;
     compile_expr(comp, chunk, err);
     if (!rak_is_ok(err)) return;
@@ -565,7 +577,7 @@ static inline void compile_assign_stmt_cont(Compiler *comp, RakChunk *chunk, Rak
     emit_instr(comp, chunk, rak_update_field_instr(), err);
     return;
   }
-  emit_instr(comp, chunk, rak_fetch_field_instr(idx), err);
+  emit_instr(comp, chunk, rak_fetch_field_instr(idx, cache), err);
   if (!rak_is_ok(err)) return;
   compile_assign_stmt_cont(comp, chunk, err);
   if (!rak_is_ok(err)) return;
@@ -605,6 +617,8 @@ static inline void compile_fn_decl(Compiler *comp, RakChunk *chunk, RakError *er
   if (!rak_is_ok(err)) goto end;
   emit_instr(&_comp, _chunk, rak_return_nil_instr(), err);
   if (!rak_is_ok(err)) goto end;
+  compute_stack_size(&_comp, err);
+  if (!rak_is_ok(err)) goto end;
   uint8_t idx = rak_function_append_nested(comp->fn, _comp.fn, err);
   if (!rak_is_ok(err)) goto end;
   emit_instr(comp, chunk, rak_new_closure_instr(idx), err);
@@ -678,9 +692,10 @@ static inline void compile_if_stmt(Compiler *comp, RakChunk *chunk, uint16_t *of
     compile_let_decl(comp, chunk, err);
     if (!rak_is_ok(err)) return;
   }
+  uint16_t start = (uint16_t) chunk->instrs.len;
   compile_expr(comp, chunk, err);
   if (!rak_is_ok(err)) return;
-  uint16_t jump1 = emit_instr(comp, chunk, rak_nop_instr(), err);
+  uint16_t jump1 = emit_jump_if_false_instr(comp, chunk, start, err);
   if (!rak_is_ok(err)) return;
   if (!match(comp, RAK_TOKEN_KIND_LBRACE))
   {
@@ -691,8 +706,7 @@ static inline void compile_if_stmt(Compiler *comp, RakChunk *chunk, uint16_t *of
   if (!rak_is_ok(err)) return;
   uint16_t jump2 = emit_instr(comp, chunk, rak_nop_instr(), err);
   if (!rak_is_ok(err)) return;
-  uint32_t instr = rak_jump_if_false_instr((uint16_t) chunk->instrs.len);
-  patch_instr(chunk, jump1, instr);
+  patch_jump_if_false_instr(chunk, jump1, (uint16_t) chunk->instrs.len);
   uint16_t _off;
   compile_if_stmt_cont(comp, chunk, &_off, err);
   if (!rak_is_ok(err)) return;
@@ -754,9 +768,10 @@ static inline void compile_while_stmt(Compiler *comp, RakChunk *chunk, RakError
     compile_let_decl(comp, chunk, err);
     if (!rak_is_ok(err)) return;
   }
+  uint16_t start = (uint16_t) chunk->instrs.len;
   compile_expr(comp, chunk, err);
   if (!rak_is_ok(err)) return;
-  uint16_t jump = emit_instr(comp, chunk, rak_nop_instr(), err);
+  uint16_t jump = emit_jump_if_false_instr(comp, chunk, start, err);
   if (!rak_is_ok(err)) return;
   if (!match(comp, RAK_TOKEN_KIND_LBRACE))
   {
@@ -769,8 +784,7 @@ static inline void compile_while_stmt(Compiler *comp, RakChunk *chunk, RakError
   if (!rak_is_ok(err)) return;
   emit_instr(comp, chunk, rak_jump_instr(loop.off), err);
   if (!rak_is_ok(err)) return;
-  uint32_t instr = rak_jump_if_false_instr((uint16_t) chunk->instrs.len);
-  patch_instr(chunk, jump, instr);
+  patch_jump_if_false_instr(chunk, jump, (uint16_t) chunk->instrs.len);
   end_loop(comp, chunk);
   end_scope(comp, chunk, err);
 }
@@ -1190,14 +1204,11 @@ static inline void compile_subscr(Compiler *comp, RakChunk *chunk, bool *_match,
     next(comp, err);
     RakString *str = rak_string_new_from_cstr(tok.len, tok.chars, err);
     if (!rak_is_ok(err)) return;
-    RakValue val = rak_string_value(str);
-    uint8_t idx = rak_chunk_append_const(chunk, val, err);
-    if (!rak_is_ok(err))
-    {
-      rak_string_free(str);
-      return;
-    }
-    emit_instr(comp, chunk, rak_get_field_instr(idx), err);
+    uint8_t idx = append_string_const(chunk, str, err);
+    if (!rak_is_ok(err)) return;
+    uint8_t cache = rak_chunk_append_cache(chunk, err);
+    if (!rak_is_ok(err)) return;
+    emit_instr(comp, chunk, rak_get_field_instr(idx, cache), err);
     if (!rak_is_ok(err)) return;
     *_match = true;
     return;
@@ -1250,13 +1261,8 @@ static inline void compile_prim_expr(Compiler *comp, RakChunk *chunk, RakError *
     next(comp, err);
     RakString *str = rak_string_new_from_cstr_with_escapes(tok.len, tok.chars, err);
     if (!rak_is_ok(err)) return;
-    RakValue val = rak_string_value(str);
-    uint8_t idx = rak_chunk_append_const(chunk, val, err);
-    if (!rak_is_ok(err))
-    {
-      rak_string_free(str);
-      return;
-    }
+    uint8_t idx = append_string_const(chunk, str, err);
+    if (!rak_is_ok(err)) return;
     emit_instr(comp, chunk, rak_load_const_instr(idx), err);
     return;
   }
@@ -1396,6 +1402,8 @@ static inline void compile_fn(Compiler *comp, RakChunk *chunk, RakError *err)
   if (!rak_is_ok(err)) goto end;
   end_scope(&_comp, _chunk, err);
   if (!rak_is_ok(err)) goto end;
+  compute_stack_size(&_comp, err);
+  if (!rak_is_ok(err)) goto end;
   uint8_t idx = rak_function_append_nested(comp->fn, _comp.fn, err);
   if (!rak_is_ok(err)) goto end;
   emit_instr(comp, chunk, rak_new_closure_instr(idx), err);
@@ -1415,13 +1423,8 @@ static inline void compile_field(Compiler *comp, RakChunk *chunk, RakError *err)
   consume(comp, RAK_TOKEN_KIND_COLON, err);
   RakString *name = rak_string_new_from_cstr(tok.len, tok.chars, err);
   if (!rak_is_ok(err)) return;
-  RakValue val = rak_string_value(name);
-  uint8_t idx = rak_chunk_append_const(chunk, val, err);
-  if (!rak_is_ok(err))
-  {
-    rak_string_free(name);
-    return;
-  }
+  uint8_t idx = append_string_const(chunk, name, err);
+  if (!rak_is_ok(err)) return;
   emit_instr(comp, chunk, rak_load_const_instr(idx), err);
   if (!rak_is_ok(err)) return;
   compile_expr(comp, chunk, err);
@@ -1653,6 +1656,101 @@ static inline void emit_return_instr(Compiler *comp, RakChunk *chunk, RakError *
   emit_instr(comp, chunk, rak_return_instr(), err);
 }
 
+static inline uint16_t emit_jump_if_false_instr(Compiler *comp, RakChunk *chunk, uint16_t start, RakError *err)
+{
+  int len = chunk->instrs.len;
+  if (len - start != 3) goto end;
+  uint32_t instr1 = rak_slice_get(&chunk->instrs, len - 3);
+  uint32_t instr2 = rak_slice_get(&chunk->instrs, len - 2);
+  uint32_t instr3 = rak_slice_get(&chunk->instrs, len - 1);
+  RakOpcode op = rak_instr_opcode(instr3);
+  if (rak_instr_opcode(instr1) != RAK_OP_LOAD_LOCAL
+   || rak_instr_opcode(fused_jump_if_false_instr(op, 0, 0, RAK_OP_LOAD_LOCAL)) == RAK_OP_NOP)
+    goto end;
+  uint8_t lhs = rak_instr_a(instr1);
+  uint32_t instr;
+  switch (rak_instr_opcode(instr2))
+  {
+  case RAK_OP_LOAD_LOCAL:
+  case RAK_OP_LOAD_CONST:
+    instr = fused_jump_if_false_instr(op, lhs, rak_instr_a(instr2), rak_instr_opcode(instr2));
+    break;
+  case RAK_OP_PUSH_INT:
+    {
+      // Small integers ride in the instruction, and larger ones only fuse when an equal
+      // constant already exists, so fusing never takes a slot from the constant table.
+      uint16_t num = rak_instr_ab(instr2);
+      if (num <= UINT8_MAX)
+      {
+        instr = fused_jump_if_false_instr(op, lhs, (uint8_t) num, RAK_OP_PUSH_INT);
+        break;
+      }
+      int idx = find_number_const(chunk, num);
+      if (idx == -1) goto end;
+      instr = fused_jump_if_false_instr(op, lhs, (uint8_t) idx, RAK_OP_LOAD_CONST);
+    }
+    break;
+  default:
+    goto end;
+  }
+  rak_slice_set(&chunk->instrs, len - 3, instr);
+  chunk->instrs.len -= 2;
+end:
+  return emit_instr(comp, chunk, rak_nop_instr(), err);
+}
+
+static inline uint32_t fused_jump_if_false_instr(RakOpcode op, uint8_t lhs, uint8_t rhs, RakOpcode form)
+{
+  uint32_t instr = rak_nop_instr();
+  switch (op)
+  {
+  case RAK_OP_EQ:
+    instr = form == RAK_OP_LOAD_CONST ? rak_eq_const_jump_if_false_instr(lhs, rhs)
+      : form == RAK_OP_PUSH_INT ? rak_eq_int_jump_if_false_instr(lhs, rhs)
+      : rak_eq_locals_jump_if_false_instr(lhs, rhs);
+    break;
+  case RAK_OP_NE:
+    instr = form == RAK_OP_LOAD_CONST ? rak_ne_const_jump_if_false_instr(lhs, rhs)
+      : form == RAK_OP_PUSH_INT ? rak_ne_int_jump_if_false_instr(lhs, rhs)
+      : rak_ne_locals_jump_if_false_instr(lhs, rhs);
+    break;
+  case RAK_OP_GT:
+    instr = form == RAK_OP_LOAD_CONST ? rak_gt_const_jump_if_false_instr(lhs, rhs)
+      : form == RAK_OP_PUSH_INT ? rak_gt_int_jump_if_false_instr(lhs, rhs)
+      : rak_gt_locals_jump_if_false_instr(lhs, rhs);
+    break;
+  case RAK_OP_GE:
+    instr = form == RAK_OP_LOAD_CONST ? rak_ge_const_jump_if_false_instr(lhs, rhs)
+      : form == RAK_OP_PUSH_INT ? rak_ge_int_jump_if_false_instr(lhs, rhs)
+      : rak_ge_locals_jump_if_false_instr(lhs, rhs);
+    break;
+  case RAK_OP_LT:
+    instr = form == RAK_OP_LOAD_CONST ? rak_lt_const_jump_if_false_instr(lhs, rhs)
+      : form == RAK_OP_PUSH_INT ? rak_lt_int_jump_if_false_instr(lhs, rhs)
+      : rak_lt_locals_jump_if_false_instr(lhs, rhs);
+    break;
+  case RAK_OP_LE:
+    instr = form == RAK_OP_LOAD_CONST ? rak_le_const_jump_if_false_instr(lhs, rhs)
+      : form == RAK_OP_PUSH_INT ? rak_le_int_jump_if_false_instr(lhs, rhs)
+      : rak_le_locals_jump_if_false_instr(lhs, rhs);
+    break;
+  default:
+    break;
+  }
+  return instr;
+}
+
+static inline int find_number_const(RakChunk *chunk, double num)
+{
+  int len = chunk->consts.len;
+  for (int i = 0; i < len; ++i)
+  {
+    RakValue val = rak_slice_get(&chunk->consts, i);
+    if (rak_is_number(val) && rak_as_number(val) == num) return i;
+  }
+  return -1;
+}
+
 static inline void emit_add_instr(Compiler *comp, RakChunk *chunk, RakError *err)
 {
   int len = chunk->instrs.len;
@@ -1745,7 +1843,25 @@ static inline void emit_mod_instr(Compiler *comp, RakChunk *chunk, RakError *err
 
 static inline uint16_t emit_instr(Compiler *comp, RakChunk *chunk, uint32_t instr, RakError *err)
 {
-  return rak_chunk_append_instr(chunk, instr, comp->lex->ln, err);
+  // Instructions are attributed to the last token consumed, since the current one may
+  // already be on the line of the next statement.
+  return rak_chunk_append_instr(chunk, instr, comp->lex->prevLn, err);
+}
+
+static inline uint8_t append_string_const(RakChunk *chunk, RakString *str, RakError *err)
+{
+  RakString *_str = rak_string_intern(str, err);
+  if (!rak_is_ok(err))
+  {
+    rak_string_free(str);
+    return 0;
+  }
+  if (_str != str) rak_string_free(str);
+  uint8_t idx = rak_chunk_append_const(chunk, rak_string_value(_str), err);
+  // An interned string already referenced elsewhere must be left alone.
+  if (rak_is_ok(err) || _str->obj.refCount) return idx;
+  rak_string_free(_str);
+  return 0;
 }
 
 static inline void patch_instr(RakChunk *chunk, uint16_t off, uint32_t instr)
@@ -1753,6 +1869,37 @@ static inline void patch_instr(RakChunk *chunk, uint16_t off, uint32_t instr)
   rak_slice_set(&chunk->instrs, off, instr);
 }
 
+static inline void patch_jump_if_false_instr(RakChunk *chunk, uint16_t off, uint16_t target)
+{
+  uint32_t instr = off ? rak_slice_get(&chunk->instrs, off - 1) : rak_nop_instr();
+  switch (rak_instr_opcode(instr))
+  {
+  case RAK_OP_EQ_LOCALS_JUMP_IF_FALSE:
+  case RAK_OP_EQ_CONST_JUMP_IF_FALSE:
+  case RAK_OP_EQ_INT_JUMP_IF_FALSE:
+  case RAK_OP_NE_LOCALS_JUMP_IF_FALSE:
+  case RAK_OP_NE_CONST_JUMP_IF_FALSE:
+  case RAK_OP_NE_INT_JUMP_IF_FALSE:
+  case RAK_OP_GT_LOCALS_JUMP_IF_FALSE:
+  case RAK_OP_GT_CONST_JUMP_IF_FALSE:
+  case RAK_OP_GT_INT_JUMP_IF_FALSE:
+  case RAK_OP_GE_LOCALS_JUMP_IF_FALSE:
+  case RAK_OP_GE_CONST_JUMP_IF_FALSE:
+  case RAK_OP_GE_INT_JUMP_IF_FALSE:
+  case RAK_OP_LT_LOCALS_JUMP_IF_FALSE:
+  case RAK_OP_LT_CONST_JUMP_IF_FALSE:
+  case RAK_OP_LT_INT_JUMP_IF_FALSE:
+  case RAK_OP_LE_LOCALS_JUMP_IF_FALSE:
+  case RAK_OP_LE_CONST_JUMP_IF_FALSE:
+  case RAK_OP_LE_INT_JUMP_IF_FALSE:
+    patch_instr(chunk, off, rak_jump_instr(target));
+    break;
+  default:
+    patch_instr(chunk, off, rak_jump_if_false_instr(target));
+    break;
+  }
+}
+
 static inline void unexpected_token_error(RakError *err, RakToken tok)
 {
   if (tok.kind == RAK_TOKEN_KIND_EOF)
@@ -1797,6 +1944,8 @@ RakClosure *rak_compile(RakString *file, RakString *source, RakError *err)
   append_local(&comp, false, tok);
   compile_chunk(&comp, &comp.fn->chunk, err);
   if (!rak_is_ok(err)) goto fail;
+  compute_stack_size(&comp, err);
+  if (!rak_is_ok(err)) goto fail;
   RakClosure *cl = rak_closure_new(RAK_CALLABLE_TYPE_FUNCTION,
     &comp.fn->callable, err);
   if (!rak_is_ok(err)) goto fail;
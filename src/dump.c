@@ -66,6 +66,13 @@ void rak_dump_function(RakFunction *fn)
     case RAK_OP_YIELD:
     case RAK_OP_RETURN:
     case RAK_OP_RETURN_NIL:
+    case RAK_OP_EQ_NUM:
+    case RAK_OP_NE_NUM:
+    case RAK_OP_GT_NUM:
+    case RAK_OP_GE_NUM:
+    case RAK_OP_LT_NUM:
+    case RAK_OP_LE_NUM:
+    case RAK_OP_ADD_NUM:
       printf("%-15s\n", rak_opcode_to_cstr(op));
       break;
     case RAK_OP_LOAD_CONST:
@@ -79,10 +86,6 @@ void rak_dump_function(RakFunction *fn)
     case RAK_OP_NEW_ARRAY:
     case RAK_OP_NEW_RECORD:
     case RAK_OP_NEW_CLOSURE:
-    case RAK_OP_GET_FIELD:
-    case RAK_OP_PUT_FIELD:
-    case RAK_OP_LOAD_FIELD:
-    case RAK_OP_FETCH_FIELD:
     case RAK_OP_UNPACK_ELEMENTS:
     case RAK_OP_UNPACK_FIELDS:
     case RAK_OP_CALL:
@@ -93,11 +96,34 @@ void rak_dump_function(RakFunction *fn)
       }
       break;
     case RAK_OP_MOVE:
+    case RAK_OP_GET_FIELD:
+    case RAK_OP_PUT_FIELD:
+    case RAK_OP_LOAD_FIELD:
+    case RAK_OP_FETCH_FIELD:
+    case RAK_OP_EQ_LOCALS_JUMP_IF_FALSE:
+    case RAK_OP_EQ_CONST_JUMP_IF_FALSE:
+    case RAK_OP_EQ_INT_JUMP_IF_FALSE:
+    case RAK_OP_NE_LOCALS_JUMP_IF_FALSE:
+    case RAK_OP_NE_CONST_JUMP_IF_FALSE:
+    case RAK_OP_NE_INT_JUMP_IF_FALSE:
+    case RAK_OP_GT_LOCALS_JUMP_IF_FALSE:
+    case RAK_OP_GT_CONST_JUMP_IF_FALSE:
+    case RAK_OP_GT_INT_JUMP_IF_FALSE:
+    case RAK_OP_GE_LOCALS_JUMP_IF_FALSE:
+    case RAK_OP_GE_CONST_JUMP_IF_FALSE:
+    case RAK_OP_GE_INT_JUMP_IF_FALSE:
+    case RAK_OP_LT_LOCALS_JUMP_IF_FALSE:
+    case RAK_OP_LT_CONST_JUMP_IF_FALSE:
+    case RAK_OP_LT_INT_JUMP_IF_FALSE:
+    case RAK_OP_LE_LOCALS_JUMP_IF_FALSE:
+    case RAK_OP_LE_CONST_JUMP_IF_FALSE:
+    case RAK_OP_LE_INT_JUMP_IF_FALSE:
     case RAK_OP_ADD2:
     case RAK_OP_SUB2:
     case RAK_OP_MUL2:
     case RAK_OP_DIV2:
     case RAK_OP_MOD2:
+    case RAK_OP_ADD2_NUM:
       {
         uint8_t a = rak_instr_a(instr);
         uint8_t b = rak_instr_b(instr);
@@ -109,6 +135,7 @@ void rak_dump_function(RakFunction *fn)
     case RAK_OP_MUL3:
     case RAK_OP_DIV3:
     case RAK_OP_MOD3:
+    case RAK_OP_ADD3_NUM:
       {
         uint8_t a = rak_instr_a(instr);
         uint8_t b = rak_instr_b(instr);
@@ -10,88 +10,85 @@
 
 #include "rak/fiber.h"
 #include <stdio.h>
+#include <string.h>
+#include "rak/gc.h"
 #include "rak/native.h"
 #include "rak/vm.h"
 
-static void run(RakFiber *fiber, RakError *err);
-static void resume(RakFiber *fiber, RakError *err);
+#if !defined(_WIN32) && !defined(__STDC_NO_ATOMICS__)
+  #include <stdatomic.h>
+  #define signal_fence() atomic_signal_fence(memory_order_seq_cst)
+#else
+  #define signal_fence() ((void) 0)
+#endif
 
-static void run(RakFiber *fiber, RakError *err)
+#define publish(p, v) (*(RakCallFrame * volatile *) &(p) = (v))
+
+static RakFiber * volatile current = NULL;
+static RakFiber *pool[RAK_FIBER_POOL_MAX_LEN];
+static int poolLen = 0;
+static size_t poolSize = 0;
+
+static void run(RakFiber *fiber, bool suspendable, RakError *err);
+static inline size_t fiber_size(RakFiber *fiber);
+static inline int vstk_size(int vstkSize, RakClosure *cl, uint8_t nargs);
+static void start(RakFiber *fiber, RakArray *globals, int vstkSize, RakClosure *cl,
+  uint8_t nargs, RakValue *args, RakError *err);
+static void reset(RakFiber *fiber);
+
+static void run(RakFiber *fiber, bool suspendable, RakError *err)
 {
-  RakCallFrame frame = rak_stack_get(&fiber->cstk, 0);
-  RakClosure *cl = frame.cl;
-  RakValue *slots = frame.slots;
-  if (cl->type == RAK_CALLABLE_TYPE_FUNCTION)
-    rak_vm_dispatch(fiber, cl, (uint32_t *) frame.state, slots, err);
-  else
-    ((RakNativeFunction *) cl->callable)->call(fiber, cl, frame.state,
-      slots, err);
-  if (!rak_is_ok(err))
-  {
-    fiber->status = RAK_FIBER_STATUS_DONE;
-    return;
-  }
-  if (fiber->status == RAK_FIBER_STATUS_SUSPENDED)
+  for (;;)
   {
-    rak_fiber_pop(fiber);
-    fiber->status = RAK_FIBER_STATUS_RUNNING;
-    run(fiber, err);
-    return;
-  }
-  if (rak_stack_is_empty(&fiber->cstk))
-  {
-    fiber->status = RAK_FIBER_STATUS_DONE;
-    return;
+    RakCallFrame frame = rak_stack_get(&fiber->cstk, 0);
+    RakClosure *cl = frame.cl;
+    RakValue *slots = frame.slots;
+    if (cl->type == RAK_CALLABLE_TYPE_FUNCTION)
+      rak_vm_dispatch(fiber, cl, (uint32_t *) frame.state, slots, err);
+    else
+      ((RakNativeFunction *) cl->callable)->call(fiber, cl, frame.state,
+        slots, err);
+    if (!rak_is_ok(err)) break;
+    if (fiber->status == RAK_FIBER_STATUS_SUSPENDED)
+    {
+      if (suspendable) return;
+      rak_fiber_pop(fiber);
+      fiber->status = RAK_FIBER_STATUS_RUNNING;
+      continue;
+    }
+    if (rak_stack_is_empty(&fiber->cstk)) break;
+    rak_gc_safe_point();
   }
-  run(fiber, err);
+  fiber->status = RAK_FIBER_STATUS_DONE;
 }
 
-static void resume(RakFiber *fiber, RakError *err)
+static inline size_t fiber_size(RakFiber *fiber)
 {
-  RakCallFrame frame = rak_stack_get(&fiber->cstk, 0);
-  RakClosure *cl = frame.cl;
-  RakValue *slots = frame.slots;
-  if (cl->type == RAK_CALLABLE_TYPE_FUNCTION)
-    rak_vm_dispatch(fiber, cl, (uint32_t *) frame.state, slots, err);
-  else
-    ((RakNativeFunction *) cl->callable)->call(fiber, cl, frame.state,
-      slots, err);
-  if (!rak_is_ok(err))
-  {
-    fiber->status = RAK_FIBER_STATUS_DONE;
-    return;
-  }
-  if (fiber->status == RAK_FIBER_STATUS_SUSPENDED)
-    return;
-  if (rak_stack_is_empty(&fiber->cstk))
-  {
-    fiber->status = RAK_FIBER_STATUS_DONE;
-    return;
-  }
-  resume(fiber, err);
+  size_t vstkCap = (size_t) (fiber->vstk.limit - fiber->vstk.base) + 1;
+  size_t cstkCap = (size_t) (fiber->cstk.limit - fiber->cstk.base) + 1;
+  return sizeof(*fiber) + sizeof(*fiber->vstk.base) * vstkCap
+    + sizeof(*fiber->cstk.base) * cstkCap;
 }
 
-void rak_fiber_init(RakFiber *fiber, RakArray *globals, int vstkSize, int cstkSize,
-  RakClosure *cl, uint8_t nargs, RakValue *args, RakError *err)
+static inline int vstk_size(int vstkSize, RakClosure *cl, uint8_t nargs)
+{
+  int size = cl->callable->stackSize;
+  if (size < vstkSize) size = vstkSize;
+  if (size <= nargs) size = nargs + 1;
+  return size;
+}
+
+static void start(RakFiber *fiber, RakArray *globals, int vstkSize, RakClosure *cl,
+  uint8_t nargs, RakValue *args, RakError *err)
 {
   rak_object_init(&fiber->obj);
   fiber->status = RAK_FIBER_STATUS_SUSPENDED;
   fiber->globals = globals;
-  rak_stack_init(&fiber->vstk, vstkSize, err);
+  rak_arena_init(&fiber->arena);
+  rak_fiber_ensure_vstk(fiber, vstk_size(vstkSize, cl, nargs), err);
   if (!rak_is_ok(err)) return;
-  rak_stack_init(&fiber->cstk, cstkSize, err);
-  if (!rak_is_ok(err))
-  {
-    rak_stack_deinit(&fiber->vstk);
-    return;
-  }
   rak_fiber_push_object(fiber, rak_closure_value(cl), err);
-  if (!rak_is_ok(err))
-  {
-    rak_stack_deinit(&fiber->vstk);
-    rak_stack_deinit(&fiber->cstk);
-    return;
-  }
+  if (!rak_is_ok(err)) return;
   RakValue *slots = &rak_stack_get(&fiber->vstk, 0);
   for (int i = 0; i < nargs; ++i)
   {
@@ -118,8 +115,8 @@ void rak_fiber_init(RakFiber *fiber, RakArray *globals, int vstkSize, int cstkSi
     RakValue _val = slots[idx];
     if (rak_is_ref(_val)) continue;
     rak_error_set(err, "argument #%d must be a reference, got %s", idx,
-      rak_type_to_cstr(_val.type));
-    return;
+      rak_type_to_cstr(rak_type_of(_val)));
+    goto fail;
   }
   RakCallFrame frame = {
     .cl = cl,
@@ -129,26 +126,48 @@ void rak_fiber_init(RakFiber *fiber, RakArray *globals, int vstkSize, int cstkSi
   {
     RakFunction *fn = (RakFunction *) cl->callable;
     frame.state = fn->chunk.instrs.data;
-    rak_stack_push(&fiber->cstk, frame);
-    rak_object_retain(&globals->obj);
-    return;
   }
-  frame.state = (void *) 0;
+  else
+    frame.state = (void *) 0;
   rak_stack_push(&fiber->cstk, frame);
   rak_object_retain(&globals->obj);
+  rak_memory_track_object(RAK_TYPE_FIBER, 1);
   return;
 fail:
   while (!rak_stack_is_empty(&fiber->vstk))
     rak_fiber_pop(fiber);
-  rak_stack_deinit(&fiber->vstk);
-  rak_stack_deinit(&fiber->cstk);
 }
 
-void rak_fiber_deinit(RakFiber *fiber)
+static void reset(RakFiber *fiber)
 {
   rak_array_release(fiber->globals);
   while (!rak_stack_is_empty(&fiber->vstk))
     rak_fiber_pop(fiber);
+  rak_stack_clear(&fiber->cstk);
+  rak_arena_deinit(&fiber->arena);
+  rak_memory_track_object(RAK_TYPE_FIBER, -1);
+}
+
+void rak_fiber_init(RakFiber *fiber, RakArray *globals, int vstkSize, int cstkSize,
+  RakClosure *cl, uint8_t nargs, RakValue *args, RakError *err)
+{
+  rak_stack_init(&fiber->vstk, vstk_size(vstkSize, cl, nargs), err);
+  if (!rak_is_ok(err)) return;
+  rak_stack_init(&fiber->cstk, cstkSize, err);
+  if (!rak_is_ok(err))
+  {
+    rak_stack_deinit(&fiber->vstk);
+    return;
+  }
+  start(fiber, globals, vstkSize, cl, nargs, args, err);
+  if (rak_is_ok(err)) return;
+  rak_stack_deinit(&fiber->vstk);
+  rak_stack_deinit(&fiber->cstk);
+}
+
+void rak_fiber_deinit(RakFiber *fiber)
+{
+  reset(fiber);
   rak_stack_deinit(&fiber->vstk);
   rak_stack_deinit(&fiber->cstk);
 }
@@ -156,6 +175,18 @@ void rak_fiber_deinit(RakFiber *fiber)
 RakFiber *rak_fiber_new(RakArray *globals, int vstkSize, int cstkSize,
   RakClosure *cl, uint8_t nargs, RakValue *args, RakError *err)
 {
+  if (poolLen)
+  {
+    // Pooled fibers keep their stacks, which only have to grow if they are too small.
+    RakFiber *fiber = pool[--poolLen];
+    poolSize -= fiber_size(fiber);
+    start(fiber, globals, vstkSize, cl, nargs, args, err);
+    if (rak_is_ok(err)) return fiber;
+    rak_stack_deinit(&fiber->vstk);
+    rak_stack_deinit(&fiber->cstk);
+    rak_memory_free(fiber);
+    return NULL;
+  }
   RakFiber *fiber = rak_memory_alloc(sizeof(*fiber), err);
   if (!rak_is_ok(err)) return NULL;
   rak_fiber_init(fiber, globals, vstkSize, cstkSize, cl, nargs, args, err);
@@ -166,35 +197,137 @@ RakFiber *rak_fiber_new(RakArray *globals, int vstkSize, int cstkSize,
 
 void rak_fiber_free(RakFiber *fiber)
 {
-  rak_fiber_deinit(fiber);
+  rak_gc_forget(&fiber->obj);
+  reset(fiber);
+  size_t size = fiber_size(fiber);
+  if (poolLen < RAK_FIBER_POOL_MAX_LEN && poolSize + size <= RAK_FIBER_POOL_MAX_SIZE)
+  {
+    pool[poolLen++] = fiber;
+    poolSize += size;
+    return;
+  }
+  rak_stack_deinit(&fiber->vstk);
+  rak_stack_deinit(&fiber->cstk);
   rak_memory_free(fiber);
 }
 
+void rak_fiber_grow_vstk(RakFiber *fiber, int n, RakError *err)
+{
+  RakValue *base = fiber->vstk.base;
+  RakValue *top = fiber->vstk.top;
+  int len = (int) (top - base) + 1;
+  if (n > RAK_FIBER_VSTK_MAX_SIZE - len)
+  {
+    rak_error_set(err, "stack overflow");
+    return;
+  }
+  int cap = (int) (fiber->vstk.limit - base) + 1;
+  while (cap < len + n)
+    cap <<= 1;
+  if (cap > RAK_FIBER_VSTK_MAX_SIZE) cap = RAK_FIBER_VSTK_MAX_SIZE;
+  RakValue *_base = rak_memory_alloc(sizeof(*_base) * cap, err);
+  if (!rak_is_ok(err)) return;
+  // References only ever point into the stack of their own fiber, so they move along
+  // with the frames.
+  for (int i = 0; i < len; ++i)
+  {
+    RakValue val = base[i];
+    if (rak_is_ref(val))
+    {
+      RakValue *slot = rak_as_ref(val);
+      if (slot >= base && slot <= top) val = rak_ref_value(&_base[slot - base]);
+    }
+    _base[i] = val;
+  }
+  for (RakCallFrame *frame = fiber->cstk.base; frame <= fiber->cstk.top; ++frame)
+    frame->slots = &_base[frame->slots - base];
+  rak_memory_free(base);
+  fiber->vstk.base = _base;
+  fiber->vstk.top = &_base[len - 1];
+  fiber->vstk.limit = &_base[cap - 1];
+}
+
+void rak_fiber_grow_cstk(RakFiber *fiber, RakError *err)
+{
+  int len = (int) (fiber->cstk.top - fiber->cstk.base) + 1;
+  if (len == RAK_FIBER_CSTK_MAX_SIZE)
+  {
+    rak_error_set(err, "too many nested calls");
+    return;
+  }
+  int cap = len << 1;
+  if (cap > RAK_FIBER_CSTK_MAX_SIZE) cap = RAK_FIBER_CSTK_MAX_SIZE;
+  RakCallFrame *base = fiber->cstk.base;
+  RakCallFrame *_base = rak_memory_alloc(sizeof(*_base) * cap, err);
+  if (!rak_is_ok(err)) return;
+  memcpy(_base, base, sizeof(*_base) * len);
+  // The profiler samples the frames from a signal handler, which skips the sample
+  // while top is null. The stores are volatile and fenced so the compiler can neither
+  // drop nor reorder them, and the old buffer is only freed once the new one is in place.
+  signal_fence();
+  publish(fiber->cstk.top, NULL);
+  signal_fence();
+  publish(fiber->cstk.base, _base);
+  publish(fiber->cstk.limit, &_base[cap - 1]);
+  signal_fence();
+  publish(fiber->cstk.top, &_base[len - 1]);
+  signal_fence();
+  rak_memory_free(base);
+}
+
 void rak_fiber_release(RakFiber *fiber)
 {
   RakObject *obj = &fiber->obj;
   --obj->refCount;
-  if (obj->refCount) return;
+  if (obj->refCount)
+  {
+    rak_gc_possible_root(rak_fiber_value(fiber));
+    return;
+  }
   rak_fiber_free(fiber);
 }
 
 void rak_fiber_run(RakFiber *fiber, RakError *err)
 {
+  RakFiber *prev = current;
+  current = fiber;
+  rak_arena_set_current(&fiber->arena);
   fiber->status = RAK_FIBER_STATUS_RUNNING;
-  run(fiber, err);
+  run(fiber, false, err);
+  current = prev;
+  rak_arena_set_current(prev ? &prev->arena : NULL);
 }
 
 void rak_fiber_resume(RakFiber *fiber, RakError *err)
 {
+  RakFiber *prev = current;
+  current = fiber;
+  rak_arena_set_current(&fiber->arena);
   fiber->status = RAK_FIBER_STATUS_RUNNING;
-  resume(fiber, err);
+  run(fiber, true, err);
+  current = prev;
+  rak_arena_set_current(prev ? &prev->arena : NULL);
+}
+
+RakFiber *rak_fiber_current(void)
+{
+  return current;
 }
 
 void rak_fiber_print_error(RakFiber *fiber, RakError *err)
 {
   rak_error_print(err);
+  int n = 0;
   while (!rak_stack_is_empty(&fiber->cstk))
   {
+    if (n == RAK_FIBER_MAX_TRACE_FRAMES)
+    {
+      int rest = (int) (fiber->cstk.top - fiber->cstk.base) + 1;
+      fprintf(stderr, "  ... %d more frame(s)\n", rest);
+      rak_stack_clear(&fiber->cstk);
+      break;
+    }
+    ++n;
     RakCallFrame frame = rak_stack_get(&fiber->cstk, 0);
     rak_stack_pop(&fiber->cstk);
     RakClosure *cl = frame.cl;
@@ -10,6 +10,10 @@
 
 #include "rak/function.h"
 
+#ifdef RAK_JIT
+  #include "rak/jit.h"
+#endif
+
 RakFunction *rak_function_new(RakString *name, int arity, RakString *file,
   RakError *err)
 {
@@ -31,6 +35,9 @@ RakFunction *rak_function_new(RakString *name, int arity, RakString *file,
     return NULL;
   }
   rak_slice_init(&fn->nested, err);
+#ifdef RAK_JIT
+  fn->jit = NULL;
+#endif
   if (rak_is_ok(err)) return fn;
   rak_callable_deinit(&fn->callable);
   rak_chunk_deinit(&fn->chunk);
@@ -49,6 +56,9 @@ void rak_function_free(RakFunction *fn)
     rak_function_release(nested);
   }
   rak_slice_deinit(&fn->nested);
+#ifdef RAK_JIT
+  rak_jit_free(fn->jit);
+#endif
   rak_memory_free(fn);
 }
 
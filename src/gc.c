@@ -0,0 +1,378 @@
+//
+// gc.c
+//
+// Copyright 2025 Fábio de Souza Villaça Medeiros
+//
+// This file is part of the Rak Project.
+// For detailed license information, please refer to the LICENSE file
+// located in the root directory of this project.
+//
+
+#include "rak/gc.h"
+#include <stdio.h>
+#include "rak/arena.h"
+#include "rak/fiber.h"
+#include "rak/record.h"
+
+typedef RakSlice(RakValue) Values;
+
+typedef RakSlice(RakObject *) Objects;
+
+static RakGcStats stats = { 0 };
+static Objects immortals = { .cap = 0, .len = 0, .data = NULL };
+
+static inline void reserve(Values *vals, int cap, RakError *err);
+
+static inline void reserve(Values *vals, int cap, RakError *err)
+{
+  if (vals->data)
+  {
+    rak_slice_ensure_capacity(vals, cap, err);
+    return;
+  }
+  rak_slice_init_with_capacity(vals, cap, err);
+}
+
+void rak_gc_make_immortal(RakValue *val)
+{
+  if (!rak_is_refcounted(*val)) return;
+  RakObject *obj = rak_as_object(*val);
+  if (obj->refCount >= RAK_OBJECT_IMMORTAL)
+  {
+    rak_set_immortal(*val);
+    return;
+  }
+  RakError err;
+  rak_error_init(&err);
+  if (immortals.data)
+    rak_slice_ensure_capacity(&immortals, immortals.len + 1, &err);
+  else
+    rak_slice_init_with_capacity(&immortals, 1, &err);
+  if (!rak_is_ok(&err)) return;
+  // The count is set far from zero, so releases through a bare pointer, such as a field
+  // name, can never free the object, and it is kept reachable here until exit. The
+  // untagged pointer is stored, since a NaN-boxed word does not look like one to a leak
+  // checker.
+  obj->refCount = RAK_OBJECT_IMMORTAL;
+  rak_set_immortal(*val);
+  rak_slice_append(&immortals, obj);
+}
+
+#ifdef RAK_DEFERRED_FREE
+
+static Values deferred = { .cap = 0, .len = 0, .data = NULL };
+
+bool rak_gc_defer_free(RakValue val)
+{
+  RakError err;
+  rak_error_init(&err);
+  reserve(&deferred, deferred.len + 1, &err);
+  if (!rak_is_ok(&err)) return false;
+  rak_gc_forget(rak_as_object(val));
+  rak_slice_append(&deferred, val);
+  return true;
+}
+
+void rak_gc_drain(int n)
+{
+  // Children are released one at a time, and those that die are pushed on top, so a
+  // large structure is taken apart over several drains instead of in one recursive free.
+  while (deferred.len && n)
+  {
+    if (n > 0) --n;
+    RakValue val = rak_slice_get(&deferred, deferred.len - 1);
+    if (rak_is_array(val))
+    {
+      RakArray *arr = rak_as_array(val);
+      if (!rak_array_is_empty(arr))
+      {
+        --arr->slice.len;
+        rak_value_release(rak_array_get(arr, rak_array_len(arr)));
+        continue;
+      }
+      --deferred.len;
+      rak_array_free(arr);
+      ++stats.deferred;
+      continue;
+    }
+    RakRecord *rec = rak_as_record(val);
+    if (rak_record_len(rec))
+    {
+      --rec->slice.len;
+      RakRecordField field = rak_record_get(rec, rak_record_len(rec));
+      rak_string_release(field.name);
+      rak_value_release(field.val);
+      continue;
+    }
+    --deferred.len;
+    rak_record_free(rec);
+    ++stats.deferred;
+  }
+}
+
+#endif
+
+#ifdef RAK_CYCLE_COLLECTOR
+
+#define BLACK (0)
+#define GRAY  (1)
+#define WHITE (2)
+
+typedef void (*Visit)(RakValue val);
+
+static Values roots = { .cap = 0, .len = 0, .data = NULL };
+static Values batch = { .cap = 0, .len = 0, .data = NULL };
+static Values garbage = { .cap = 0, .len = 0, .data = NULL };
+static int nwhite = 0;
+
+static inline bool is_container(RakValue val);
+static void each_child(RakValue val, Visit visit);
+static void mark_gray(RakValue val);
+static void mark_gray_child(RakValue val);
+static void scan(RakValue val);
+static void scan_black(RakValue val);
+static void scan_black_child(RakValue val);
+static void collect_white(RakValue val);
+static void release_child(RakValue val);
+static void free_garbage(RakValue val);
+static int collect_roots(int n);
+
+static inline bool is_container(RakValue val)
+{
+  return rak_is_array(val) || rak_is_record(val) || rak_is_fiber(val);
+}
+
+static void each_child(RakValue val, Visit visit)
+{
+  if (rak_is_array(val))
+  {
+    RakArray *arr = rak_as_array(val);
+    int len = rak_array_len(arr);
+    for (int i = 0; i < len; ++i)
+    {
+      RakValue elem = rak_array_get(arr, i);
+      if (is_container(elem)) visit(elem);
+    }
+    return;
+  }
+  if (rak_is_record(val))
+  {
+    RakRecord *rec = rak_as_record(val);
+    int len = rak_record_len(rec);
+    for (int i = 0; i < len; ++i)
+    {
+      RakValue _val = rak_record_get(rec, i).val;
+      if (is_container(_val)) visit(_val);
+    }
+    return;
+  }
+  RakFiber *fiber = rak_as_fiber(val);
+  visit(rak_array_value(fiber->globals));
+  for (RakValue *slot = fiber->vstk.base; slot <= fiber->vstk.top; ++slot)
+    if (is_container(*slot)) visit(*slot);
+}
+
+static void mark_gray(RakValue val)
+{
+  RakObject *obj = rak_as_object(val);
+  if (obj->color == GRAY) return;
+  obj->color = GRAY;
+  ++stats.scanned;
+  each_child(val, mark_gray_child);
+}
+
+static void mark_gray_child(RakValue val)
+{
+  --rak_as_object(val)->refCount;
+  mark_gray(val);
+}
+
+static void scan(RakValue val)
+{
+  RakObject *obj = rak_as_object(val);
+  if (obj->color != GRAY) return;
+  if (obj->refCount > 0)
+  {
+    scan_black(val);
+    return;
+  }
+  obj->color = WHITE;
+  ++nwhite;
+  each_child(val, scan);
+}
+
+static void scan_black(RakValue val)
+{
+  rak_as_object(val)->color = BLACK;
+  each_child(val, scan_black_child);
+}
+
+static void scan_black_child(RakValue val)
+{
+  RakObject *obj = rak_as_object(val);
+  ++obj->refCount;
+  if (obj->color != BLACK) scan_black(val);
+}
+
+static void collect_white(RakValue val)
+{
+  RakObject *obj = rak_as_object(val);
+  if (obj->color != WHITE) return;
+  obj->color = BLACK;
+  if (obj->root) rak_gc_remove_root(obj);
+  each_child(val, collect_white);
+  rak_slice_append(&garbage, val);
+}
+
+static void release_child(RakValue val)
+{
+  // References between containers were already taken off by the trial deletion.
+  if (is_container(val)) return;
+  rak_value_release(val);
+}
+
+static void free_garbage(RakValue val)
+{
+  if (rak_is_array(val))
+  {
+    RakArray *arr = rak_as_array(val);
+    int len = rak_array_len(arr);
+    for (int i = 0; i < len; ++i)
+      release_child(rak_array_get(arr, i));
+    rak_slice_deinit(&arr->slice);
+    rak_memory_track_object(RAK_TYPE_ARRAY, -1);
+    rak_arena_free_object(arr);
+    return;
+  }
+  if (rak_is_record(val))
+  {
+    RakRecord *rec = rak_as_record(val);
+    int len = rak_record_len(rec);
+    for (int i = 0; i < len; ++i)
+    {
+      RakRecordField field = rak_record_get(rec, i);
+      rak_string_release(field.name);
+      release_child(field.val);
+    }
+    rak_slice_deinit(&rec->slice);
+    rak_shape_release(rec->shape);
+    rak_memory_track_object(RAK_TYPE_RECORD, -1);
+    rak_arena_free_object(rec);
+    return;
+  }
+  RakFiber *fiber = rak_as_fiber(val);
+  for (RakValue *slot = fiber->vstk.base; slot <= fiber->vstk.top; ++slot)
+    release_child(*slot);
+  rak_stack_deinit(&fiber->vstk);
+  rak_stack_deinit(&fiber->cstk);
+  rak_arena_deinit(&fiber->arena);
+  rak_memory_track_object(RAK_TYPE_FIBER, -1);
+  rak_memory_free(fiber);
+}
+
+static int collect_roots(int n)
+{
+  if (!n) return 0;
+  RakError err;
+  rak_error_init(&err);
+  reserve(&batch, n, &err);
+  if (!rak_is_ok(&err)) return 0;
+  for (int i = 0; i < n; ++i)
+  {
+    RakValue val = rak_slice_get(&roots, roots.len - 1);
+    --roots.len;
+    rak_as_object(val)->root = 0;
+    rak_slice_append(&batch, val);
+  }
+  ++stats.collections;
+  stats.roots += n;
+  for (int i = 0; i < n; ++i)
+    mark_gray(rak_slice_get(&batch, i));
+  nwhite = 0;
+  for (int i = 0; i < n; ++i)
+    scan(rak_slice_get(&batch, i));
+  reserve(&garbage, nwhite, &err);
+  if (!rak_is_ok(&err))
+  {
+    // Without room to record the garbage, undo the trial deletion and try again later.
+    for (int i = 0; i < n; ++i)
+    {
+      RakValue val = rak_slice_get(&batch, i);
+      if (rak_as_object(val)->color == WHITE) scan_black(val);
+    }
+    rak_slice_clear(&batch);
+    return 0;
+  }
+  for (int i = 0; i < n; ++i)
+    collect_white(rak_slice_get(&batch, i));
+  rak_slice_clear(&batch);
+  int len = garbage.len;
+  for (int i = 0; i < len; ++i)
+    free_garbage(rak_slice_get(&garbage, i));
+  rak_slice_clear(&garbage);
+  stats.freed += len;
+  return len;
+}
+
+void rak_gc_add_root(RakValue val)
+{
+  RakObject *obj = rak_as_object(val);
+  if (obj->root) return;
+  RakError err;
+  rak_error_init(&err);
+  reserve(&roots, roots.len + 1, &err);
+  if (!rak_is_ok(&err)) return;
+  rak_slice_append(&roots, val);
+  obj->root = roots.len;
+}
+
+void rak_gc_remove_root(RakObject *obj)
+{
+  int idx = obj->root - 1;
+  RakValue last = rak_slice_get(&roots, roots.len - 1);
+  rak_slice_set(&roots, idx, last);
+  rak_as_object(last)->root = idx + 1;
+  --roots.len;
+  obj->root = 0;
+}
+
+#endif
+
+#if defined(RAK_CYCLE_COLLECTOR) || defined(RAK_DEFERRED_FREE)
+
+void rak_gc_poll(void)
+{
+#ifdef RAK_DEFERRED_FREE
+  if (deferred.len) rak_gc_drain(RAK_GC_DRAIN_SIZE);
+#endif
+#ifdef RAK_CYCLE_COLLECTOR
+  if (roots.len >= RAK_GC_THRESHOLD) collect_roots(RAK_GC_STEP_ROOTS);
+#endif
+}
+
+#endif
+
+int rak_gc_collect(void)
+{
+  rak_gc_flush();
+#ifdef RAK_CYCLE_COLLECTOR
+  return collect_roots(roots.len);
+#else
+  return 0;
+#endif
+}
+
+RakGcStats rak_gc_stats(void)
+{
+  return stats;
+}
+
+void rak_gc_print_stats(void)
+{
+  fflush(stdout);
+  fprintf(stderr, "\n%-12s %16llu\n", "collections", (unsigned long long) stats.collections);
+  fprintf(stderr, "%-12s %16llu\n", "roots", (unsigned long long) stats.roots);
+  fprintf(stderr, "%-12s %16llu\n", "scanned", (unsigned long long) stats.scanned);
+  fprintf(stderr, "%-12s %16llu\n", "freed", (unsigned long long) stats.freed);
+  fprintf(stderr, "%-12s %16llu\n", "deferred", (unsigned long long) stats.deferred);
+}
@@ -0,0 +1,728 @@
+//
+// jit.c
+//
+// Copyright 2025 Fábio de Souza Villaça Medeiros
+//
+// This file is part of the Rak Project.
+// For detailed license information, please refer to the LICENSE file
+// located in the root directory of this project.
+//
+
+#include "rak/jit.h"
+#include "rak/vm.h"
+
+#if defined(__x86_64__) && defined(__linux__)
+  #define RAK_JIT_X86_64
+#endif
+
+#ifdef RAK_JIT_X86_64
+
+#include <stddef.h>
+#include <string.h>
+#include <sys/mman.h>
+
+typedef void (*Helper)(RakFiber *, RakClosure *, uint32_t *, RakValue *, RakError *);
+
+typedef void (*Entry)(RakFiber *, RakClosure *, uint32_t *, RakValue *, RakError *, void *);
+
+typedef struct
+{
+  size_t    size;
+  uint8_t  *mem;
+  void    **entries;
+} Code;
+
+typedef struct
+{
+  int pos;
+  int idx;
+} Fixup;
+
+typedef struct
+{
+  RakSlice(uint8_t) code;
+  RakSlice(int)     offs;
+  RakSlice(Fixup)   fixups;
+} Emitter;
+
+static Helper helpers[] = {
+  [RAK_OP_PUSH_NIL]               = rak_vm_push_nil,
+  [RAK_OP_PUSH_FALSE]             = rak_vm_push_false,
+  [RAK_OP_PUSH_TRUE]              = rak_vm_push_true,
+  [RAK_OP_PUSH_INT]               = rak_vm_push_int,
+  [RAK_OP_LOAD_CONST]             = rak_vm_load_const,
+  [RAK_OP_LOAD_GLOBAL]            = rak_vm_load_global,
+  [RAK_OP_LOAD_LOCAL]             = rak_vm_load_local,
+  [RAK_OP_STORE_LOCAL]            = rak_vm_store_local,
+  [RAK_OP_FETCH_LOCAL]            = rak_vm_fetch_local,
+  [RAK_OP_REF_LOCAL]              = rak_vm_ref_local,
+  [RAK_OP_LOAD_LOCAL_REF]         = rak_vm_load_local_ref,
+  [RAK_OP_STORE_LOCAL_REF]        = rak_vm_store_local_ref,
+  [RAK_OP_NEW_ARRAY]              = rak_vm_new_array,
+  [RAK_OP_NEW_RANGE]              = rak_vm_new_range,
+  [RAK_OP_NEW_RECORD]             = rak_vm_new_record,
+  [RAK_OP_NEW_CLOSURE]            = rak_vm_new_closure,
+  [RAK_OP_MOVE]                   = rak_vm_move,
+  [RAK_OP_POP]                    = rak_vm_pop,
+  [RAK_OP_GET_ELEMENT]            = rak_vm_get_element,
+  [RAK_OP_SET_ELEMENT]            = rak_vm_set_element,
+  [RAK_OP_LOAD_ELEMENT]           = rak_vm_load_element,
+  [RAK_OP_FETCH_ELEMENT]          = rak_vm_fetch_element,
+  [RAK_OP_UPDATE_ELEMENT]         = rak_vm_update_element,
+  [RAK_OP_GET_FIELD]              = rak_vm_get_field,
+  [RAK_OP_PUT_FIELD]              = rak_vm_put_field,
+  [RAK_OP_LOAD_FIELD]             = rak_vm_load_field,
+  [RAK_OP_FETCH_FIELD]            = rak_vm_fetch_field,
+  [RAK_OP_UPDATE_FIELD]           = rak_vm_update_field,
+  [RAK_OP_UNPACK_ELEMENTS]        = rak_vm_unpack_elements,
+  [RAK_OP_UNPACK_FIELDS]          = rak_vm_unpack_fields,
+  [RAK_OP_JUMP_IF_FALSE]          = rak_vm_jump_if_false,
+  [RAK_OP_JUMP_IF_FALSE_OR_POP]   = rak_vm_jump_if_false_or_pop,
+  [RAK_OP_JUMP_IF_TRUE_OR_POP]    = rak_vm_jump_if_true_or_pop,
+  [RAK_OP_EQ]                     = rak_vm_eq,
+  [RAK_OP_NE]                     = rak_vm_ne,
+  [RAK_OP_GT]                     = rak_vm_gt,
+  [RAK_OP_GE]                     = rak_vm_ge,
+  [RAK_OP_LT]                     = rak_vm_lt,
+  [RAK_OP_LE]                     = rak_vm_le,
+  [RAK_OP_EQ_LOCALS_JUMP_IF_FALSE]= rak_vm_eq_locals_jump_if_false,
+  [RAK_OP_EQ_CONST_JUMP_IF_FALSE] = rak_vm_eq_const_jump_if_false,
+  [RAK_OP_EQ_INT_JUMP_IF_FALSE]   = rak_vm_eq_int_jump_if_false,
+  [RAK_OP_NE_LOCALS_JUMP_IF_FALSE]= rak_vm_ne_locals_jump_if_false,
+  [RAK_OP_NE_CONST_JUMP_IF_FALSE] = rak_vm_ne_const_jump_if_false,
+  [RAK_OP_NE_INT_JUMP_IF_FALSE]   = rak_vm_ne_int_jump_if_false,
+  [RAK_OP_GT_LOCALS_JUMP_IF_FALSE]= rak_vm_gt_locals_jump_if_false,
+  [RAK_OP_GT_CONST_JUMP_IF_FALSE] = rak_vm_gt_const_jump_if_false,
+  [RAK_OP_GT_INT_JUMP_IF_FALSE]   = rak_vm_gt_int_jump_if_false,
+  [RAK_OP_GE_LOCALS_JUMP_IF_FALSE]= rak_vm_ge_locals_jump_if_false,
+  [RAK_OP_GE_CONST_JUMP_IF_FALSE] = rak_vm_ge_const_jump_if_false,
+  [RAK_OP_GE_INT_JUMP_IF_FALSE]   = rak_vm_ge_int_jump_if_false,
+  [RAK_OP_LT_LOCALS_JUMP_IF_FALSE]= rak_vm_lt_locals_jump_if_false,
+  [RAK_OP_LT_CONST_JUMP_IF_FALSE] = rak_vm_lt_const_jump_if_false,
+  [RAK_OP_LT_INT_JUMP_IF_FALSE]   = rak_vm_lt_int_jump_if_false,
+  [RAK_OP_LE_LOCALS_JUMP_IF_FALSE]= rak_vm_le_locals_jump_if_false,
+  [RAK_OP_LE_CONST_JUMP_IF_FALSE] = rak_vm_le_const_jump_if_false,
+  [RAK_OP_LE_INT_JUMP_IF_FALSE]   = rak_vm_le_int_jump_if_false,
+  [RAK_OP_ADD]                    = rak_vm_add,
+  [RAK_OP_ADD2]                   = rak_vm_add2,
+  [RAK_OP_ADD3]                   = rak_vm_add3,
+  [RAK_OP_SUB]                    = rak_vm_sub,
+  [RAK_OP_SUB2]                   = rak_vm_sub2,
+  [RAK_OP_SUB3]                   = rak_vm_sub3,
+  [RAK_OP_MUL]                    = rak_vm_mul,
+  [RAK_OP_MUL2]                   = rak_vm_mul2,
+  [RAK_OP_MUL3]                   = rak_vm_mul3,
+  [RAK_OP_DIV]                    = rak_vm_div,
+  [RAK_OP_DIV2]                   = rak_vm_div2,
+  [RAK_OP_DIV3]                   = rak_vm_div3,
+  [RAK_OP_MOD]                    = rak_vm_mod,
+  [RAK_OP_MOD2]                   = rak_vm_mod2,
+  [RAK_OP_MOD3]                   = rak_vm_mod3,
+  [RAK_OP_NOT]                    = rak_vm_not,
+  [RAK_OP_NEG]                    = rak_vm_neg,
+  [RAK_OP_CALL]                   = rak_vm_call,
+  [RAK_OP_TAIL_CALL]              = rak_vm_tail_call,
+  [RAK_OP_YIELD]                  = rak_vm_yield,
+  [RAK_OP_RETURN]                 = rak_vm_return,
+  [RAK_OP_RETURN_NIL]             = rak_vm_return_nil,
+  [RAK_OP_EQ_NUM]                 = rak_vm_eq_num,
+  [RAK_OP_NE_NUM]                 = rak_vm_ne_num,
+  [RAK_OP_GT_NUM]                 = rak_vm_gt_num,
+  [RAK_OP_GE_NUM]                 = rak_vm_ge_num,
+  [RAK_OP_LT_NUM]                 = rak_vm_lt_num,
+  [RAK_OP_LE_NUM]                 = rak_vm_le_num,
+  [RAK_OP_ADD_NUM]                = rak_vm_add_num,
+  [RAK_OP_ADD2_NUM]               = rak_vm_add2_num,
+  [RAK_OP_ADD3_NUM]               = rak_vm_add3_num,
+};
+
+static bool enabled = false;
+static Code unsupported;
+
+static inline void emitter_init(Emitter *emit, int len, RakError *err);
+static inline void emitter_deinit(Emitter *emit);
+static inline void emit_bytes(Emitter *emit, int n, const uint8_t *bytes, RakError *err);
+static inline void emit_u32(Emitter *emit, uint32_t data, RakError *err);
+static inline void emit_u64(Emitter *emit, uint64_t data, RakError *err);
+static inline void emit_label(Emitter *emit, int idx, RakError *err);
+static inline void emit_prologue(Emitter *emit, RakError *err);
+static inline void emit_epilogue(Emitter *emit, RakError *err);
+static inline void emit_call(Emitter *emit, Helper helper, uint32_t *ip, RakError *err);
+static inline void emit_check(Emitter *emit, int exit, RakError *err);
+static inline void emit_jump(Emitter *emit, int idx, RakError *err);
+static inline void emit_branch(Emitter *emit, uint32_t *target, int idx, RakError *err);
+static inline int emit_guard_number(Emitter *emit, uint8_t slot, RakError *err);
+static inline void emit_load_number(Emitter *emit, uint8_t slot, int xmm, RakError *err);
+static inline void emit_load_imm(Emitter *emit, double num, int xmm, RakError *err);
+static inline int emit_store_number(Emitter *emit, uint8_t slot, RakError *err);
+static inline void emit_patch(Emitter *emit, int pos);
+static inline void emit_arith(Emitter *emit, RakOpcode op, uint32_t *ip, int idx, RakError *err);
+static inline void emit_compare(Emitter *emit, RakChunk *chunk, RakOpcode op, uint32_t *ip, int idx,
+  RakError *err);
+static inline void emit_instr(Emitter *emit, RakChunk *chunk, int idx, int exit, RakError *err);
+static inline Code *install(Emitter *emit, RakError *err);
+static Code *compile(RakFunction *fn, RakError *err);
+
+static inline void emitter_init(Emitter *emit, int len, RakError *err)
+{
+  rak_slice_init_with_capacity(&emit->code, len << 5, err);
+  if (!rak_is_ok(err)) return;
+  rak_slice_init_with_capacity(&emit->offs, len + 1, err);
+  if (!rak_is_ok(err))
+  {
+    rak_slice_deinit(&emit->code);
+    return;
+  }
+  rak_slice_init(&emit->fixups, err);
+  if (rak_is_ok(err)) return;
+  rak_slice_deinit(&emit->code);
+  rak_slice_deinit(&emit->offs);
+}
+
+static inline void emitter_deinit(Emitter *emit)
+{
+  rak_slice_deinit(&emit->code);
+  rak_slice_deinit(&emit->offs);
+  rak_slice_deinit(&emit->fixups);
+}
+
+static inline void emit_bytes(Emitter *emit, int n, const uint8_t *bytes, RakError *err)
+{
+  rak_slice_ensure_capacity(&emit->code, emit->code.len + n, err);
+  if (!rak_is_ok(err)) return;
+  memcpy(&emit->code.data[emit->code.len], bytes, n);
+  emit->code.len += n;
+}
+
+static inline void emit_u32(Emitter *emit, uint32_t data, RakError *err)
+{
+  uint8_t bytes[4];
+  memcpy(bytes, &data, sizeof(bytes));
+  emit_bytes(emit, sizeof(bytes), bytes, err);
+}
+
+static inline void emit_u64(Emitter *emit, uint64_t data, RakError *err)
+{
+  uint8_t bytes[8];
+  memcpy(bytes, &data, sizeof(bytes));
+  emit_bytes(emit, sizeof(bytes), bytes, err);
+}
+
+static inline void emit_label(Emitter *emit, int idx, RakError *err)
+{
+  Fixup fixup = {
+    .pos = emit->code.len,
+    .idx = idx
+  };
+  rak_slice_ensure_append(&emit->fixups, fixup, err);
+  if (!rak_is_ok(err)) return;
+  const uint8_t rel[] = { 0x00, 0x00, 0x00, 0x00 };
+  emit_bytes(emit, sizeof(rel), rel, err);
+}
+
+static inline void emit_prologue(Emitter *emit, RakError *err)
+{
+  const uint8_t bytes[] = {
+    0x53,             // push rbx
+    0x41, 0x54,       // push r12
+    0x41, 0x55,       // push r13
+    0x41, 0x56,       // push r14
+    0x41, 0x57,       // push r15
+    0x48, 0x89, 0xfb, // mov rbx, rdi
+    0x49, 0x89, 0xf4, // mov r12, rsi
+    0x49, 0x89, 0xcd, // mov r13, rcx
+    0x4d, 0x89, 0xc6, // mov r14, r8
+    0x41, 0xff, 0xe1  // jmp r9
+  };
+  emit_bytes(emit, sizeof(bytes), bytes, err);
+}
+
+static inline void emit_epilogue(Emitter *emit, RakError *err)
+{
+  const uint8_t bytes[] = {
+    0x41, 0x5f, // pop r15
+    0x41, 0x5e, // pop r14
+    0x41, 0x5d, // pop r13
+    0x41, 0x5c, // pop r12
+    0x5b,       // pop rbx
+    0xc3        // ret
+  };
+  emit_bytes(emit, sizeof(bytes), bytes, err);
+}
+
+static inline void emit_call(Emitter *emit, Helper helper, uint32_t *ip, RakError *err)
+{
+  const uint8_t args[] = {
+    0x48, 0x89, 0xdf, // mov rdi, rbx
+    0x4c, 0x89, 0xe6, // mov rsi, r12
+    0x4c, 0x89, 0xe9, // mov rcx, r13
+    0x4d, 0x89, 0xf0, // mov r8, r14
+    0x48, 0xba        // movabs rdx, ip
+  };
+  emit_bytes(emit, sizeof(args), args, err);
+  if (!rak_is_ok(err)) return;
+  emit_u64(emit, (uint64_t) (uintptr_t) ip, err);
+  if (!rak_is_ok(err)) return;
+  const uint8_t mov[] = { 0x48, 0xb8 }; // movabs rax, helper
+  emit_bytes(emit, sizeof(mov), mov, err);
+  if (!rak_is_ok(err)) return;
+  emit_u64(emit, (uint64_t) (uintptr_t) helper, err);
+  if (!rak_is_ok(err)) return;
+  const uint8_t call[] = { 0xff, 0xd0 }; // call rax
+  emit_bytes(emit, sizeof(call), call, err);
+}
+
+static inline void emit_check(Emitter *emit, int exit, RakError *err)
+{
+  const uint8_t bytes[] = {
+    0x41, 0x80, 0x3e, 0x00, // cmp byte [r14], 0
+    0x0f, 0x84              // je exit
+  };
+  emit_bytes(emit, sizeof(bytes), bytes, err);
+  if (!rak_is_ok(err)) return;
+  emit_label(emit, exit, err);
+}
+
+static inline void emit_jump(Emitter *emit, int idx, RakError *err)
+{
+  const uint8_t bytes[] = { 0xe9 }; // jmp idx
+  emit_bytes(emit, sizeof(bytes), bytes, err);
+  if (!rak_is_ok(err)) return;
+  emit_label(emit, idx, err);
+}
+
+static inline void emit_branch(Emitter *emit, uint32_t *target, int idx, RakError *err)
+{
+  int top = (int) offsetof(RakFiber, cstk.top);
+  int state = (int) offsetof(RakCallFrame, state);
+  const uint8_t load[] = { 0x48, 0x8b, 0x83 }; // mov rax, [rbx + top]
+  emit_bytes(emit, sizeof(load), load, err);
+  if (!rak_is_ok(err)) return;
+  const uint8_t disp[] = {
+    (uint8_t) top,
+    (uint8_t) (top >> 8),
+    (uint8_t) (top >> 16),
+    (uint8_t) (top >> 24),
+    0x48, 0x8b, 0x40, (uint8_t) state, // mov rax, [rax + state]
+    0x49, 0xbb                         // movabs r11, target
+  };
+  emit_bytes(emit, sizeof(disp), disp, err);
+  if (!rak_is_ok(err)) return;
+  emit_u64(emit, (uint64_t) (uintptr_t) target, err);
+  if (!rak_is_ok(err)) return;
+  const uint8_t cmp[] = {
+    0x4c, 0x39, 0xd8, // cmp rax, r11
+    0x0f, 0x84        // je idx
+  };
+  emit_bytes(emit, sizeof(cmp), cmp, err);
+  if (!rak_is_ok(err)) return;
+  emit_label(emit, idx, err);
+}
+
+static inline int emit_guard_number(Emitter *emit, uint8_t slot, RakError *err)
+{
+  uint32_t disp = slot * sizeof(RakValue);
+#ifdef RAK_NAN_BOXING
+  const uint8_t load[] = { 0x49, 0x8b, 0x85 }; // mov rax, [r13 + disp]
+  emit_bytes(emit, sizeof(load), load, err);
+  if (!rak_is_ok(err)) return 0;
+  emit_u32(emit, disp, err);
+  if (!rak_is_ok(err)) return 0;
+  const uint8_t mov[] = { 0x49, 0xbb }; // movabs r11, tagged
+  emit_bytes(emit, sizeof(mov), mov, err);
+  if (!rak_is_ok(err)) return 0;
+  emit_u64(emit, RAK_NAN_BOXING_TAGGED, err);
+  if (!rak_is_ok(err)) return 0;
+  const uint8_t cmp[] = {
+    0x4c, 0x39, 0xd8, // cmp rax, r11
+    0x0f, 0x83        // jae slow
+  };
+  emit_bytes(emit, sizeof(cmp), cmp, err);
+#else
+  const uint8_t cmp[] = { 0x41, 0x81, 0xbd }; // cmp dword [r13 + disp], number
+  emit_bytes(emit, sizeof(cmp), cmp, err);
+  if (!rak_is_ok(err)) return 0;
+  emit_u32(emit, disp + offsetof(RakValue, type), err);
+  if (!rak_is_ok(err)) return 0;
+  emit_u32(emit, RAK_TYPE_NUMBER, err);
+  if (!rak_is_ok(err)) return 0;
+  const uint8_t jne[] = { 0x0f, 0x85 }; // jne slow
+  emit_bytes(emit, sizeof(jne), jne, err);
+#endif
+  if (!rak_is_ok(err)) return 0;
+  int pos = emit->code.len;
+  emit_u32(emit, 0, err);
+  return pos;
+}
+
+static inline void emit_load_number(Emitter *emit, uint8_t slot, int xmm, RakError *err)
+{
+  uint32_t disp = slot * sizeof(RakValue);
+#ifndef RAK_NAN_BOXING
+  disp += offsetof(RakValue, opaque);
+#endif
+  const uint8_t bytes[] = { 0xf2, 0x41, 0x0f, 0x10, (uint8_t) (0x85 | (xmm << 3)) }; // movsd xmm, [r13 + disp]
+  emit_bytes(emit, sizeof(bytes), bytes, err);
+  if (!rak_is_ok(err)) return;
+  emit_u32(emit, disp, err);
+}
+
+static inline void emit_load_imm(Emitter *emit, double num, int xmm, RakError *err)
+{
+  uint64_t bits;
+  memcpy(&bits, &num, sizeof(bits));
+  const uint8_t mov[] = { 0x49, 0xbb }; // movabs r11, num
+  emit_bytes(emit, sizeof(mov), mov, err);
+  if (!rak_is_ok(err)) return;
+  emit_u64(emit, bits, err);
+  if (!rak_is_ok(err)) return;
+  const uint8_t movq[] = { 0x66, 0x49, 0x0f, 0x6e, (uint8_t) (0xc3 | (xmm << 3)) }; // movq xmm, r11
+  emit_bytes(emit, sizeof(movq), movq, err);
+}
+
+static inline int emit_store_number(Emitter *emit, uint8_t slot, RakError *err)
+{
+  uint32_t disp = slot * sizeof(RakValue);
+  int pos = -1;
+#ifdef RAK_NAN_BOXING
+  const uint8_t check[] = {
+    0x66, 0x0f, 0x2e, 0xc0, // ucomisd xmm0, xmm0
+    0x0f, 0x8a              // jp slow
+  };
+  emit_bytes(emit, sizeof(check), check, err);
+  if (!rak_is_ok(err)) return pos;
+  pos = emit->code.len;
+  emit_u32(emit, 0, err);
+  if (!rak_is_ok(err)) return pos;
+#else
+  disp += offsetof(RakValue, opaque);
+#endif
+  const uint8_t bytes[] = { 0xf2, 0x41, 0x0f, 0x11, 0x85 }; // movsd [r13 + disp], xmm0
+  emit_bytes(emit, sizeof(bytes), bytes, err);
+  if (!rak_is_ok(err)) return pos;
+  emit_u32(emit, disp, err);
+  return pos;
+}
+
+static inline void emit_patch(Emitter *emit, int pos)
+{
+  int32_t rel = emit->code.len - (pos + 4);
+  memcpy(&emit->code.data[pos], &rel, sizeof(rel));
+}
+
+static inline void emit_arith(Emitter *emit, RakOpcode op, uint32_t *ip, int idx, RakError *err)
+{
+  uint8_t dst = rak_instr_a(*ip);
+  uint8_t lhs = rak_instr_b(*ip);
+  uint8_t rhs = rak_instr_c(*ip);
+  int slow[4];
+  slow[0] = emit_guard_number(emit, dst, err);
+  if (!rak_is_ok(err)) return;
+  slow[1] = emit_guard_number(emit, lhs, err);
+  if (!rak_is_ok(err)) return;
+  slow[2] = emit_guard_number(emit, rhs, err);
+  if (!rak_is_ok(err)) return;
+  emit_load_number(emit, lhs, 0, err);
+  if (!rak_is_ok(err)) return;
+  emit_load_number(emit, rhs, 1, err);
+  if (!rak_is_ok(err)) return;
+  uint8_t code = op == RAK_OP_SUB3 ? 0x5c : op == RAK_OP_MUL3 ? 0x59 : 0x58;
+  const uint8_t bytes[] = { 0xf2, 0x0f, code, 0xc1 }; // addsd/subsd/mulsd xmm0, xmm1
+  emit_bytes(emit, sizeof(bytes), bytes, err);
+  if (!rak_is_ok(err)) return;
+  slow[3] = emit_store_number(emit, dst, err);
+  if (!rak_is_ok(err)) return;
+  emit_jump(emit, idx + 1, err);
+  if (!rak_is_ok(err)) return;
+  for (int i = 0; i < 4; ++i)
+  {
+    if (slow[i] < 0) continue;
+    emit_patch(emit, slow[i]);
+  }
+}
+
+static inline void emit_compare(Emitter *emit, RakChunk *chunk, RakOpcode op, uint32_t *ip, int idx,
+  RakError *err)
+{
+  bool isConst = op == RAK_OP_GT_CONST_JUMP_IF_FALSE || op == RAK_OP_GE_CONST_JUMP_IF_FALSE
+    || op == RAK_OP_LT_CONST_JUMP_IF_FALSE || op == RAK_OP_LE_CONST_JUMP_IF_FALSE;
+  bool isInt = op == RAK_OP_GT_INT_JUMP_IF_FALSE || op == RAK_OP_GE_INT_JUMP_IF_FALSE
+    || op == RAK_OP_LT_INT_JUMP_IF_FALSE || op == RAK_OP_LE_INT_JUMP_IF_FALSE;
+  uint8_t lhs = rak_instr_a(*ip);
+  uint8_t rhs = rak_instr_b(*ip);
+  if (isConst && !rak_is_number(rak_slice_get(&chunk->consts, rhs))) return;
+  bool gt = op == RAK_OP_GT_LOCALS_JUMP_IF_FALSE || op == RAK_OP_GT_CONST_JUMP_IF_FALSE
+    || op == RAK_OP_GT_INT_JUMP_IF_FALSE;
+  bool ge = op == RAK_OP_GE_LOCALS_JUMP_IF_FALSE || op == RAK_OP_GE_CONST_JUMP_IF_FALSE
+    || op == RAK_OP_GE_INT_JUMP_IF_FALSE;
+  bool lt = op == RAK_OP_LT_LOCALS_JUMP_IF_FALSE || op == RAK_OP_LT_CONST_JUMP_IF_FALSE
+    || op == RAK_OP_LT_INT_JUMP_IF_FALSE;
+  bool le = op == RAK_OP_LE_LOCALS_JUMP_IF_FALSE || op == RAK_OP_LE_CONST_JUMP_IF_FALSE
+    || op == RAK_OP_LE_INT_JUMP_IF_FALSE;
+  int slow[2] = { -1, -1 };
+  slow[0] = emit_guard_number(emit, lhs, err);
+  if (!rak_is_ok(err)) return;
+  emit_load_number(emit, lhs, 0, err);
+  if (!rak_is_ok(err)) return;
+  if (isConst)
+    emit_load_imm(emit, rak_as_number(rak_slice_get(&chunk->consts, rhs)), 1, err);
+  else if (isInt)
+    emit_load_imm(emit, rhs, 1, err);
+  else
+  {
+    slow[1] = emit_guard_number(emit, rhs, err);
+    if (!rak_is_ok(err)) return;
+    emit_load_number(emit, rhs, 1, err);
+  }
+  if (!rak_is_ok(err)) return;
+  const uint8_t diff[] = {
+    0x66, 0x0f, 0x28, 0xd0, // movapd xmm2, xmm0
+    0xf2, 0x0f, 0x5c, 0xd1  // subsd xmm2, xmm1
+  };
+  emit_bytes(emit, sizeof(diff), diff, err);
+  if (!rak_is_ok(err)) return;
+  emit_load_imm(emit, -0.0, 3, err);
+  if (!rak_is_ok(err)) return;
+  const uint8_t abs[] = { 0x66, 0x0f, 0x55, 0xda }; // andnpd xmm3, xmm2
+  emit_bytes(emit, sizeof(abs), abs, err);
+  if (!rak_is_ok(err)) return;
+  emit_load_imm(emit, RAK_NUMBER_EPSILON, 2, err);
+  if (!rak_is_ok(err)) return;
+  const uint8_t zero[] = {
+    0x66, 0x0f, 0x2e, 0xd3, // ucomisd xmm2, xmm3
+    0x0f, 0x87              // ja zero
+  };
+  emit_bytes(emit, sizeof(zero), zero, err);
+  if (!rak_is_ok(err)) return;
+  emit_label(emit, (ge || le) ? idx + 2 : idx + 1, err);
+  if (!rak_is_ok(err)) return;
+  const uint8_t pos[] = {
+    0x66, 0x0f, 0x2e, 0xc1, // ucomisd xmm0, xmm1
+    0x0f, 0x87              // ja pos
+  };
+  emit_bytes(emit, sizeof(pos), pos, err);
+  if (!rak_is_ok(err)) return;
+  emit_label(emit, (gt || ge) ? idx + 2 : idx + 1, err);
+  if (!rak_is_ok(err)) return;
+  emit_jump(emit, (lt || le) ? idx + 2 : idx + 1, err);
+  if (!rak_is_ok(err)) return;
+  for (int i = 0; i < 2; ++i)
+  {
+    if (slow[i] < 0) continue;
+    emit_patch(emit, slow[i]);
+  }
+}
+
+static inline void emit_instr(Emitter *emit, RakChunk *chunk, int idx, int exit, RakError *err)
+{
+  uint32_t *instrs = chunk->instrs.data;
+  uint32_t *ip = &instrs[idx];
+  RakOpcode op = rak_instr_opcode(*ip);
+  switch (op)
+  {
+  case RAK_OP_NOP:
+    break;
+  case RAK_OP_JUMP:
+    emit_jump(emit, rak_instr_ab(*ip), err);
+    break;
+  case RAK_OP_JUMP_IF_FALSE:
+  case RAK_OP_JUMP_IF_FALSE_OR_POP:
+  case RAK_OP_JUMP_IF_TRUE_OR_POP:
+    {
+      uint16_t off = rak_instr_ab(*ip);
+      emit_call(emit, helpers[op], ip, err);
+      if (!rak_is_ok(err)) break;
+      emit_check(emit, exit, err);
+      if (!rak_is_ok(err)) break;
+      emit_branch(emit, &instrs[off], off, err);
+    }
+    break;
+  case RAK_OP_GT_LOCALS_JUMP_IF_FALSE:
+  case RAK_OP_GT_CONST_JUMP_IF_FALSE:
+  case RAK_OP_GT_INT_JUMP_IF_FALSE:
+  case RAK_OP_GE_LOCALS_JUMP_IF_FALSE:
+  case RAK_OP_GE_CONST_JUMP_IF_FALSE:
+  case RAK_OP_GE_INT_JUMP_IF_FALSE:
+  case RAK_OP_LT_LOCALS_JUMP_IF_FALSE:
+  case RAK_OP_LT_CONST_JUMP_IF_FALSE:
+  case RAK_OP_LT_INT_JUMP_IF_FALSE:
+  case RAK_OP_LE_LOCALS_JUMP_IF_FALSE:
+  case RAK_OP_LE_CONST_JUMP_IF_FALSE:
+  case RAK_OP_LE_INT_JUMP_IF_FALSE:
+    emit_compare(emit, chunk, op, ip, idx, err);
+    if (!rak_is_ok(err)) break;
+    emit_call(emit, helpers[op], ip, err);
+    if (!rak_is_ok(err)) break;
+    emit_check(emit, exit, err);
+    if (!rak_is_ok(err)) break;
+    emit_branch(emit, ip + 2, idx + 2, err);
+    break;
+  case RAK_OP_EQ_LOCALS_JUMP_IF_FALSE:
+  case RAK_OP_EQ_CONST_JUMP_IF_FALSE:
+  case RAK_OP_EQ_INT_JUMP_IF_FALSE:
+  case RAK_OP_NE_LOCALS_JUMP_IF_FALSE:
+  case RAK_OP_NE_CONST_JUMP_IF_FALSE:
+  case RAK_OP_NE_INT_JUMP_IF_FALSE:
+    emit_call(emit, helpers[op], ip, err);
+    if (!rak_is_ok(err)) break;
+    emit_check(emit, exit, err);
+    if (!rak_is_ok(err)) break;
+    emit_branch(emit, ip + 2, idx + 2, err);
+    break;
+  case RAK_OP_ADD3:
+  case RAK_OP_ADD3_NUM:
+  case RAK_OP_SUB3:
+  case RAK_OP_MUL3:
+    emit_arith(emit, op, ip, idx, err);
+    if (!rak_is_ok(err)) break;
+    emit_call(emit, helpers[op], ip, err);
+    if (!rak_is_ok(err)) break;
+    emit_check(emit, exit, err);
+    break;
+  case RAK_OP_CALL:
+  case RAK_OP_TAIL_CALL:
+  case RAK_OP_YIELD:
+  case RAK_OP_RETURN:
+  case RAK_OP_RETURN_NIL:
+    emit_call(emit, helpers[op], ip, err);
+    if (!rak_is_ok(err)) break;
+    emit_jump(emit, exit, err);
+    break;
+  default:
+    if (op >= (int) (sizeof(helpers) / sizeof(*helpers)) || !helpers[op])
+    {
+      rak_error_set(err, "unsupported opcode %d", op);
+      break;
+    }
+    emit_call(emit, helpers[op], ip, err);
+    if (!rak_is_ok(err)) break;
+    emit_check(emit, exit, err);
+    break;
+  }
+}
+
+static inline Code *install(Emitter *emit, RakError *err)
+{
+  size_t size = emit->code.len;
+  uint8_t *mem = mmap(NULL, size, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+  if (mem == MAP_FAILED)
+  {
+    rak_error_set(err, "cannot map executable memory");
+    return NULL;
+  }
+  memcpy(mem, emit->code.data, size);
+  if (mprotect(mem, size, PROT_READ | PROT_EXEC))
+  {
+    rak_error_set(err, "cannot map executable memory");
+    munmap(mem, size);
+    return NULL;
+  }
+  int len = emit->offs.len - 1;
+  Code *code = rak_memory_alloc(sizeof(*code), err);
+  if (!rak_is_ok(err))
+  {
+    munmap(mem, size);
+    return NULL;
+  }
+  code->entries = rak_memory_alloc(sizeof(*code->entries) * len, err);
+  if (!rak_is_ok(err))
+  {
+    rak_memory_free(code);
+    munmap(mem, size);
+    return NULL;
+  }
+  for (int i = 0; i < len; ++i)
+    code->entries[i] = &mem[rak_slice_get(&emit->offs, i)];
+  code->size = size;
+  code->mem = mem;
+  return code;
+}
+
+static Code *compile(RakFunction *fn, RakError *err)
+{
+  RakChunk *chunk = &fn->chunk;
+  int len = chunk->instrs.len;
+  Emitter emit = {0};
+  emitter_init(&emit, len, err);
+  if (!rak_is_ok(err)) return NULL;
+  emit_prologue(&emit, err);
+  for (int i = 0; i < len && rak_is_ok(err); ++i)
+  {
+    rak_slice_append(&emit.offs, emit.code.len);
+    emit_instr(&emit, chunk, i, len, err);
+  }
+  if (!rak_is_ok(err)) goto end;
+  rak_slice_append(&emit.offs, emit.code.len);
+  emit_epilogue(&emit, err);
+  if (!rak_is_ok(err)) goto end;
+  for (int i = 0; i < emit.fixups.len; ++i)
+  {
+    Fixup fixup = rak_slice_get(&emit.fixups, i);
+    int32_t rel = rak_slice_get(&emit.offs, fixup.idx) - (fixup.pos + 4);
+    memcpy(&emit.code.data[fixup.pos], &rel, sizeof(rel));
+  }
+  Code *code = install(&emit, err);
+  emitter_deinit(&emit);
+  return code;
+end:
+  emitter_deinit(&emit);
+  return NULL;
+}
+
+void rak_jit_enable(void)
+{
+  enabled = true;
+}
+
+bool rak_jit_dispatch(RakFiber *fiber, RakClosure *cl, uint32_t *ip, RakValue *slots, RakError *err)
+{
+  if (!enabled) return false;
+  RakFunction *fn = (RakFunction *) cl->callable;
+  Code *code = fn->jit;
+  if (!code)
+  {
+    RakError _err;
+    rak_error_init(&_err);
+    code = compile(fn, &_err);
+    if (!rak_is_ok(&_err)) code = &unsupported;
+    fn->jit = code;
+  }
+  if (code == &unsupported) return false;
+  void *entry = code->entries[ip - fn->chunk.instrs.data];
+  rak_object_retain(&fn->callable.obj);
+  ((Entry) (uintptr_t) code->mem)(fiber, cl, ip, slots, err, entry);
+  rak_function_release(fn);
+  return true;
+}
+
+void rak_jit_free(void *code)
+{
+  Code *_code = code;
+  if (!_code || _code == &unsupported) return;
+  munmap(_code->mem, _code->size);
+  rak_memory_free(_code->entries);
+  rak_memory_free(_code);
+}
+
+#else
+
+void rak_jit_enable(void)
+{
+}
+
+bool rak_jit_dispatch(RakFiber *fiber, RakClosure *cl, uint32_t *ip, RakValue *slots, RakError *err)
+{
+  (void) fiber;
+  (void) cl;
+  (void) ip;
+  (void) slots;
+  (void) err;
+  return false;
+}
+
+void rak_jit_free(void *code)
+{
+  (void) code;
+}
+
+#endif
@@ -302,6 +302,7 @@ void rak_lexer_init(RakLexer *lex, RakString *file, RakString *source, RakError
   lex->ln = 1;
   lex->col = 1;
   skip_shebang(lex);
+  lex->tok.ln = 1;
   rak_lexer_next(lex, err);
 }
 
@@ -313,6 +314,7 @@ void rak_lexer_deinit(RakLexer *lex)
 
 void rak_lexer_next(RakLexer *lex, RakError *err)
 {
+  lex->prevLn = lex->tok.ln;
   skip_whitespace_comments(lex);
   if (match_char(lex, '\0', RAK_TOKEN_KIND_EOF)) return;
   if (match_char(lex, ',', RAK_TOKEN_KIND_COMMA)) return;
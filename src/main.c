@@ -8,7 +8,9 @@
 // located in the root directory of this project.
 //
 
+#include <ctype.h>
 #include <signal.h>
+#include <stdint.h>
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
@@ -16,13 +18,18 @@
 
 static void shutdown(int sig);
 static bool has_opt(int argc, const char *argv[], const char *opt);
+static const char *get_opt_value(int argc, const char *argv[], const char *opt);
 static const char *get_arg(int argc, const char *argv[], int idx);
+static bool parse_size(const char *cstr, size_t *size);
 static RakString *read_from_stdin(RakError *err);
 static RakString *read_from_file(const char *path, RakError *err);
 static FILE *open_file(const char *path, RakError *err);
 static int file_size(FILE *fp);
 static RakClosure *compile_from_stdin(RakError *err);
 static RakClosure *compile_from_file(const char *path, RakError *err);
+static void stop_profiler(RakClosure *cl, RakArray *globals);
+static void stop_line_profiler(RakClosure *cl);
+static void print_vm_stats(void);
 
 static void shutdown(int sig)
 {
@@ -39,6 +46,15 @@ static bool has_opt(int argc, const char *argv[], const char *opt)
   return false;
 }
 
+static const char *get_opt_value(int argc, const char *argv[], const char *opt)
+{
+  size_t len = strlen(opt);
+  for (int i = 1; i < argc; ++i)
+    if (!strncmp(argv[i], opt, len))
+      return &argv[i][len];
+  return NULL;
+}
+
 static const char *get_arg(int argc, const char *argv[], int idx)
 {
   int j = 0;
@@ -51,6 +67,23 @@ static const char *get_arg(int argc, const char *argv[], int idx)
   return NULL;
 }
 
+static bool parse_size(const char *cstr, size_t *size)
+{
+  if (!isdigit((unsigned char) cstr[0])) return false;
+  char *end;
+  unsigned long long n = strtoull(cstr, &end, 10);
+  int shift = 0;
+  switch (*end)
+  {
+  case 'K': case 'k': shift = 10; ++end; break;
+  case 'M': case 'm': shift = 20; ++end; break;
+  case 'G': case 'g': shift = 30; ++end; break;
+  }
+  if (*end || n > (SIZE_MAX >> shift)) return false;
+  *size = (size_t) n << shift;
+  return true;
+}
+
 static RakString *read_from_stdin(RakError *err)
 {
   rak_error_init(err);
@@ -147,11 +180,53 @@ static RakClosure *compile_from_file(const char *path, RakError *err)
   return rak_compile(file, source, err);
 }
 
+static void stop_profiler(RakClosure *cl, RakArray *globals)
+{
+  RakError err;
+  rak_error_init(&err);
+  rak_profiler_stop(cl, globals, &err);
+  if (!rak_is_ok(&err))
+    rak_error_print(&err);
+  rak_closure_release(cl);
+}
+
+static void stop_line_profiler(RakClosure *cl)
+{
+  RakError err;
+  rak_error_init(&err);
+  rak_line_profiler_stop(&err);
+  if (!rak_is_ok(&err))
+    rak_error_print(&err);
+  rak_closure_release(cl);
+}
+
+static void print_vm_stats(void)
+{
+#ifdef RAK_VM_STATS
+  rak_vm_print_stats(RAK_VM_STATS_TOP);
+#else
+  fflush(stdout);
+  fprintf(stderr, "\nopcode counts are only available when built with RAK_VM_STATS\n");
+#endif
+}
+
 int main(int argc, const char *argv[])
 {
   signal(SIGINT, shutdown);
   RakError err;
   rak_error_init(&err);
+  const char *maxMemory = get_opt_value(argc, argv, "--max-memory=");
+  if (maxMemory)
+  {
+    size_t limit;
+    if (!parse_size(maxMemory, &limit))
+    {
+      rak_error_set(&err, "invalid memory limit '%s'", maxMemory);
+      rak_error_print(&err);
+      return EXIT_FAILURE;
+    }
+    rak_memory_set_limit(limit);
+  }
   const char *path = get_arg(argc, argv, 0);
   RakClosure *cl = path
     ? compile_from_file(path, &err)
@@ -167,6 +242,12 @@ int main(int argc, const char *argv[])
     rak_closure_free(cl);
     return EXIT_SUCCESS;
   }
+  bool lineProfile = has_opt(argc, argv, "--line-profile");
+#ifdef RAK_JIT
+  // Instructions run by native code are neither profiled nor counted.
+  if (has_opt(argc, argv, "--jit") && !lineProfile && !has_opt(argc, argv, "--stats"))
+    rak_jit_enable();
+#endif
   RakArray *globals = rak_builtin_globals(&err);
   if (!rak_is_ok(&err))
   {
@@ -184,13 +265,51 @@ int main(int argc, const char *argv[])
     rak_array_free(globals);
     return EXIT_FAILURE;
   }
+  const char *profile = get_opt_value(argc, argv, "--profile=");
+  if (profile)
+  {
+    rak_profiler_start(profile, &err);
+    if (!rak_is_ok(&err))
+    {
+      rak_error_print(&err);
+      rak_fiber_deinit(&fiber);
+      return EXIT_FAILURE;
+    }
+    rak_object_retain(&cl->obj);
+  }
+  if (lineProfile)
+  {
+    rak_line_profiler_start(&err);
+    if (!rak_is_ok(&err))
+    {
+      rak_error_print(&err);
+      if (profile) stop_profiler(cl, globals);
+      rak_fiber_deinit(&fiber);
+      return EXIT_FAILURE;
+    }
+    rak_object_retain(&cl->obj);
+  }
   rak_fiber_run(&fiber, &err);
   if (!rak_is_ok(&err))
   {
     rak_fiber_print_error(&fiber, &err);
+    if (profile) stop_profiler(cl, globals);
+    if (lineProfile) stop_line_profiler(cl);
+    if (has_opt(argc, argv, "--stats"))
+      print_vm_stats();
     rak_fiber_deinit(&fiber);
+    rak_gc_collect();
+    if (has_opt(argc, argv, "--gc-stats"))
+      rak_gc_print_stats();
     return EXIT_FAILURE;
   }
+  if (profile) stop_profiler(cl, globals);
+  if (lineProfile) stop_line_profiler(cl);
+  if (has_opt(argc, argv, "--stats"))
+    print_vm_stats();
   rak_fiber_deinit(&fiber);
+  rak_gc_collect();
+  if (has_opt(argc, argv, "--gc-stats"))
+    rak_gc_print_stats();
   return EXIT_SUCCESS;
 }
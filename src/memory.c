@@ -10,22 +10,227 @@
 
 #include "rak/memory.h"
 #include <stdlib.h>
+#include <string.h>
+
+typedef union
+{
+  size_t      size;
+  max_align_t align;
+} Header;
+
+static RakMemoryStats stats = { 0 };
+
+static inline bool charge(size_t size, RakError *err);
+static inline void discharge(size_t size);
+static Header *raw_alloc(size_t size);
+static Header *raw_realloc(Header *hdr, size_t size);
+static void raw_free(Header *hdr);
+
+static inline bool charge(size_t size, RakError *err)
+{
+  if (stats.limit && stats.live + size > stats.limit)
+  {
+    rak_error_set(err, "out of memory");
+    return false;
+  }
+  stats.live += size;
+  if (stats.live > stats.peak) stats.peak = stats.live;
+  return true;
+}
+
+static inline void discharge(size_t size)
+{
+  stats.live -= size;
+}
+
+#ifdef RAK_MEMORY_SLAB
+
+#define SLAB_SIZE      ((size_t) 1 << 16)
+#define GRANULE        ((size_t) 16)
+#define MAX_SMALL_SIZE ((size_t) 256)
+#define NUM_CLASSES    ((int) (MAX_SMALL_SIZE / GRANULE))
+
+typedef union Slab
+{
+  union Slab  *next;
+  max_align_t  align;
+} Slab;
+
+typedef struct Block
+{
+  struct Block *next;
+} Block;
+
+static Slab *slabs = NULL;
+static Block *freeLists[NUM_CLASSES];
+
+static inline int size_class(size_t size);
+static Block *refill(int cls);
+
+static inline int size_class(size_t size)
+{
+  return size ? (int) ((size - 1) / GRANULE) : 0;
+}
+
+static Block *refill(int cls)
+{
+  size_t blockSize = sizeof(Header) + (size_t) (cls + 1) * GRANULE;
+  Slab *slab = malloc(SLAB_SIZE);
+  if (!slab) return NULL;
+  // Slabs are chained so they stay reachable, even when all their blocks are in use.
+  slab->next = slabs;
+  slabs = slab;
+  char *data = (char *) &slab[1];
+  size_t count = (SLAB_SIZE - sizeof(*slab)) / blockSize;
+  Block *head = NULL;
+  for (size_t i = count; i > 0; --i)
+  {
+    Block *blk = (Block *) &data[(i - 1) * blockSize];
+    blk->next = head;
+    head = blk;
+  }
+  freeLists[cls] = head;
+  return head;
+}
+
+static Header *raw_alloc(size_t size)
+{
+  Header *hdr;
+  if (size > MAX_SMALL_SIZE)
+  {
+    hdr = malloc(sizeof(*hdr) + size);
+    if (!hdr) return NULL;
+    hdr->size = size;
+    return hdr;
+  }
+  int cls = size_class(size);
+  Block *blk = freeLists[cls];
+  if (!blk)
+  {
+    blk = refill(cls);
+    if (!blk) return NULL;
+  }
+  freeLists[cls] = blk->next;
+  hdr = (Header *) blk;
+  hdr->size = size;
+  return hdr;
+}
+
+static Header *raw_realloc(Header *hdr, size_t size)
+{
+  size_t oldSize = hdr->size;
+  if (oldSize > MAX_SMALL_SIZE && size > MAX_SMALL_SIZE)
+  {
+    Header *_hdr = realloc(hdr, sizeof(*_hdr) + size);
+    if (!_hdr) return NULL;
+    _hdr->size = size;
+    return _hdr;
+  }
+  if (oldSize <= MAX_SMALL_SIZE && size <= MAX_SMALL_SIZE
+   && size_class(oldSize) == size_class(size))
+  {
+    hdr->size = size;
+    return hdr;
+  }
+  Header *_hdr = raw_alloc(size);
+  if (!_hdr) return NULL;
+  memcpy(&_hdr[1], &hdr[1], oldSize < size ? oldSize : size);
+  raw_free(hdr);
+  return _hdr;
+}
+
+static void raw_free(Header *hdr)
+{
+  size_t size = hdr->size;
+  if (size > MAX_SMALL_SIZE)
+  {
+    free(hdr);
+    return;
+  }
+  int cls = size_class(size);
+  Block *blk = (Block *) hdr;
+  blk->next = freeLists[cls];
+  freeLists[cls] = blk;
+}
+
+#else
+
+static Header *raw_alloc(size_t size)
+{
+  Header *hdr = malloc(sizeof(*hdr) + size);
+  if (!hdr) return NULL;
+  hdr->size = size;
+  return hdr;
+}
+
+static Header *raw_realloc(Header *hdr, size_t size)
+{
+  Header *_hdr = realloc(hdr, sizeof(*_hdr) + size);
+  if (!_hdr) return NULL;
+  _hdr->size = size;
+  return _hdr;
+}
+
+static void raw_free(Header *hdr)
+{
+  free(hdr);
+}
+
+#endif
 
 void *rak_memory_alloc(size_t size, RakError *err)
 {
-  void *ptr = malloc(size);
-  if (!ptr) rak_error_set(err, "out of memory");
-  return ptr;
+  if (!charge(size, err)) return NULL;
+  Header *hdr = raw_alloc(size);
+  if (!hdr)
+  {
+    discharge(size);
+    rak_error_set(err, "out of memory");
+    return NULL;
+  }
+  ++stats.allocs;
+  return &hdr[1];
 }
 
 void *rak_memory_realloc(void *ptr, size_t size, RakError *err)
 {
-  void *_ptr = realloc(ptr, size);
-  if (!_ptr) rak_error_set(err, "out of memory");
-  return _ptr;
+  if (!ptr) return rak_memory_alloc(size, err);
+  Header *hdr = &((Header *) ptr)[-1];
+  size_t oldSize = hdr->size;
+  // Only growth counts against the limit, so shrinking always succeeds.
+  size_t growth = size > oldSize ? size - oldSize : 0;
+  if (!charge(growth, err)) return NULL;
+  Header *_hdr = raw_realloc(hdr, size);
+  if (!_hdr)
+  {
+    discharge(growth);
+    rak_error_set(err, "out of memory");
+    return NULL;
+  }
+  if (size < oldSize) discharge(oldSize - size);
+  return &_hdr[1];
 }
 
 void rak_memory_free(void *ptr)
 {
-  free(ptr);
+  if (!ptr) return;
+  Header *hdr = &((Header *) ptr)[-1];
+  discharge(hdr->size);
+  ++stats.frees;
+  raw_free(hdr);
+}
+
+void rak_memory_set_limit(size_t limit)
+{
+  stats.limit = limit;
+}
+
+void rak_memory_track_object(RakType type, int delta)
+{
+  stats.objects[type] += delta;
+}
+
+RakMemoryStats rak_memory_stats(void)
+{
+  return stats;
 }
@@ -0,0 +1,484 @@
+//
+// number.c
+//
+// Copyright 2025 Fábio de Souza Villaça Medeiros
+//
+// This file is part of the Rak Project.
+// For detailed license information, please refer to the LICENSE file
+// located in the root directory of this project.
+//
+
+#include "rak/number.h"
+#include <errno.h>
+#include <math.h>
+#include <stdio.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define HIDDEN_BIT         ((uint64_t) 1 << 52)
+#define FRACTION_MASK      (HIDDEN_BIT - 1)
+#define EXPONENT_MASK      ((uint64_t) 0x7ff << 52)
+#define EXPONENT_BIAS      (1075)
+#define MAX_EXACT_INTEGER  ((uint64_t) 1 << 53)
+#define MAX_EXACT_POW10    (22)
+#define MAX_FAST_DIGITS    (19)
+#define MAX_DIGITS         (17)
+#define MAX_FIXED_EXPONENT (16)
+#define MIN_FIXED_EXPONENT (-4)
+#define PARSE_BUFFER_SIZE  (64)
+
+typedef struct
+{
+  uint64_t f;
+  int      e;
+} DiyFp;
+
+// Normalized powers of ten from 10^-348 to 10^340, in steps of 8.
+static const DiyFp cachedPowers[] = {
+  { UINT64_C(0xfa8fd5a0081c0288), -1220 },
+  { UINT64_C(0xbaaee17fa23ebf76), -1193 },
+  { UINT64_C(0x8b16fb203055ac76), -1166 },
+  { UINT64_C(0xcf42894a5dce35ea), -1140 },
+  { UINT64_C(0x9a6bb0aa55653b2d), -1113 },
+  { UINT64_C(0xe61acf033d1a45df), -1087 },
+  { UINT64_C(0xab70fe17c79ac6ca), -1060 },
+  { UINT64_C(0xff77b1fcbebcdc4f), -1034 },
+  { UINT64_C(0xbe5691ef416bd60c), -1007 },
+  { UINT64_C(0x8dd01fad907ffc3c), -980 },
+  { UINT64_C(0xd3515c2831559a83), -954 },
+  { UINT64_C(0x9d71ac8fada6c9b5), -927 },
+  { UINT64_C(0xea9c227723ee8bcb), -901 },
+  { UINT64_C(0xaecc49914078536d), -874 },
+  { UINT64_C(0x823c12795db6ce57), -847 },
+  { UINT64_C(0xc21094364dfb5637), -821 },
+  { UINT64_C(0x9096ea6f3848984f), -794 },
+  { UINT64_C(0xd77485cb25823ac7), -768 },
+  { UINT64_C(0xa086cfcd97bf97f4), -741 },
+  { UINT64_C(0xef340a98172aace5), -715 },
+  { UINT64_C(0xb23867fb2a35b28e), -688 },
+  { UINT64_C(0x84c8d4dfd2c63f3b), -661 },
+  { UINT64_C(0xc5dd44271ad3cdba), -635 },
+  { UINT64_C(0x936b9fcebb25c996), -608 },
+  { UINT64_C(0xdbac6c247d62a584), -582 },
+  { UINT64_C(0xa3ab66580d5fdaf6), -555 },
+  { UINT64_C(0xf3e2f893dec3f126), -529 },
+  { UINT64_C(0xb5b5ada8aaff80b8), -502 },
+  { UINT64_C(0x87625f056c7c4a8b), -475 },
+  { UINT64_C(0xc9bcff6034c13053), -449 },
+  { UINT64_C(0x964e858c91ba2655), -422 },
+  { UINT64_C(0xdff9772470297ebd), -396 },
+  { UINT64_C(0xa6dfbd9fb8e5b88f), -369 },
+  { UINT64_C(0xf8a95fcf88747d94), -343 },
+  { UINT64_C(0xb94470938fa89bcf), -316 },
+  { UINT64_C(0x8a08f0f8bf0f156b), -289 },
+  { UINT64_C(0xcdb02555653131b6), -263 },
+  { UINT64_C(0x993fe2c6d07b7fac), -236 },
+  { UINT64_C(0xe45c10c42a2b3b06), -210 },
+  { UINT64_C(0xaa242499697392d3), -183 },
+  { UINT64_C(0xfd87b5f28300ca0e), -157 },
+  { UINT64_C(0xbce5086492111aeb), -130 },
+  { UINT64_C(0x8cbccc096f5088cc), -103 },
+  { UINT64_C(0xd1b71758e219652c), -77 },
+  { UINT64_C(0x9c40000000000000), -50 },
+  { UINT64_C(0xe8d4a51000000000), -24 },
+  { UINT64_C(0xad78ebc5ac620000), 3 },
+  { UINT64_C(0x813f3978f8940984), 30 },
+  { UINT64_C(0xc097ce7bc90715b3), 56 },
+  { UINT64_C(0x8f7e32ce7bea5c70), 83 },
+  { UINT64_C(0xd5d238a4abe98068), 109 },
+  { UINT64_C(0x9f4f2726179a2245), 136 },
+  { UINT64_C(0xed63a231d4c4fb27), 162 },
+  { UINT64_C(0xb0de65388cc8ada8), 189 },
+  { UINT64_C(0x83c7088e1aab65db), 216 },
+  { UINT64_C(0xc45d1df942711d9a), 242 },
+  { UINT64_C(0x924d692ca61be758), 269 },
+  { UINT64_C(0xda01ee641a708dea), 295 },
+  { UINT64_C(0xa26da3999aef774a), 322 },
+  { UINT64_C(0xf209787bb47d6b85), 348 },
+  { UINT64_C(0xb454e4a179dd1877), 375 },
+  { UINT64_C(0x865b86925b9bc5c2), 402 },
+  { UINT64_C(0xc83553c5c8965d3d), 428 },
+  { UINT64_C(0x952ab45cfa97a0b3), 455 },
+  { UINT64_C(0xde469fbd99a05fe3), 481 },
+  { UINT64_C(0xa59bc234db398c25), 508 },
+  { UINT64_C(0xf6c69a72a3989f5c), 534 },
+  { UINT64_C(0xb7dcbf5354e9bece), 561 },
+  { UINT64_C(0x88fcf317f22241e2), 588 },
+  { UINT64_C(0xcc20ce9bd35c78a5), 614 },
+  { UINT64_C(0x98165af37b2153df), 641 },
+  { UINT64_C(0xe2a0b5dc971f303a), 667 },
+  { UINT64_C(0xa8d9d1535ce3b396), 694 },
+  { UINT64_C(0xfb9b7cd9a4a7443c), 720 },
+  { UINT64_C(0xbb764c4ca7a44410), 747 },
+  { UINT64_C(0x8bab8eefb6409c1a), 774 },
+  { UINT64_C(0xd01fef10a657842c), 800 },
+  { UINT64_C(0x9b10a4e5e9913129), 827 },
+  { UINT64_C(0xe7109bfba19c0c9d), 853 },
+  { UINT64_C(0xac2820d9623bf429), 880 },
+  { UINT64_C(0x80444b5e7aa7cf85), 907 },
+  { UINT64_C(0xbf21e44003acdd2d), 933 },
+  { UINT64_C(0x8e679c2f5e44ff8f), 960 },
+  { UINT64_C(0xd433179d9c8cb841), 986 },
+  { UINT64_C(0x9e19db92b4e31ba9), 1013 },
+  { UINT64_C(0xeb96bf6ebadf77d9), 1039 },
+  { UINT64_C(0xaf87023b9bf0ee6b), 1066 }
+};
+
+static const uint64_t pow10[] = {
+  UINT64_C(1), UINT64_C(10), UINT64_C(100), UINT64_C(1000), UINT64_C(10000),
+  UINT64_C(100000), UINT64_C(1000000), UINT64_C(10000000), UINT64_C(100000000),
+  UINT64_C(1000000000), UINT64_C(10000000000), UINT64_C(100000000000),
+  UINT64_C(1000000000000), UINT64_C(10000000000000), UINT64_C(100000000000000),
+  UINT64_C(1000000000000000), UINT64_C(10000000000000000), UINT64_C(100000000000000000),
+  UINT64_C(1000000000000000000), UINT64_C(10000000000000000000)
+};
+
+static const double exactPow10[] = {
+  1e0, 1e1, 1e2, 1e3, 1e4, 1e5, 1e6, 1e7, 1e8, 1e9, 1e10, 1e11,
+  1e12, 1e13, 1e14, 1e15, 1e16, 1e17, 1e18, 1e19, 1e20, 1e21, 1e22
+};
+
+static inline DiyFp diy_fp(double num);
+static inline DiyFp multiply(DiyFp x, DiyFp y);
+static inline DiyFp normalize(DiyFp x);
+static inline void boundaries(DiyFp v, DiyFp *minus, DiyFp *plus);
+static inline DiyFp cached_power(int e, int *k);
+static inline int count_digits(uint32_t n);
+static inline bool round_weed(char *buf, int len, uint64_t dist, uint64_t unsafe,
+  uint64_t rest, uint64_t tenKappa, uint64_t unit);
+static inline bool generate_digits(DiyFp low, DiyFp w, DiyFp high, char *buf, int *len, int *k);
+static inline bool grisu3(double num, char *buf, int *len, int *k);
+static inline int shortest_fallback(double num, char *buf, int *k);
+static inline int format_integer(uint64_t n, char *buf);
+static inline int format_exponent(int exp, char *buf);
+static inline int prettify(char *buf, int len, int k);
+static inline bool is_digit(char c);
+static inline bool parse_fast(int len, const char *chars, double *num);
+static inline bool parse_slow(int len, const char *chars, double *num);
+
+static inline DiyFp diy_fp(double num)
+{
+  union { double f64; uint64_t bits; } u = { .f64 = num };
+  int exp = (int) ((u.bits & EXPONENT_MASK) >> 52);
+  uint64_t frac = u.bits & FRACTION_MASK;
+  if (!exp) return (DiyFp) { frac, 1 - EXPONENT_BIAS };
+  return (DiyFp) { frac + HIDDEN_BIT, exp - EXPONENT_BIAS };
+}
+
+static inline DiyFp multiply(DiyFp x, DiyFp y)
+{
+  const uint64_t mask = UINT64_C(0xffffffff);
+  uint64_t a = x.f >> 32;
+  uint64_t b = x.f & mask;
+  uint64_t c = y.f >> 32;
+  uint64_t d = y.f & mask;
+  uint64_t ac = a * c;
+  uint64_t bc = b * c;
+  uint64_t ad = a * d;
+  uint64_t bd = b * d;
+  uint64_t tmp = (bd >> 32) + (ad & mask) + (bc & mask);
+  tmp += UINT64_C(1) << 31;
+  return (DiyFp) { ac + (ad >> 32) + (bc >> 32) + (tmp >> 32), x.e + y.e + 64 };
+}
+
+static inline DiyFp normalize(DiyFp x)
+{
+  while (!(x.f & (UINT64_C(1) << 63)))
+  {
+    x.f <<= 1;
+    --x.e;
+  }
+  return x;
+}
+
+static inline void boundaries(DiyFp v, DiyFp *minus, DiyFp *plus)
+{
+  // The boundaries are halfway to the neighbouring doubles, and the lower one is closer
+  // when the significand is a power of two.
+  DiyFp _plus = normalize((DiyFp) { (v.f << 1) + 1, v.e - 1 });
+  DiyFp _minus = v.f == HIDDEN_BIT
+    ? (DiyFp) { (v.f << 2) - 1, v.e - 2 }
+    : (DiyFp) { (v.f << 1) - 1, v.e - 1 };
+  _minus.f <<= _minus.e - _plus.e;
+  _minus.e = _plus.e;
+  *minus = _minus;
+  *plus = _plus;
+}
+
+static inline DiyFp cached_power(int e, int *k)
+{
+  // Picks the power that brings the product's exponent into [-60, -32].
+  double dk = (-61 - e) * 0.30102999566398114 + 347;
+  int _k = (int) dk;
+  if (dk - _k > 0.0) ++_k;
+  int idx = (_k >> 3) + 1;
+  *k = -(-348 + (idx << 3));
+  return cachedPowers[idx];
+}
+
+static inline int count_digits(uint32_t n)
+{
+  int len = 1;
+  while (len < 10 && n >= pow10[len])
+    ++len;
+  return len;
+}
+
+static inline bool round_weed(char *buf, int len, uint64_t dist, uint64_t unsafe,
+  uint64_t rest, uint64_t tenKappa, uint64_t unit)
+{
+  // Moves the last digit towards the value while that brings the output closer, then
+  // checks that the result is unambiguous despite the error of up to one unit in the
+  // scaled boundaries.
+  uint64_t smallDist = dist - unit;
+  uint64_t bigDist = dist + unit;
+  while (rest < smallDist && unsafe - rest >= tenKappa
+   && (rest + tenKappa < smallDist || smallDist - rest >= rest + tenKappa - smallDist))
+  {
+    --buf[len - 1];
+    rest += tenKappa;
+  }
+  if (rest < bigDist && unsafe - rest >= tenKappa
+   && (rest + tenKappa < bigDist || bigDist - rest > rest + tenKappa - bigDist))
+    return false;
+  return 2 * unit <= rest && rest <= unsafe - 4 * unit;
+}
+
+static inline bool generate_digits(DiyFp low, DiyFp w, DiyFp high, char *buf, int *len, int *k)
+{
+  // Digits are generated from the top of the interval widened by one unit, and are only
+  // trusted when they turn out to be within the narrowed one.
+  uint64_t unit = 1;
+  DiyFp tooLow = { low.f - unit, low.e };
+  DiyFp tooHigh = { high.f + unit, high.e };
+  uint64_t unsafe = tooHigh.f - tooLow.f;
+  DiyFp one = { UINT64_C(1) << -w.e, w.e };
+  uint32_t p1 = (uint32_t) (tooHigh.f >> -one.e);
+  uint64_t p2 = tooHigh.f & (one.f - 1);
+  int kappa = count_digits(p1);
+  int _len = 0;
+  while (kappa > 0)
+  {
+    uint32_t div = (uint32_t) pow10[kappa - 1];
+    buf[_len++] = (char) ('0' + p1 / div);
+    p1 %= div;
+    --kappa;
+    uint64_t rest = ((uint64_t) p1 << -one.e) + p2;
+    if (rest < unsafe)
+    {
+      *len = _len;
+      *k += kappa;
+      return round_weed(buf, _len, tooHigh.f - w.f, unsafe, rest,
+        (uint64_t) div << -one.e, unit);
+    }
+  }
+  for (;;)
+  {
+    p2 *= 10;
+    unit *= 10;
+    unsafe *= 10;
+    buf[_len++] = (char) ('0' + (p2 >> -one.e));
+    p2 &= one.f - 1;
+    --kappa;
+    if (p2 < unsafe)
+    {
+      *len = _len;
+      *k += kappa;
+      return round_weed(buf, _len, (tooHigh.f - w.f) * unit, unsafe, p2, one.f, unit);
+    }
+  }
+}
+
+static inline bool grisu3(double num, char *buf, int *len, int *k)
+{
+  DiyFp v = diy_fp(num);
+  DiyFp minus;
+  DiyFp plus;
+  boundaries(v, &minus, &plus);
+  DiyFp c = cached_power(plus.e, k);
+  DiyFp w = multiply(normalize(v), c);
+  DiyFp wp = multiply(plus, c);
+  DiyFp wm = multiply(minus, c);
+  return generate_digits(wm, w, wp, buf, len, k);
+}
+
+static inline int shortest_fallback(double num, char *buf, int *k)
+{
+  // For the few numbers Grisu3 cannot decide, such as those with a shorter neighbour
+  // exactly on a boundary, the precision is raised until the C library round-trips.
+  char tmp[RAK_NUMBER_MAX_CHARS];
+  for (int prec = 0; prec < MAX_DIGITS; ++prec)
+  {
+    snprintf(tmp, sizeof(tmp), "%.*e", prec, num);
+    if (strtod(tmp, NULL) == num) break;
+  }
+  int len = 0;
+  const char *chars = tmp;
+  for (; *chars != 'e'; ++chars)
+    if (is_digit(*chars)) buf[len++] = *chars;
+  while (len > 1 && buf[len - 1] == '0')
+    --len;
+  *k = atoi(chars + 1) - len + 1;
+  return len;
+}
+
+static inline int format_integer(uint64_t n, char *buf)
+{
+  char tmp[20];
+  int len = 0;
+  do
+  {
+    tmp[len++] = (char) ('0' + n % 10);
+    n /= 10;
+  }
+  while (n);
+  for (int i = 0; i < len; ++i)
+    buf[i] = tmp[len - 1 - i];
+  return len;
+}
+
+static inline int format_exponent(int exp, char *buf)
+{
+  int len = 0;
+  buf[len++] = 'e';
+  buf[len++] = exp < 0 ? '-' : '+';
+  if (exp < 0) exp = -exp;
+  if (exp < 10) buf[len++] = '0';
+  return len + format_integer((uint64_t) exp, &buf[len]);
+}
+
+static inline int prettify(char *buf, int len, int k)
+{
+  // Laid out like %.17g, but with the shortest digits: positional notation for decimal
+  // exponents from -4 up to 16, and scientific notation outside of that.
+  int exp = len + k - 1;
+  if (exp < MIN_FIXED_EXPONENT || exp > MAX_FIXED_EXPONENT)
+  {
+    if (len == 1) return 1 + format_exponent(exp, &buf[1]);
+    memmove(&buf[2], &buf[1], len - 1);
+    buf[1] = '.';
+    return len + 1 + format_exponent(exp, &buf[len + 1]);
+  }
+  int n = exp + 1;
+  if (n >= len)
+  {
+    memset(&buf[len], '0', n - len);
+    return n;
+  }
+  if (n > 0)
+  {
+    memmove(&buf[n + 1], &buf[n], len - n);
+    buf[n] = '.';
+    return len + 1;
+  }
+  int off = 2 - n;
+  memmove(&buf[off], buf, len);
+  buf[0] = '0';
+  buf[1] = '.';
+  memset(&buf[2], '0', -n);
+  return len + off;
+}
+
+static inline bool is_digit(char c)
+{
+  return (unsigned) (c - '0') < 10;
+}
+
+static inline bool parse_fast(int len, const char *chars, double *num)
+{
+  // Clinger's fast path: a significand and a power of ten that are both exact doubles
+  // give a correctly rounded result with a single multiplication or division.
+  uint64_t mant = 0;
+  int ndigits = 0;
+  int exp = 0;
+  int i = 0;
+  for (; i < len && is_digit(chars[i]); ++i)
+  {
+    mant = mant * 10 + (uint64_t) (chars[i] - '0');
+    if (mant && ++ndigits > MAX_FAST_DIGITS) return false;
+  }
+  if (i < len && chars[i] == '.')
+  {
+    for (++i; i < len && is_digit(chars[i]); ++i)
+    {
+      mant = mant * 10 + (uint64_t) (chars[i] - '0');
+      if (mant && ++ndigits > MAX_FAST_DIGITS) return false;
+      --exp;
+    }
+  }
+  if (i < len && (chars[i] == 'e' || chars[i] == 'E'))
+  {
+    ++i;
+    bool neg = i < len && chars[i] == '-';
+    if (i < len && (chars[i] == '-' || chars[i] == '+')) ++i;
+    int _exp = 0;
+    int start = i;
+    for (; i < len && is_digit(chars[i]); ++i)
+    {
+      if (i - start > 3) return false;
+      _exp = _exp * 10 + (chars[i] - '0');
+    }
+    if (i == start) return false;
+    exp += neg ? -_exp : _exp;
+  }
+  if (i != len || !len || mant > MAX_EXACT_INTEGER) return false;
+  if (exp < -MAX_EXACT_POW10 || exp > MAX_EXACT_POW10) return false;
+  double _num = (double) mant;
+  *num = exp < 0 ? _num / exactPow10[-exp] : _num * exactPow10[exp];
+  return true;
+}
+
+static inline bool parse_slow(int len, const char *chars, double *num)
+{
+  char buf[PARSE_BUFFER_SIZE];
+  const char *cstr = chars;
+  if (len < PARSE_BUFFER_SIZE)
+  {
+    memcpy(buf, chars, len);
+    buf[len] = '\0';
+    cstr = buf;
+  }
+  errno = 0;
+  *num = strtod(cstr, NULL);
+  return !errno;
+}
+
+int rak_number_format(double num, char *buf)
+{
+  if (num != num)
+  {
+    memcpy(buf, "nan", 4);
+    return 3;
+  }
+  int len = 0;
+  if (signbit(num))
+  {
+    buf[len++] = '-';
+    num = -num;
+  }
+  if (num == (double) INFINITY)
+  {
+    memcpy(&buf[len], "inf", 4);
+    return len + 3;
+  }
+  if (num < (double) MAX_EXACT_INTEGER && num == (double) (uint64_t) num)
+  {
+    len += format_integer((uint64_t) num, &buf[len]);
+    buf[len] = '\0';
+    return len;
+  }
+  int _len;
+  int k;
+  if (!grisu3(num, &buf[len], &_len, &k))
+    _len = shortest_fallback(num, &buf[len], &k);
+  len += prettify(&buf[len], _len, k);
+  buf[len] = '\0';
+  return len;
+}
+
+bool rak_number_parse(int len, const char *chars, double *num)
+{
+  if (parse_fast(len, chars, num)) return true;
+  return parse_slow(len, chars, num);
+}
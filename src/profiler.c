@@ -0,0 +1,698 @@
+//
+// profiler.c
+//
+// Copyright 2025 Fábio de Souza Villaça Medeiros
+//
+// This file is part of the Rak Project.
+// For detailed license information, please refer to the LICENSE file
+// located in the root directory of this project.
+//
+
+#include "rak/profiler.h"
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include "rak/function.h"
+#include "rak/vm.h"
+
+#if (defined(__GNUC__) || defined(__clang__)) && (defined(__x86_64__) || defined(__i386__))
+  #include <x86intrin.h>
+  #define RAK_PROFILER_RDTSC
+#elif defined(_MSC_VER) && (defined(_M_X64) || defined(_M_IX86))
+  #include <intrin.h>
+  #define RAK_PROFILER_RDTSC
+#endif
+
+#ifdef RAK_PROFILER_RDTSC
+  #define TICKS_UNIT "cycles"
+#else
+  #define TICKS_UNIT "ns"
+#endif
+
+#ifndef _WIN32
+
+#include <signal.h>
+#include <sys/time.h>
+
+typedef struct
+{
+  RakCallable *callable;
+  void        *state;
+  bool         native;
+  int          ln;
+} Frame;
+
+typedef struct
+{
+  uint64_t  hash;
+  int       off;
+  int       depth;
+  long      count;
+} Stack;
+
+typedef struct
+{
+  FILE           *fp;
+  Stack          *stacks;
+  Frame          *frames;
+  int             nframes;
+  volatile long   dropped;
+} Profiler;
+
+typedef RakSlice(RakCallable *) Callables;
+
+static Profiler profiler;
+
+static void sample(int sig);
+static uint64_t hash_frames(int depth, Frame *frames);
+static bool same_frames(int depth, Frame *frames1, Frame *frames2);
+static void record(int depth, Frame *frames);
+static void collect(Callables *callables, RakFunction *fn, RakError *err);
+static int compare_callables(const void *a, const void *b);
+static bool is_known(Callables *callables, RakCallable *callable);
+static void resolve(Callables *callables);
+static int resolve_line(Frame frame, bool leaf);
+static int compare_stacks(const void *a, const void *b);
+static void write_frame(FILE *fp, Frame frame);
+static void write_stacks(void);
+static void release(void);
+
+static void sample(int sig)
+{
+  (void) sig;
+  RakFiber *fiber = rak_fiber_current();
+  if (!fiber) return;
+  // The call stack may be swapped for a larger one while this runs, in which case top
+  // is null, so the fields are read through volatile to get the values of that moment.
+  RakCallFrame *top = *(RakCallFrame * volatile *) &fiber->cstk.top;
+  if (!top) return;
+  RakCallFrame *base = *(RakCallFrame * volatile *) &fiber->cstk.base;
+  RakCallFrame *limit = *(RakCallFrame * volatile *) &fiber->cstk.limit;
+  if (top < base || top > limit) return;
+  Frame frames[RAK_PROFILER_MAX_DEPTH];
+  int depth = (int) (top - base) + 1;
+  if (depth > RAK_PROFILER_MAX_DEPTH)
+  {
+    base = &top[1 - RAK_PROFILER_MAX_DEPTH];
+    depth = RAK_PROFILER_MAX_DEPTH;
+  }
+  int n = 0;
+  for (int i = 0; i < depth; ++i)
+  {
+    RakClosure *cl = base[i].cl;
+    if (!cl) continue;
+    frames[n++] = (Frame) {
+      .callable = cl->callable,
+      .state = base[i].state,
+      .native = cl->type == RAK_CALLABLE_TYPE_NATIVE_FUNCTION
+    };
+  }
+  if (!n) return;
+  record(n, frames);
+}
+
+static uint64_t hash_frames(int depth, Frame *frames)
+{
+  uint64_t hash = 14695981039346656037ULL;
+  for (int i = 0; i < depth; ++i)
+  {
+    hash ^= (uint64_t) (uintptr_t) frames[i].callable;
+    hash *= 1099511628211ULL;
+    hash ^= (uint64_t) (uintptr_t) frames[i].state;
+    hash *= 1099511628211ULL;
+  }
+  return hash;
+}
+
+static bool same_frames(int depth, Frame *frames1, Frame *frames2)
+{
+  for (int i = 0; i < depth; ++i)
+    if (frames1[i].callable != frames2[i].callable
+     || frames1[i].state != frames2[i].state)
+      return false;
+  return true;
+}
+
+static void record(int depth, Frame *frames)
+{
+  uint64_t hash = hash_frames(depth, frames);
+  int mask = RAK_PROFILER_MAX_STACKS - 1;
+  int idx = (int) (hash & (uint64_t) mask);
+  for (int i = 0; i < RAK_PROFILER_MAX_STACKS; ++i)
+  {
+    Stack *stack = &profiler.stacks[idx];
+    if (!stack->count)
+    {
+      if (profiler.nframes + depth > RAK_PROFILER_MAX_FRAMES) break;
+      for (int j = 0; j < depth; ++j)
+        profiler.frames[profiler.nframes + j] = frames[j];
+      stack->hash = hash;
+      stack->off = profiler.nframes;
+      stack->depth = depth;
+      stack->count = 1;
+      profiler.nframes += depth;
+      return;
+    }
+    if (stack->hash == hash && stack->depth == depth
+     && same_frames(depth, &profiler.frames[stack->off], frames))
+    {
+      ++stack->count;
+      return;
+    }
+    idx = (idx + 1) & mask;
+  }
+  ++profiler.dropped;
+}
+
+static void collect(Callables *callables, RakFunction *fn, RakError *err)
+{
+  rak_slice_ensure_append(callables, &fn->callable, err);
+  if (!rak_is_ok(err)) return;
+  int len = fn->nested.len;
+  for (int i = 0; i < len; ++i)
+  {
+    collect(callables, rak_slice_get(&fn->nested, i), err);
+    if (!rak_is_ok(err)) return;
+  }
+}
+
+static int compare_callables(const void *a, const void *b)
+{
+  uintptr_t x = (uintptr_t) *(RakCallable * const *) a;
+  uintptr_t y = (uintptr_t) *(RakCallable * const *) b;
+  return (x > y) - (x < y);
+}
+
+static bool is_known(Callables *callables, RakCallable *callable)
+{
+  return bsearch(&callable, callables->data, callables->len, sizeof(callable),
+    compare_callables) != NULL;
+}
+
+static void resolve(Callables *callables)
+{
+  for (int i = 0; i < RAK_PROFILER_MAX_STACKS; ++i)
+  {
+    Stack *stack = &profiler.stacks[i];
+    if (!stack->count) continue;
+    Frame *frames = &profiler.frames[stack->off];
+    int depth = 0;
+    for (int j = 0; j < stack->depth; ++j)
+    {
+      Frame frame = frames[j];
+      if (!is_known(callables, frame.callable)) continue;
+      frame.ln = frame.native ? 0 : resolve_line(frame, j == stack->depth - 1);
+      frames[depth++] = frame;
+    }
+    stack->depth = depth;
+  }
+}
+
+static int resolve_line(Frame frame, bool leaf)
+{
+  RakChunk *chunk = &((RakFunction *) frame.callable)->chunk;
+  uint32_t *ip = (uint32_t *) frame.state;
+  if (ip < chunk->instrs.data || ip > &chunk->instrs.data[chunk->instrs.len])
+    return -1;
+  // Callers have already advanced past their CALL instruction.
+  int off = (int) (ip - chunk->instrs.data) - (leaf ? 0 : 1);
+  return rak_chunk_get_line(chunk, (uint16_t) (off < 0 ? 0 : off));
+}
+
+static int compare_stacks(const void *a, const void *b)
+{
+  const Stack *x = a;
+  const Stack *y = b;
+  int depth = x->depth < y->depth ? x->depth : y->depth;
+  for (int i = 0; i < depth; ++i)
+  {
+    Frame f = profiler.frames[x->off + i];
+    Frame g = profiler.frames[y->off + i];
+    if (f.callable != g.callable)
+      return (uintptr_t) f.callable < (uintptr_t) g.callable ? -1 : 1;
+    if (f.ln != g.ln)
+      return f.ln < g.ln ? -1 : 1;
+  }
+  return (x->depth > y->depth) - (x->depth < y->depth);
+}
+
+static void write_frame(FILE *fp, Frame frame)
+{
+  RakString *name = frame.callable->name;
+  if (frame.native)
+  {
+    fprintf(fp, "%.*s(<native>)", rak_string_len(name), rak_string_chars(name));
+    return;
+  }
+  RakString *file = ((RakFunction *) frame.callable)->file;
+  fprintf(fp, "%.*s(%.*s:%d)", rak_string_len(name), rak_string_chars(name),
+    rak_string_len(file), rak_string_chars(file), frame.ln);
+}
+
+static void write_stacks(void)
+{
+  // The hash table is no longer needed, so compact it and merge the stacks
+  // that resolved to the same lines.
+  int len = 0;
+  for (int i = 0; i < RAK_PROFILER_MAX_STACKS; ++i)
+  {
+    Stack stack = profiler.stacks[i];
+    if (!stack.count || !stack.depth) continue;
+    profiler.stacks[len++] = stack;
+  }
+  qsort(profiler.stacks, len, sizeof(*profiler.stacks), compare_stacks);
+  for (int i = 0; i < len; ++i)
+  {
+    Stack stack = profiler.stacks[i];
+    while (i + 1 < len && !compare_stacks(&stack, &profiler.stacks[i + 1]))
+      stack.count += profiler.stacks[++i].count;
+    Frame *frames = &profiler.frames[stack.off];
+    for (int j = 0; j < stack.depth; ++j)
+    {
+      if (j) fputc(';', profiler.fp);
+      write_frame(profiler.fp, frames[j]);
+    }
+    fprintf(profiler.fp, " %ld\n", stack.count);
+  }
+}
+
+static void release(void)
+{
+  fclose(profiler.fp);
+  rak_memory_free(profiler.stacks);
+  rak_memory_free(profiler.frames);
+  memset(&profiler, 0, sizeof(profiler));
+}
+
+void rak_profiler_start(const char *path, RakError *err)
+{
+  FILE *fp = fopen(path, "w");
+  if (!fp)
+  {
+    rak_error_set(err, "cannot open file %s", path);
+    return;
+  }
+  size_t size = sizeof(*profiler.stacks) * RAK_PROFILER_MAX_STACKS;
+  Stack *stacks = rak_memory_alloc(size, err);
+  if (!rak_is_ok(err))
+  {
+    fclose(fp);
+    return;
+  }
+  memset(stacks, 0, size);
+  Frame *frames = rak_memory_alloc(sizeof(*frames) * RAK_PROFILER_MAX_FRAMES, err);
+  if (!rak_is_ok(err))
+  {
+    fclose(fp);
+    rak_memory_free(stacks);
+    return;
+  }
+  profiler.fp = fp;
+  profiler.stacks = stacks;
+  profiler.frames = frames;
+  profiler.nframes = 0;
+  profiler.dropped = 0;
+  struct sigaction sa;
+  memset(&sa, 0, sizeof(sa));
+  sa.sa_handler = sample;
+  sa.sa_flags = SA_RESTART;
+  sigemptyset(&sa.sa_mask);
+  struct itimerval timer = {
+    .it_interval = { .tv_sec = 0, .tv_usec = RAK_PROFILER_INTERVAL },
+    .it_value = { .tv_sec = 0, .tv_usec = RAK_PROFILER_INTERVAL }
+  };
+  if (sigaction(SIGPROF, &sa, NULL) || setitimer(ITIMER_PROF, &timer, NULL))
+  {
+    rak_error_set(err, "cannot start profiler");
+    release();
+  }
+}
+
+void rak_profiler_stop(RakClosure *cl, RakArray *globals, RakError *err)
+{
+  struct itimerval timer;
+  memset(&timer, 0, sizeof(timer));
+  setitimer(ITIMER_PROF, &timer, NULL);
+  signal(SIGPROF, SIG_IGN);
+  Callables callables;
+  rak_slice_init(&callables, err);
+  if (!rak_is_ok(err))
+  {
+    release();
+    return;
+  }
+  if (cl->type == RAK_CALLABLE_TYPE_FUNCTION)
+    collect(&callables, (RakFunction *) cl->callable, err);
+  int len = rak_array_len(globals);
+  for (int i = 0; rak_is_ok(err) && i < len; ++i)
+  {
+    RakValue val = rak_array_get(globals, i);
+    if (!rak_is_closure(val)) continue;
+    rak_slice_ensure_append(&callables, rak_as_closure(val)->callable, err);
+  }
+  if (!rak_is_ok(err))
+  {
+    rak_slice_deinit(&callables);
+    release();
+    return;
+  }
+  qsort(callables.data, callables.len, sizeof(*callables.data), compare_callables);
+  resolve(&callables);
+  write_stacks();
+  if (profiler.dropped)
+    fprintf(stderr, "profiler: %ld sample(s) dropped\n", profiler.dropped);
+  rak_slice_deinit(&callables);
+  release();
+}
+
+#else
+
+void rak_profiler_start(const char *path, RakError *err)
+{
+  (void) path;
+  rak_error_set(err, "profiling is not supported on this platform");
+}
+
+void rak_profiler_stop(RakClosure *cl, RakArray *globals, RakError *err)
+{
+  (void) cl;
+  (void) globals;
+  (void) err;
+}
+
+#endif
+
+typedef struct
+{
+  RakFunction *fn;
+  uint64_t    *counts;
+  uint64_t    *ticks;
+} Counters;
+
+typedef struct
+{
+  RakString *file;
+  int        ln;
+  RakString *name;
+  uint64_t   count;
+  uint64_t   ticks;
+} Row;
+
+typedef RakSlice(Counters) CountersSlice;
+
+typedef RakSlice(Row) Rows;
+
+typedef struct
+{
+  char  *text;
+  int    nlines;
+  char **lines;
+} Source;
+
+typedef struct
+{
+  CountersSlice  counters;
+  int            last;
+  uint64_t      *pending;
+  uint64_t       time;
+} LineProfiler;
+
+static LineProfiler lineProfiler;
+
+static inline uint64_t read_ticks(void);
+static void count_instr(RakFiber *fiber, RakClosure *cl, uint32_t *ip, RakError *err);
+static int find_counters(RakFunction *fn, RakError *err);
+static void add_row(Rows *rows, Row row, RakError *err);
+static int compare_rows(const void *a, const void *b);
+static void load_source(RakString *file, Source *src);
+static void print_rows(Rows *rows, uint64_t total, bool lines);
+static void report(RakError *err);
+
+static inline uint64_t read_ticks(void)
+{
+#ifdef RAK_PROFILER_RDTSC
+  return __rdtsc();
+#else
+  struct timespec ts;
+  timespec_get(&ts, TIME_UTC);
+  return (uint64_t) ts.tv_sec * 1000000000ULL + (uint64_t) ts.tv_nsec;
+#endif
+}
+
+static void count_instr(RakFiber *fiber, RakClosure *cl, uint32_t *ip, RakError *err)
+{
+  (void) fiber;
+  uint64_t now = read_ticks();
+  // The time since the previous hook is what the previous instruction took.
+  if (lineProfiler.pending)
+    *lineProfiler.pending += now - lineProfiler.time;
+  RakFunction *fn = (RakFunction *) cl->callable;
+  int idx = lineProfiler.last;
+  if (idx == -1 || rak_slice_get(&lineProfiler.counters, idx).fn != fn)
+  {
+    idx = find_counters(fn, err);
+    if (!rak_is_ok(err)) return;
+    lineProfiler.last = idx;
+  }
+  Counters counters = rak_slice_get(&lineProfiler.counters, idx);
+  int off = (int) (ip - fn->chunk.instrs.data);
+  ++counters.counts[off];
+  lineProfiler.pending = &counters.ticks[off];
+  lineProfiler.time = read_ticks();
+}
+
+static int find_counters(RakFunction *fn, RakError *err)
+{
+  int len = lineProfiler.counters.len;
+  for (int i = 0; i < len; ++i)
+    if (rak_slice_get(&lineProfiler.counters, i).fn == fn)
+      return i;
+  size_t size = sizeof(uint64_t) * fn->chunk.instrs.len;
+  uint64_t *counts = rak_memory_alloc(size, err);
+  if (!rak_is_ok(err)) return -1;
+  uint64_t *ticks = rak_memory_alloc(size, err);
+  if (!rak_is_ok(err))
+  {
+    rak_memory_free(counts);
+    return -1;
+  }
+  memset(counts, 0, size);
+  memset(ticks, 0, size);
+  Counters counters = {
+    .fn = fn,
+    .counts = counts,
+    .ticks = ticks
+  };
+  rak_slice_ensure_append(&lineProfiler.counters, counters, err);
+  if (rak_is_ok(err)) return len;
+  rak_memory_free(counts);
+  rak_memory_free(ticks);
+  return -1;
+}
+
+static void add_row(Rows *rows, Row row, RakError *err)
+{
+  int len = rows->len;
+  for (int i = 0; i < len; ++i)
+  {
+    Row *other = &rows->data[i];
+    if (other->ln != row.ln || other->name != row.name
+     || !rak_string_equals(other->file, row.file))
+      continue;
+    other->count += row.count;
+    other->ticks += row.ticks;
+    return;
+  }
+  rak_slice_ensure_append(rows, row, err);
+}
+
+static int compare_rows(const void *a, const void *b)
+{
+  const Row *x = a;
+  const Row *y = b;
+  if (x->ticks != y->ticks)
+    return x->ticks > y->ticks ? -1 : 1;
+  if (x->count != y->count)
+    return x->count > y->count ? -1 : 1;
+  return x->ln - y->ln;
+}
+
+static void load_source(RakString *file, Source *src)
+{
+  memset(src, 0, sizeof(*src));
+  char path[FILENAME_MAX];
+  int len = rak_string_len(file);
+  if (len >= (int) sizeof(path)) return;
+  memcpy(path, rak_string_chars(file), len);
+  path[len] = '\0';
+  FILE *fp = fopen(path, "rb");
+  if (!fp) return;
+  fseek(fp, 0, SEEK_END);
+  long size = ftell(fp);
+  fseek(fp, 0, SEEK_SET);
+  RakError err;
+  rak_error_init(&err);
+  char *text = size < 0 ? NULL : rak_memory_alloc((size_t) size + 1, &err);
+  if (!text || fread(text, 1, (size_t) size, fp) != (size_t) size)
+  {
+    if (text) rak_memory_free(text);
+    fclose(fp);
+    return;
+  }
+  fclose(fp);
+  text[size] = '\0';
+  int nlines = 1;
+  for (long i = 0; i < size; ++i)
+    if (text[i] == '\n') ++nlines;
+  char **lines = rak_memory_alloc(sizeof(*lines) * nlines, &err);
+  if (!rak_is_ok(&err))
+  {
+    rak_memory_free(text);
+    return;
+  }
+  char *line = text;
+  for (int i = 0; i < nlines; ++i)
+  {
+    lines[i] = line;
+    char *end = strchr(line, '\n');
+    if (!end) break;
+    *end = '\0';
+    if (end > line && end[-1] == '\r') end[-1] = '\0';
+    line = &end[1];
+  }
+  src->text = text;
+  src->nlines = nlines;
+  src->lines = lines;
+}
+
+static void print_rows(Rows *rows, uint64_t total, bool lines)
+{
+  Source src = {0};
+  RakString *file = NULL;
+  fprintf(stderr, "%12s %16s %7s  %s\n", "count", TICKS_UNIT, "%",
+    lines ? "line" : "function");
+  int len = rows->len;
+  for (int i = 0; i < len; ++i)
+  {
+    Row row = rak_slice_get(rows, i);
+    double pct = total ? 100.0 * (double) row.ticks / (double) total : 0.0;
+    fprintf(stderr, "%12llu %16llu %6.2f%%  ", (unsigned long long) row.count,
+      (unsigned long long) row.ticks, pct);
+    if (!lines)
+    {
+      fprintf(stderr, "%.*s(%.*s:%d)\n", rak_string_len(row.name),
+        rak_string_chars(row.name), rak_string_len(row.file),
+        rak_string_chars(row.file), row.ln);
+      continue;
+    }
+    fprintf(stderr, "%.*s:%d", rak_string_len(row.file),
+      rak_string_chars(row.file), row.ln);
+    if (!file || !rak_string_equals(file, row.file))
+    {
+      if (src.text)
+      {
+        rak_memory_free(src.text);
+        rak_memory_free(src.lines);
+      }
+      load_source(row.file, &src);
+      file = row.file;
+    }
+    if (row.ln > 0 && row.ln <= src.nlines)
+    {
+      const char *text = src.lines[row.ln - 1];
+      while (*text == ' ' || *text == '\t') ++text;
+      fprintf(stderr, "  %s", text);
+    }
+    fprintf(stderr, "\n");
+  }
+  if (!src.text) return;
+  rak_memory_free(src.text);
+  rak_memory_free(src.lines);
+}
+
+static void report(RakError *err)
+{
+  Rows lines;
+  rak_slice_init(&lines, err);
+  if (!rak_is_ok(err)) return;
+  Rows fns;
+  rak_slice_init(&fns, err);
+  if (!rak_is_ok(err))
+  {
+    rak_slice_deinit(&lines);
+    return;
+  }
+  uint64_t total = 0;
+  int len = lineProfiler.counters.len;
+  for (int i = 0; rak_is_ok(err) && i < len; ++i)
+  {
+    Counters counters = rak_slice_get(&lineProfiler.counters, i);
+    RakFunction *fn = counters.fn;
+    RakChunk *chunk = &fn->chunk;
+    Row fnRow = {
+      .file = fn->file,
+      .ln = -1,
+      .name = fn->callable.name
+    };
+    for (int j = 0; rak_is_ok(err) && j < chunk->instrs.len; ++j)
+    {
+      if (!counters.counts[j]) continue;
+      Row row = {
+        .file = fn->file,
+        .ln = rak_chunk_get_line(chunk, (uint16_t) j),
+        .count = counters.counts[j],
+        .ticks = counters.ticks[j]
+      };
+      add_row(&lines, row, err);
+      if (fnRow.ln == -1 || (row.ln != -1 && row.ln < fnRow.ln))
+        fnRow.ln = row.ln;
+      fnRow.count += row.count;
+      fnRow.ticks += row.ticks;
+    }
+    total += fnRow.ticks;
+    if (rak_is_ok(err))
+      add_row(&fns, fnRow, err);
+  }
+  if (rak_is_ok(err))
+  {
+    qsort(lines.data, lines.len, sizeof(*lines.data), compare_rows);
+    qsort(fns.data, fns.len, sizeof(*fns.data), compare_rows);
+    fflush(stdout);
+    fprintf(stderr, "\n");
+    print_rows(&lines, total, true);
+    fprintf(stderr, "\n");
+    print_rows(&fns, total, false);
+  }
+  rak_slice_deinit(&lines);
+  rak_slice_deinit(&fns);
+}
+
+void rak_line_profiler_start(RakError *err)
+{
+  rak_slice_init(&lineProfiler.counters, err);
+  if (!rak_is_ok(err)) return;
+  lineProfiler.last = -1;
+  lineProfiler.pending = NULL;
+  if (rak_vm_set_hook(count_instr)) return;
+  rak_slice_deinit(&lineProfiler.counters);
+  rak_error_set(err, "line profiling is not supported by this build");
+}
+
+void rak_line_profiler_stop(RakError *err)
+{
+  if (lineProfiler.pending)
+    *lineProfiler.pending += read_ticks() - lineProfiler.time;
+  rak_vm_set_hook(NULL);
+  report(err);
+  int len = lineProfiler.counters.len;
+  for (int i = 0; i < len; ++i)
+  {
+    Counters counters = rak_slice_get(&lineProfiler.counters, i);
+    rak_memory_free(counters.counts);
+    rak_memory_free(counters.ticks);
+  }
+  rak_slice_deinit(&lineProfiler.counters);
+  memset(&lineProfiler, 0, sizeof(lineProfiler));
+}
@@ -11,6 +11,7 @@
 #include "rak/range.h"
 #include <inttypes.h>
 #include <stdio.h>
+#include "rak/arena.h"
 #include "rak/memory.h"
 
 void rak_range_init(RakRange *range, double start, double end)
@@ -29,23 +30,26 @@ void rak_range_init_copy(RakRange *range1, RakRange *range2)
 
 RakRange *rak_range_new(double start, double end, RakError *err)
 {
-  RakRange *range = rak_memory_alloc(sizeof(*range), err);
+  RakRange *range = rak_arena_alloc_object(sizeof(*range), err);
   if (!rak_is_ok(err)) return NULL;
   rak_range_init(range, start, end);
+  rak_memory_track_object(RAK_TYPE_RANGE, 1);
   return range;
 }
 
 RakRange *rak_range_new_copy(RakRange *range, RakError *err)
 {
-  RakRange *_range = rak_memory_alloc(sizeof(*_range), err);
+  RakRange *_range = rak_arena_alloc_object(sizeof(*_range), err);
   if (!rak_is_ok(err)) return NULL;
   rak_range_init_copy(_range, range);
+  rak_memory_track_object(RAK_TYPE_RANGE, 1);
   return _range;
 }
 
 void rak_range_free(RakRange *range)
 {
-  rak_memory_free(range);
+  rak_memory_track_object(RAK_TYPE_RANGE, -1);
+  rak_arena_free_object(range);
 }
 
 void rak_range_release(RakRange *range)
@@ -71,3 +75,19 @@ void rak_range_print(RakRange *range)
 {
   printf("%" PRId64 "..%" PRId64, (int64_t) range->start, (int64_t) range->end);
 }
+
+RakValue rak_range_value_new(double start, double end, RakError *err)
+{
+  if (start >= RAK_RANGE_IMMEDIATE_MIN && start <= RAK_RANGE_IMMEDIATE_MAX
+   && end >= RAK_RANGE_IMMEDIATE_MIN && end <= RAK_RANGE_IMMEDIATE_MAX)
+    return rak_range_immediate_value((int32_t) start, (int32_t) end);
+  RakRange *range = rak_range_new(start, end, err);
+  if (!rak_is_ok(err)) return rak_nil_value();
+  return rak_range_value(range);
+}
+
+void rak_range_value_print(RakValue val)
+{
+  printf("%" PRId64 "..%" PRId64, (int64_t) rak_range_value_start(val),
+    (int64_t) rak_range_value_end(val));
+}
@@ -10,9 +10,58 @@
 
 #include "rak/record.h"
 #include <stdio.h>
+#include "rak/arena.h"
+#include "rak/gc.h"
 
+static RakShape root = {
+  .obj = { .refCount = 1 },
+  .parent = NULL,
+  .name = NULL,
+  .len = 0,
+  .children = { .cap = 0, .len = 0, .data = NULL }
+};
+
+static inline void set_shape(RakRecord *rec, RakShape *shape);
+static inline RakShape *build_shape(RakRecord *rec, int skip, RakError *err);
+static inline void rebuild_shape(RakRecord *rec, RakError *err);
 static inline void release_fields(RakRecord *rec);
 
+static inline void set_shape(RakRecord *rec, RakShape *shape)
+{
+  rak_object_retain(&shape->obj);
+  rak_shape_release(rec->shape);
+  rec->shape = shape;
+}
+
+static inline RakShape *build_shape(RakRecord *rec, int skip, RakError *err)
+{
+  RakShape *shape = &root;
+  int len = rak_record_len(rec);
+  for (int i = 0; i < len; ++i)
+  {
+    if (i == skip) continue;
+    RakRecordField field = rak_record_get(rec, i);
+    RakShape *_shape = rak_shape_transition(shape, field.name, err);
+    if (!rak_is_ok(err))
+    {
+      // Transitions created so far are only held by each other, so releasing the last
+      // one frees those that no other record uses.
+      rak_object_retain(&shape->obj);
+      rak_shape_release(shape);
+      return NULL;
+    }
+    shape = _shape;
+  }
+  return shape;
+}
+
+static inline void rebuild_shape(RakRecord *rec, RakError *err)
+{
+  RakShape *shape = build_shape(rec, -1, err);
+  if (!rak_is_ok(err)) return;
+  set_shape(rec, shape);
+}
+
 static inline void release_fields(RakRecord *rec)
 {
   int len = rak_record_len(rec);
@@ -24,16 +73,86 @@ static inline void release_fields(RakRecord *rec)
   }
 }
 
+RakShape *rak_shape_root(void)
+{
+  return &root;
+}
+
+RakShape *rak_shape_transition(RakShape *shape, RakString *name, RakError *err)
+{
+  int len = shape->children.len;
+  for (int i = 0; i < len; ++i)
+  {
+    RakShape *child = rak_slice_get(&shape->children, i);
+    if (rak_string_equals(child->name, name)) return child;
+  }
+  if (!shape->children.cap)
+  {
+    rak_slice_init(&shape->children, err);
+    if (!rak_is_ok(err)) return NULL;
+  }
+  RakShape *child = rak_memory_alloc(sizeof(*child), err);
+  if (!rak_is_ok(err)) return NULL;
+  rak_slice_ensure_append(&shape->children, child, err);
+  if (!rak_is_ok(err))
+  {
+    rak_memory_free(child);
+    return NULL;
+  }
+  rak_object_init(&child->obj);
+  child->parent = shape;
+  child->name = name;
+  child->len = shape->len + 1;
+  child->children.cap = 0;
+  child->children.len = 0;
+  child->children.data = NULL;
+  rak_object_retain(&shape->obj);
+  rak_object_retain(&name->obj);
+  return child;
+}
+
+void rak_shape_free(RakShape *shape)
+{
+  RakShape *parent = shape->parent;
+  int len = parent->children.len;
+  for (int i = 0; i < len; ++i)
+  {
+    if (rak_slice_get(&parent->children, i) != shape) continue;
+    rak_slice_remove_at(&parent->children, i);
+    break;
+  }
+  rak_string_release(shape->name);
+  rak_shape_release(parent);
+  rak_slice_deinit(&shape->children);
+  rak_memory_free(shape);
+}
+
+void rak_shape_release(RakShape *shape)
+{
+  RakObject *obj = &shape->obj;
+  --obj->refCount;
+  if (obj->refCount) return;
+  rak_shape_free(shape);
+}
+
 void rak_record_init(RakRecord *rec, RakError *err)
 {
   rak_object_init(&rec->obj);
   rak_slice_init(&rec->slice, err);
+  if (!rak_is_ok(err)) return;
+  rec->shape = &root;
+  rak_object_retain(&root.obj);
+  rak_memory_track_object(RAK_TYPE_RECORD, 1);
 }
 
 void rak_record_init_with_capacity(RakRecord *rec, int cap, RakError *err)
 {
   rak_object_init(&rec->obj);
   rak_slice_init_with_capacity(&rec->slice, cap, err);
+  if (!rak_is_ok(err)) return;
+  rec->shape = &root;
+  rak_object_retain(&root.obj);
+  rak_memory_track_object(RAK_TYPE_RECORD, 1);
 }
 
 void rak_record_init_copy(RakRecord *rec1, RakRecord *rec2, RakError *err)
@@ -49,55 +168,64 @@ void rak_record_init_copy(RakRecord *rec1, RakRecord *rec2, RakError *err)
     rak_value_retain(field.val);
   }
   rec1->slice.len = len;
+  set_shape(rec1, rec2->shape);
 }
 
 void rak_record_deinit(RakRecord *rec)
 {
   release_fields(rec);
   rak_slice_deinit(&rec->slice);
+  rak_shape_release(rec->shape);
+  rak_memory_track_object(RAK_TYPE_RECORD, -1);
 }
 
 RakRecord *rak_record_new(RakError *err)
 {
-  RakRecord *rec = rak_memory_alloc(sizeof(*rec), err);
+  RakRecord *rec = rak_arena_alloc_object(sizeof(*rec), err);
   if (!rak_is_ok(err)) return NULL;
   rak_record_init(rec, err);
   if (rak_is_ok(err)) return rec;
-  rak_memory_free(rec);
+  rak_arena_free_object(rec);
   return NULL;
 }
 
 RakRecord *rak_record_new_with_capacity(int cap, RakError *err)
 {
-  RakRecord *rec = rak_memory_alloc(sizeof(*rec), err);
+  RakRecord *rec = rak_arena_alloc_object(sizeof(*rec), err);
   if (!rak_is_ok(err)) return NULL;
   rak_record_init_with_capacity(rec, cap, err);
   if (rak_is_ok(err)) return rec;
-  rak_memory_free(rec);
+  rak_arena_free_object(rec);
   return NULL;
 }
 
 RakRecord *rak_record_new_copy(RakRecord *rec, RakError *err)
 {
-  RakRecord *_rec = rak_memory_alloc(sizeof(*_rec), err);
+  RakRecord *_rec = rak_arena_alloc_object(sizeof(*_rec), err);
   if (!rak_is_ok(err)) return NULL;
   rak_record_init_copy(_rec, rec, err);
   if (rak_is_ok(err)) return _rec;
-  rak_memory_free(_rec);
+  rak_arena_free_object(_rec);
   return NULL;
 }
 
 void rak_record_free(RakRecord *rec)
 {
+  rak_gc_forget(&rec->obj);
   rak_record_deinit(rec);
-  rak_memory_free(rec);
+  rak_arena_free_object(rec);
 }
 
 void rak_record_release(RakRecord *rec)
 {
   RakObject *obj = &rec->obj;
   --obj->refCount;
-  if (obj->refCount) return;
+  if (obj->refCount)
+  {
+    rak_gc_possible_root(rak_record_value(rec));
+    return;
+  }
+  if (rak_gc_deferred(rak_record_value(rec))) return;
   rak_record_free(rec);
 }
 
@@ -153,6 +281,7 @@ RakRecord *rak_record_set(RakRecord *rec, int idx, RakValue val, RakError *err)
     rak_value_retain(_field.val);
   }
   _rec->slice.len = len;
+  set_shape(_rec, rec->shape);
   return _rec;
 }
 
@@ -172,12 +301,28 @@ RakRecord *rak_record_remove_at(RakRecord *rec, int idx, RakError *err)
   for (int i = idx + 1; i < len; ++i)
   {
     RakRecordField field = rak_record_get(rec, i);
-    rak_slice_set(&_rec->slice, i, field);
+    rak_slice_set(&_rec->slice, i - 1, field);
     rak_object_retain(&field.name->obj);
     rak_value_retain(field.val);
   }
   _rec->slice.len = _len;
-  return _rec;
+  rebuild_shape(_rec, err);
+  if (rak_is_ok(err)) return _rec;
+  rak_record_free(_rec);
+  return NULL;
+}
+
+void rak_record_inplace_append(RakRecord *rec, RakRecordField field, RakError *err)
+{
+  rak_slice_ensure_append(&rec->slice, field, err);
+  if (!rak_is_ok(err)) return;
+  RakShape *shape = rak_shape_transition(rec->shape, field.name, err);
+  if (rak_is_ok(err))
+  {
+    set_shape(rec, shape);
+    return;
+  }
+  --rec->slice.len;
 }
 
 void rak_record_inplace_put(RakRecord *rec, RakString *name, RakValue val, RakError *err)
@@ -192,7 +337,7 @@ void rak_record_inplace_put(RakRecord *rec, RakString *name, RakValue val, RakEr
     .name = name,
     .val = val,
   };
-  rak_slice_ensure_append(&rec->slice, field, err);
+  rak_record_inplace_append(rec, field, err);
   if (!rak_is_ok(err)) return;
   rak_object_retain(&name->obj);
   rak_value_retain(val);
@@ -206,10 +351,13 @@ void rak_record_inplace_set(RakRecord *rec, int idx, RakValue val)
   field->val = val;
 }
 
-void rak_record_inplace_remove_at(RakRecord *rec, int idx)
+void rak_record_inplace_remove_at(RakRecord *rec, int idx, RakError *err)
 {
+  RakShape *shape = build_shape(rec, idx, err);
+  if (!rak_is_ok(err)) return;
   RakRecordField field = rak_record_get(rec, idx);
   rak_slice_remove_at(&rec->slice, idx);
+  set_shape(rec, shape);
   rak_string_release(field.name);
   rak_value_release(field.val);
 }
@@ -218,6 +366,7 @@ void rak_record_inplace_clear(RakRecord *rec)
 {
   release_fields(rec);
   rak_slice_clear(&rec->slice);
+  set_shape(rec, &root);
 }
 
 bool rak_record_equals(RakRecord *rec1, RakRecord *rec2)
@@ -0,0 +1,128 @@
+//
+// search.c
+//
+// Copyright 2025 Fábio de Souza Villaça Medeiros
+//
+// This file is part of the Rak Project.
+// For detailed license information, please refer to the LICENSE file
+// located in the root directory of this project.
+//
+
+#include "rak/search.h"
+#include <string.h>
+
+#if (defined(__GNUC__) || defined(__clang__)) && defined(__SSE2__)
+  #include <immintrin.h>
+  #define RAK_SEARCH_SSE2
+  #if defined(__x86_64__) || defined(__i386__)
+    #define RAK_SEARCH_AVX2
+  #endif
+#endif
+
+typedef int (*Find)(int len, const char *chars, int nlen, const char *needle);
+
+static int find_portable(int len, const char *chars, int nlen, const char *needle);
+#ifdef RAK_SEARCH_SSE2
+static int find_sse2(int len, const char *chars, int nlen, const char *needle);
+#endif
+#ifdef RAK_SEARCH_AVX2
+static int find_avx2(int len, const char *chars, int nlen, const char *needle);
+#endif
+static Find select_kernel(void);
+
+static Find kernel = NULL;
+
+static int find_portable(int len, const char *chars, int nlen, const char *needle)
+{
+  const char *end = chars + len - nlen + 1;
+  const char *curr = chars;
+  while (curr < end)
+  {
+    curr = memchr(curr, needle[0], end - curr);
+    if (!curr) return -1;
+    if (!memcmp(curr + 1, needle + 1, nlen - 1)) return (int) (curr - chars);
+    ++curr;
+  }
+  return -1;
+}
+
+#ifdef RAK_SEARCH_SSE2
+
+static int find_sse2(int len, const char *chars, int nlen, const char *needle)
+{
+  // Positions where both the first and the last byte match are found 16 at a time, and
+  // only those are compared in full.
+  __m128i first = _mm_set1_epi8(needle[0]);
+  __m128i last = _mm_set1_epi8(needle[nlen - 1]);
+  int i = 0;
+  for (; i + nlen - 1 + 16 <= len; i += 16)
+  {
+    __m128i blk1 = _mm_loadu_si128((const __m128i *) &chars[i]);
+    __m128i blk2 = _mm_loadu_si128((const __m128i *) &chars[i + nlen - 1]);
+    __m128i eq = _mm_and_si128(_mm_cmpeq_epi8(blk1, first), _mm_cmpeq_epi8(blk2, last));
+    unsigned mask = (unsigned) _mm_movemask_epi8(eq);
+    while (mask)
+    {
+      int j = i + __builtin_ctz(mask);
+      if (!memcmp(&chars[j + 1], needle + 1, nlen - 2)) return j;
+      mask &= mask - 1;
+    }
+  }
+  int idx = find_portable(len - i, &chars[i], nlen, needle);
+  return idx < 0 ? -1 : i + idx;
+}
+
+#endif
+
+#ifdef RAK_SEARCH_AVX2
+
+__attribute__((target("avx2")))
+static int find_avx2(int len, const char *chars, int nlen, const char *needle)
+{
+  __m256i first = _mm256_set1_epi8(needle[0]);
+  __m256i last = _mm256_set1_epi8(needle[nlen - 1]);
+  int i = 0;
+  for (; i + nlen - 1 + 32 <= len; i += 32)
+  {
+    __m256i blk1 = _mm256_loadu_si256((const __m256i *) &chars[i]);
+    __m256i blk2 = _mm256_loadu_si256((const __m256i *) &chars[i + nlen - 1]);
+    __m256i eq = _mm256_and_si256(_mm256_cmpeq_epi8(blk1, first), _mm256_cmpeq_epi8(blk2, last));
+    unsigned mask = (unsigned) _mm256_movemask_epi8(eq);
+    while (mask)
+    {
+      int j = i + __builtin_ctz(mask);
+      if (!memcmp(&chars[j + 1], needle + 1, nlen - 2)) return j;
+      mask &= mask - 1;
+    }
+  }
+  int idx = find_sse2(len - i, &chars[i], nlen, needle);
+  return idx < 0 ? -1 : i + idx;
+}
+
+#endif
+
+static Find select_kernel(void)
+{
+#ifdef RAK_SEARCH_AVX2
+  __builtin_cpu_init();
+  if (__builtin_cpu_supports("avx2")) return find_avx2;
+#endif
+#ifdef RAK_SEARCH_SSE2
+  return find_sse2;
+#else
+  return find_portable;
+#endif
+}
+
+int rak_search_find(int len, const char *chars, int nlen, const char *needle)
+{
+  if (!nlen) return 0;
+  if (nlen > len) return -1;
+  if (nlen == 1)
+  {
+    const char *curr = memchr(chars, needle[0], len);
+    return curr ? (int) (curr - chars) : -1;
+  }
+  if (!kernel) kernel = select_kernel();
+  return kernel(len, chars, nlen, needle);
+}
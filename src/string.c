@@ -12,11 +12,31 @@
 #include <ctype.h>
 #include <stdio.h>
 #include <string.h>
+#include "rak/arena.h"
+#include "rak/search.h"
+
+#define TABLE_MIN_CAPACITY ((int) 1 << 8)
+
+static RakString tombstone;
+static RakString **table = NULL;
+static int tableCap = 0;
+static int tableLen = 0;
+static int tableUsed = 0;
 
 static inline int hex2bin(char c);
 static inline void handle_hex_escape(RakString *str, int len, const char *cstr, int *curr, RakError *err);
 static inline void handle_escape_sequence(RakString *str, int len, const char *cstr, int *curr, RakError *err);
 static inline void parse_escaped_string(RakString *str, int len, const char *cstr, RakError *err);
+static inline void init_inline(RakString *str);
+static inline void init_header(RakString *str);
+static inline uint32_t hash_chars(int len, const char *chars);
+static inline int find_slot(int len, const char *chars, uint32_t hash);
+static inline void grow_table(RakError *err);
+static inline void unintern(RakString *str);
+static inline void invalidate(RakString *str);
+static inline bool should_copy(RakString *parent, int len);
+static inline void materialize(RakString *str, int cap, RakError *err);
+static inline bool detach_buffer(RakString *str);
 
 static inline int hex2bin(char c)
 {
@@ -97,16 +117,150 @@ static inline void parse_escaped_string(RakString *str, int len, const char *cst
   }
 }
 
-void rak_string_init(RakString *str, RakError *err)
+static inline void init_inline(RakString *str)
+{
+  str->slice.cap = RAK_STRING_INLINE_CAPACITY;
+  str->slice.len = 0;
+  str->slice.data = str->buf;
+}
+
+static inline void init_header(RakString *str)
 {
   rak_object_init(&str->obj);
-  rak_slice_init(&str->slice, err);
+  str->hash = 0;
+  str->interned = false;
+  str->parent = NULL;
+}
+
+static inline uint32_t hash_chars(int len, const char *chars)
+{
+  uint32_t hash = 2166136261u;
+  for (int i = 0; i < len; ++i)
+  {
+    hash ^= (uint8_t) chars[i];
+    hash *= 16777619u;
+  }
+  // Zero is kept to mean that the hash was not computed yet.
+  return hash ? hash : 1;
+}
+
+static inline int find_slot(int len, const char *chars, uint32_t hash)
+{
+  int mask = tableCap - 1;
+  int idx = (int) (hash & (uint32_t) mask);
+  int slot = -1;
+  for (;;)
+  {
+    RakString *str = table[idx];
+    if (!str) return slot >= 0 ? slot : idx;
+    if (str == &tombstone)
+    {
+      if (slot < 0) slot = idx;
+    }
+    else if (str->hash == hash && rak_string_len(str) == len
+     && !memcmp(rak_string_chars(str), chars, len))
+      return idx;
+    idx = (idx + 1) & mask;
+  }
+}
+
+static inline void grow_table(RakError *err)
+{
+  // When most of the used slots are tombstones, the table is rebuilt at the same size.
+  int cap = tableCap ? tableCap : TABLE_MIN_CAPACITY;
+  if ((tableLen + 1) * 4 > cap) cap <<= 1;
+  RakString **_table = rak_memory_alloc(sizeof(*_table) * cap, err);
+  if (!rak_is_ok(err)) return;
+  memset(_table, 0, sizeof(*_table) * cap);
+  RakString **old = table;
+  int oldCap = tableCap;
+  table = _table;
+  tableCap = cap;
+  tableUsed = 0;
+  for (int i = 0; i < oldCap; ++i)
+  {
+    RakString *str = old[i];
+    if (!str || str == &tombstone) continue;
+    int idx = find_slot(rak_string_len(str), rak_string_chars(str), str->hash);
+    table[idx] = str;
+    ++tableUsed;
+  }
+  rak_memory_free(old);
+}
+
+static inline void unintern(RakString *str)
+{
+  int idx = find_slot(rak_string_len(str), rak_string_chars(str), str->hash);
+  table[idx] = &tombstone;
+  --tableLen;
+  str->interned = false;
+}
+
+static inline void invalidate(RakString *str)
+{
+  if (str->interned) unintern(str);
+  str->hash = 0;
+}
+
+static inline bool should_copy(RakString *parent, int len)
+{
+  // Short slices are cheap to copy, and a view would keep a much larger parent alive.
+  return len <= RAK_STRING_INLINE_CAPACITY
+    || len < rak_string_len(parent) / RAK_STRING_VIEW_RATIO;
+}
+
+static inline void materialize(RakString *str, int cap, RakError *err)
+{
+  RakString *parent = str->parent;
+  int len = rak_string_len(str);
+  char *chars = rak_string_chars(str);
+  if (cap <= RAK_STRING_INLINE_CAPACITY)
+    init_inline(str);
+  else
+  {
+    rak_slice_init_with_capacity(&str->slice, cap, err);
+    if (!rak_is_ok(err)) return;
+  }
+  memcpy(rak_string_chars(str), chars, len);
+  str->slice.len = len;
+  str->parent = NULL;
+  rak_string_release(parent);
+}
+
+static inline bool detach_buffer(RakString *str)
+{
+  // The buffer is handed to a new parent, so that the string can become a view into it.
+  RakError err;
+  rak_error_init(&err);
+  RakString *parent = rak_arena_alloc_object(sizeof(*parent), &err);
+  if (!rak_is_ok(&err)) return false;
+  init_header(parent);
+  parent->slice = str->slice;
+  rak_object_retain(&parent->obj);
+  rak_memory_track_object(RAK_TYPE_STRING, 1);
+  str->parent = parent;
+  return true;
+}
+
+void rak_string_init(RakString *str, RakError *err)
+{
+  (void) err;
+  init_header(str);
+  init_inline(str);
+  rak_memory_track_object(RAK_TYPE_STRING, 1);
 }
 
 void rak_string_init_with_capacity(RakString *str, int cap, RakError *err)
 {
-  rak_object_init(&str->obj);
-  rak_slice_init_with_capacity(&str->slice, cap, err);
+  init_header(str);
+  if (cap <= RAK_STRING_INLINE_CAPACITY)
+    init_inline(str);
+  else
+  {
+    rak_slice_init_with_capacity(&str->slice, cap, err);
+    if (!rak_is_ok(err)) return;
+  }
+  rak_memory_track_object(RAK_TYPE_STRING, 1);
 }
 
 void rak_string_init_from_cstr(RakString *str, int len, const char *cstr, RakError *err)
@@ -139,46 +293,54 @@ void rak_string_init_copy(RakString *str1, RakString *str2, RakError *err)
 
 void rak_string_deinit(RakString *str)
 {
+  rak_memory_track_object(RAK_TYPE_STRING, -1);
+  if (str->interned) unintern(str);
+  if (rak_string_is_view(str))
+  {
+    rak_string_release(str->parent);
+    return;
+  }
+  if (rak_string_is_inline(str)) return;
   rak_slice_deinit(&str->slice);
 }
 
 RakString *rak_string_new(RakError *err)
 {
-  RakString *str = rak_memory_alloc(sizeof(*str), err);
+  RakString *str = rak_arena_alloc_object(sizeof(*str), err);
   if (!rak_is_ok(err)) return NULL;
   rak_string_init(str, err);
   if (rak_is_ok(err)) return str;
-  rak_memory_free(str);
+  rak_arena_free_object(str);
   return NULL;
 }
 
 RakString *rak_string_new_with_capacity(int cap, RakError *err)
 {
-  RakString *str = rak_memory_alloc(sizeof(*str), err);
+  RakString *str = rak_arena_alloc_object(sizeof(*str), err);
   if (!rak_is_ok(err)) return NULL;
   rak_string_init_with_capacity(str, cap, err);
   if (rak_is_ok(err)) return str;
-  rak_memory_free(str);
+  rak_arena_free_object(str);
   return NULL;
 }
 
 RakString *rak_string_new_from_cstr(int len, const char *cstr, RakError *err)
 {
-  RakString *str = rak_memory_alloc(sizeof(*str), err);
+  RakString *str = rak_arena_alloc_object(sizeof(*str), err);
   if (!rak_is_ok(err)) return NULL;
   rak_string_init_from_cstr(str, len, cstr, err);
   if (rak_is_ok(err)) return str;
-  rak_memory_free(str);
+  rak_arena_free_object(str);
   return NULL;
 }
 
 RakString *rak_string_new_from_cstr_with_escapes(int len, const char *cstr, RakError *err)
 {
-  RakString *str = rak_memory_alloc(sizeof(*str), err);
+  RakString *str = rak_arena_alloc_object(sizeof(*str), err);
   if (!rak_is_ok(err)) return NULL;
   rak_string_init_from_cstr_with_escapes(str, len, cstr, err);
   if (rak_is_ok(err)) return str;
-  rak_memory_free(str);
+  rak_arena_free_object(str);
   return NULL;
 }
 
@@ -195,7 +357,7 @@ RakString *rak_string_new_copy(RakString *str, RakError *err)
 void rak_string_free(RakString *str)
 {
   rak_string_deinit(str);
-  rak_memory_free(str);
+  rak_arena_free_object(str);
 }
 
 void rak_string_release(RakString *str)
@@ -208,26 +370,41 @@ void rak_string_release(RakString *str)
 
 void rak_string_ensure_capacity(RakString *str, int cap, RakError *err)
 {
-  rak_slice_ensure_capacity(&str->slice, cap, err);
+  if (cap <= rak_string_cap(str)) return;
+  if (rak_string_is_view(str))
+  {
+    materialize(str, cap, err);
+    return;
+  }
+  if (!rak_string_is_inline(str))
+  {
+    rak_slice_ensure_capacity(&str->slice, cap, err);
+    return;
+  }
+  int _cap = rak_string_cap(str);
+  while (_cap < cap) _cap <<= 1;
+  char *data = rak_memory_alloc(_cap, err);
+  if (!rak_is_ok(err)) return;
+  memcpy(data, str->buf, rak_string_len(str));
+  str->slice.cap = _cap;
+  str->slice.data = data;
 }
 
 RakString *rak_string_append_cstr(RakString *str, int len, const char *cstr, RakError *err)
 {
-  // TODO: Implement this function.
-  (void) str;
-  (void) len;
-  (void) cstr;
-  (void) err;
+  RakString *_str = rak_string_new_copy(str, err);
+  if (!rak_is_ok(err)) return NULL;
+  // Growing the copy, rather than sizing it exactly, leaves room for the appends that
+  // usually follow.
+  rak_string_inplace_append_cstr(_str, len, cstr, err);
+  if (rak_is_ok(err)) return _str;
+  rak_string_free(_str);
   return NULL;
 }
 
 RakString *rak_string_concat(RakString *str1, RakString *str2, RakError *err)
 {
-  // TODO: Implement this function.
-  (void) str1;
-  (void) str2;
-  (void) err;
-  return NULL;
+  return rak_string_append_cstr(str1, rak_string_len(str2), rak_string_chars(str2), err);
 }
 
 RakString *rak_string_slice(RakString *str, int start, int end, RakError *err)
@@ -238,10 +415,24 @@ RakString *rak_string_slice(RakString *str, int start, int end, RakError *err)
     return NULL;
   }
   int len = start < end ? end - start : 0;
-  RakString *_str = rak_string_new_with_capacity(len, err);
+  RakString *parent = rak_string_is_view(str) ? str->parent : str;
+  if (should_copy(parent, len))
+  {
+    RakString *_str = rak_string_new_with_capacity(len, err);
+    if (!rak_is_ok(err)) return NULL;
+    memcpy(rak_string_chars(_str), rak_string_chars(str) + start, len);
+    _str->slice.len = len;
+    return _str;
+  }
+  RakString *_str = rak_arena_alloc_object(sizeof(*_str), err);
   if (!rak_is_ok(err)) return NULL;
-  memcpy(rak_string_chars(_str), rak_string_chars(str) + start, len);
+  init_header(_str);
+  _str->parent = parent;
+  _str->slice.cap = len;
   _str->slice.len = len;
+  _str->slice.data = rak_string_chars(str) + start;
+  rak_object_retain(&parent->obj);
+  rak_memory_track_object(RAK_TYPE_STRING, 1);
   return _str;
 }
 
@@ -250,6 +441,7 @@ void rak_string_inplace_append_cstr(RakString *str, int len, const char *cstr, R
   if (len < 0) len = (int) strlen(cstr);
   rak_string_ensure_capacity(str, rak_string_len(str) + len, err);
   if (!rak_is_ok(err)) return;
+  invalidate(str);
   memcpy(&str->slice.data[rak_string_len(str)], cstr, len);
   str->slice.len += len;
 }
@@ -262,32 +454,133 @@ void rak_string_inplace_concat(RakString *str1, RakString *str2, RakError *err)
   int len = len1 + len2;
   rak_string_ensure_capacity(str1, len, err);
   if (!rak_is_ok(err)) return;
+  invalidate(str1);
   memcpy(&str1->slice.data[len1], rak_string_chars(str2), len2);
   str1->slice.len = len;
 }
 
 void rak_string_inplace_slice(RakString *str, int start, int end, RakError *err)
 {
-  // TODO: Implement this function.
-  (void) str;
-  (void) start;
-  (void) end;
-  (void) err;
+  if (start < 0 || end > rak_string_len(str))
+  {
+    rak_error_set(err, "string slice out of bounds");
+    return;
+  }
+  int len = start < end ? end - start : 0;
+  invalidate(str);
+  if (!rak_string_is_view(str)
+   && (rak_string_is_inline(str) || should_copy(str, len) || !detach_buffer(str)))
+  {
+    memmove(rak_string_chars(str), rak_string_chars(str) + start, len);
+    str->slice.len = len;
+    return;
+  }
+  str->slice.cap = len;
+  str->slice.len = len;
+  str->slice.data += start;
+  if (!should_copy(str->parent, len)) return;
+  materialize(str, len, err);
 }
 
 void rak_string_inplace_clear(RakString *str)
 {
+  invalidate(str);
   rak_slice_clear(&str->slice);
 }
 
+uint32_t rak_string_hash(RakString *str)
+{
+  if (!str->hash) str->hash = hash_chars(rak_string_len(str), rak_string_chars(str));
+  return str->hash;
+}
+
+RakString *rak_string_intern(RakString *str, RakError *err)
+{
+  if (str->interned) return str;
+  uint32_t hash = rak_string_hash(str);
+  int len = rak_string_len(str);
+  char *chars = rak_string_chars(str);
+  int idx = -1;
+  if (tableCap)
+  {
+    idx = find_slot(len, chars, hash);
+    RakString *_str = table[idx];
+    if (_str && _str != &tombstone) return _str;
+  }
+  if ((tableUsed + 1) * 2 > tableCap)
+  {
+    grow_table(err);
+    if (!rak_is_ok(err)) return NULL;
+    idx = find_slot(len, chars, hash);
+  }
+  if (!table[idx]) ++tableUsed;
+  table[idx] = str;
+  ++tableLen;
+  str->interned = true;
+  return str;
+}
+
 bool rak_string_equals(RakString *str1, RakString *str2)
 {
   if (str1 == str2) return true;
+  // There is only one interned string with given contents.
+  if (str1->interned && str2->interned) return false;
+  if (str1->hash && str2->hash && str1->hash != str2->hash) return false;
   int len = rak_string_len(str1);
   if (len != rak_string_len(str2)) return false;
   return !memcmp(rak_string_chars(str1), rak_string_chars(str2), len);
 }
 
+int rak_string_find(RakString *str, RakString *sub, int start)
+{
+  int len = rak_string_len(str);
+  if (start > len) return -1;
+  int idx = rak_search_find(len - start, rak_string_chars(str) + start,
+    rak_string_len(sub), rak_string_chars(sub));
+  return idx < 0 ? -1 : start + idx;
+}
+
+int rak_string_count(RakString *str, RakString *sub)
+{
+  int len = rak_string_len(sub);
+  if (!len) return rak_string_len(str) + 1;
+  int n = 0;
+  int idx = rak_string_find(str, sub, 0);
+  while (idx >= 0)
+  {
+    ++n;
+    idx = rak_string_find(str, sub, idx + len);
+  }
+  return n;
+}
+
+RakString *rak_string_replace(RakString *str, RakString *sub, RakString *rep, RakError *err)
+{
+  if (rak_string_is_empty(sub)) return str;
+  int idx = rak_string_find(str, sub, 0);
+  if (idx < 0) return str;
+  int len = rak_string_len(sub);
+  int n = rak_string_count(str, sub);
+  int _len = rak_string_len(str) + n * (rak_string_len(rep) - len);
+  RakString *_str = rak_string_new_with_capacity(_len, err);
+  if (!rak_is_ok(err)) return NULL;
+  char *chars = rak_string_chars(str);
+  char *dest = rak_string_chars(_str);
+  int start = 0;
+  while (idx >= 0)
+  {
+    memcpy(dest, chars + start, idx - start);
+    dest += idx - start;
+    memcpy(dest, rak_string_chars(rep), rak_string_len(rep));
+    dest += rak_string_len(rep);
+    start = idx + len;
+    idx = rak_string_find(str, sub, start);
+  }
+  memcpy(dest, chars + start, rak_string_len(str) - start);
+  _str->slice.len = _len;
+  return _str;
+}
+
 int rak_string_compare(RakString *str1, RakString *str2)
 {
   if (str1 == str2) return 0;
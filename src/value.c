@@ -9,12 +9,11 @@
 //
 
 #include "rak/value.h"
-#include <errno.h>
 #include <math.h>
 #include <stdio.h>
-#include <stdlib.h>
 #include <string.h>
 #include "rak/fiber.h"
+#include "rak/number.h"
 #include "rak/range.h"
 #include "rak/record.h"
 
@@ -40,9 +39,8 @@ const char *rak_type_to_cstr(RakType type)
 RakValue rak_number_value_from_cstr(int len, const char *cstr, RakError *err)
 {
   if (len < 0) len = (int) strlen(cstr);
-  errno = 0;
-  double data = strtod(cstr, NULL);
-  if (errno)
+  double data;
+  if (!rak_number_parse(len, cstr, &data))
   {
     rak_error_set(err, "invalid number format");
     return rak_nil_value();
@@ -59,7 +57,7 @@ int rak_number_compare(double num1, double num2)
 
 void rak_value_free(RakValue val)
 {
-  switch (val.type)
+  switch (rak_type_of(val))
   {
   case RAK_TYPE_NIL:
   case RAK_TYPE_BOOL:
@@ -73,6 +71,7 @@ void rak_value_free(RakValue val)
     rak_array_free(rak_as_array(val));
     break;
   case RAK_TYPE_RANGE:
+    if (rak_range_is_immediate(val)) break;
     rak_range_free(rak_as_range(val));
     break;
   case RAK_TYPE_RECORD:
@@ -89,7 +88,8 @@ void rak_value_free(RakValue val)
 
 void rak_value_release(RakValue val)
 {
-  switch (val.type)
+  if (!rak_is_refcounted(val)) return;
+  switch (rak_type_of(val))
   {
   case RAK_TYPE_NIL:
   case RAK_TYPE_BOOL:
@@ -103,6 +103,7 @@ void rak_value_release(RakValue val)
     rak_array_release(rak_as_array(val));
     break;
   case RAK_TYPE_RANGE:
+    if (rak_range_is_immediate(val)) break;
     rak_range_release(rak_as_range(val));
     break;
   case RAK_TYPE_RECORD:
@@ -119,10 +120,10 @@ void rak_value_release(RakValue val)
 
 bool rak_value_equals(RakValue val1, RakValue val2)
 {
-  if (val1.type != val2.type)
+  if (rak_type_of(val1) != rak_type_of(val2))
     return false;
   bool res = true;
-  switch (val1.type)
+  switch (rak_type_of(val1))
   {
   case RAK_TYPE_NIL:
     break;
@@ -139,7 +140,7 @@ bool rak_value_equals(RakValue val1, RakValue val2)
     res = rak_array_equals(rak_as_array(val1), rak_as_array(val2));
     break;
   case RAK_TYPE_RANGE:
-    res = rak_range_equals(rak_as_range(val1), rak_as_range(val2));
+    res = rak_range_value_equals(val1, val2);
     break;
   case RAK_TYPE_RECORD:
     res = rak_record_equals(rak_as_record(val1), rak_as_record(val2));
@@ -147,7 +148,7 @@ bool rak_value_equals(RakValue val1, RakValue val2)
   case RAK_TYPE_CLOSURE:
   case RAK_TYPE_FIBER:
   case RAK_TYPE_REF:
-    res = val1.opaque.ptr == val2.opaque.ptr;
+    res = rak_as_ptr(val1) == rak_as_ptr(val2);
     break;
   }
   return res;
@@ -155,13 +156,13 @@ bool rak_value_equals(RakValue val1, RakValue val2)
 
 int rak_value_compare(RakValue val1, RakValue val2, RakError *err)
 {
-  if (val1.type != val2.type)
+  if (rak_type_of(val1) != rak_type_of(val2))
   {
     rak_error_set(err, "cannot compare different types");
     return 0;
   }
   int res = 0;
-  switch (val1.type)
+  switch (rak_type_of(val1))
   {
   case RAK_TYPE_NIL:
     break;
@@ -180,7 +181,7 @@ int rak_value_compare(RakValue val1, RakValue val2, RakError *err)
   case RAK_TYPE_CLOSURE:
   case RAK_TYPE_FIBER:
   case RAK_TYPE_REF:
-    rak_error_set(err, "cannot compare %s", rak_type_to_cstr(val1.type));
+    rak_error_set(err, "cannot compare %s", rak_type_to_cstr(rak_type_of(val1)));
     break;
   }
   return res;
@@ -188,7 +189,7 @@ int rak_value_compare(RakValue val1, RakValue val2, RakError *err)
 
 void rak_value_print(RakValue val)
 {
-  switch (val.type)
+  switch (rak_type_of(val))
   {
   case RAK_TYPE_NIL:
     printf("nil");
@@ -197,7 +198,11 @@ void rak_value_print(RakValue val)
     printf("%s", rak_as_bool(val) ? "true" : "false");
     break;
   case RAK_TYPE_NUMBER:
-    printf("%g", rak_as_number(val));
+    {
+      char buf[RAK_NUMBER_MAX_CHARS];
+      int len = rak_number_format(rak_as_number(val), buf);
+      fwrite(buf, 1, len, stdout);
+    }
     break;
   case RAK_TYPE_STRING:
     rak_string_print(rak_as_string(val));
@@ -206,7 +211,7 @@ void rak_value_print(RakValue val)
     rak_array_print(rak_as_array(val));
     break;
   case RAK_TYPE_RANGE:
-    rak_range_print(rak_as_range(val));
+    rak_range_value_print(val);
     break;
   case RAK_TYPE_RECORD:
     rak_record_print(rak_as_record(val));
@@ -214,7 +219,7 @@ void rak_value_print(RakValue val)
   case RAK_TYPE_CLOSURE:
   case RAK_TYPE_FIBER:
   case RAK_TYPE_REF:
-    printf("<%s %p>",rak_type_to_cstr(val.type), val.opaque.ptr);
+    printf("<%s %p>",rak_type_to_cstr(rak_type_of(val)), rak_as_ptr(val));
     break;
   }
 }
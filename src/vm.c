@@ -9,6 +9,778 @@
 //
 
 #include "rak/vm.h"
+#include <string.h>
+
+#ifdef RAK_JIT
+  #include "rak/jit.h"
+#endif
+
+#ifdef RAK_VM_STATS
+
+#include <stdio.h>
+#include <stdlib.h>
+
+typedef struct
+{
+  RakOpcode first;
+  RakOpcode second;
+  uint64_t  count;
+} Pair;
+
+static uint64_t opCounts[RAK_OP_COUNT];
+static uint64_t pairCounts[RAK_OP_COUNT][RAK_OP_COUNT];
+static int prevOp = -1;
+
+static inline void count_op(RakOpcode op);
+static int compare_pairs(const void *a, const void *b);
+
+static inline void count_op(RakOpcode op)
+{
+  ++opCounts[op];
+  if (prevOp != -1)
+    ++pairCounts[prevOp][op];
+  prevOp = (int) op;
+}
+
+static int compare_pairs(const void *a, const void *b)
+{
+  const Pair *x = a;
+  const Pair *y = b;
+  if (x->count != y->count)
+    return x->count > y->count ? -1 : 1;
+  if (x->first != y->first)
+    return (int) x->first - (int) y->first;
+  return (int) x->second - (int) y->second;
+}
+
+void rak_vm_print_stats(int n)
+{
+  static Pair pairs[RAK_OP_COUNT * RAK_OP_COUNT];
+  Pair ops[RAK_OP_COUNT];
+  uint64_t total = 0;
+  for (int i = 0; i < RAK_OP_COUNT; ++i)
+  {
+    ops[i] = (Pair) { .first = (RakOpcode) i, .second = RAK_OP_NOP, .count = opCounts[i] };
+    total += opCounts[i];
+    for (int j = 0; j < RAK_OP_COUNT; ++j)
+      pairs[i * RAK_OP_COUNT + j] = (Pair) {
+        .first = (RakOpcode) i,
+        .second = (RakOpcode) j,
+        .count = pairCounts[i][j]
+      };
+  }
+  qsort(ops, RAK_OP_COUNT, sizeof(*ops), compare_pairs);
+  qsort(pairs, RAK_OP_COUNT * RAK_OP_COUNT, sizeof(*pairs), compare_pairs);
+  double base = total ? (double) total : 1.0;
+  fflush(stdout);
+  fprintf(stderr, "\n%-40s %16s %7s\n", "opcode", "count", "%");
+  for (int i = 0; i < n && i < RAK_OP_COUNT && ops[i].count; ++i)
+    fprintf(stderr, "%-40s %16llu %6.2f%%\n", rak_opcode_to_cstr(ops[i].first),
+      (unsigned long long) ops[i].count, 100.0 * (double) ops[i].count / base);
+  fprintf(stderr, "\n%-40s %16s %7s\n", "pair", "count", "%");
+  for (int i = 0; i < n && i < RAK_OP_COUNT * RAK_OP_COUNT && pairs[i].count; ++i)
+  {
+    char name[64];
+    snprintf(name, sizeof(name), "%s -> %s", rak_opcode_to_cstr(pairs[i].first),
+      rak_opcode_to_cstr(pairs[i].second));
+    fprintf(stderr, "%-40s %16llu %6.2f%%\n", name,
+      (unsigned long long) pairs[i].count, 100.0 * (double) pairs[i].count / base);
+  }
+}
+
+#endif
+
+#ifdef RAK_VM_DISPATCH_LOOP
+
+#if defined(__GNUC__) || defined(__clang__)
+  #define RAK_VM_COMPUTED_GOTO
+#endif
+
+#ifdef RAK_VM_STATS
+  #define vm_count() count_op(rak_instr_opcode(*ip))
+#else
+  #define vm_count() ((void) 0)
+#endif
+
+#ifdef RAK_VM_COMPUTED_GOTO
+  #define vm_case(op) case op: label_##op
+  #define vm_next()   do { vm_count(); goto *table[rak_instr_opcode(*ip)]; } while (0)
+#else
+  #define vm_case(op) case op
+  #define vm_next()   do { vm_count(); goto dispatch; } while (0)
+#endif
+
+#ifdef RAK_VM_COMPUTED_GOTO
+static RakVmHook hook = NULL;
+#endif
+
+#ifdef RAK_VM_COMPUTED_GOTO
+  #pragma GCC diagnostic push
+  #pragma GCC diagnostic ignored "-Wpedantic"
+#endif
+
+void rak_vm_dispatch(RakFiber *fiber, RakClosure *cl, uint32_t *ip, RakValue *slots, RakError *err)
+{
+#ifdef RAK_JIT
+  if (rak_jit_dispatch(fiber, cl, ip, slots, err)) return;
+#endif
+#ifdef RAK_VM_COMPUTED_GOTO
+  static void *labels[] = {
+    [RAK_OP_NOP]                    = &&label_RAK_OP_NOP,
+    [RAK_OP_PUSH_NIL]               = &&label_RAK_OP_PUSH_NIL,
+    [RAK_OP_PUSH_FALSE]             = &&label_RAK_OP_PUSH_FALSE,
+    [RAK_OP_PUSH_TRUE]              = &&label_RAK_OP_PUSH_TRUE,
+    [RAK_OP_PUSH_INT]               = &&label_RAK_OP_PUSH_INT,
+    [RAK_OP_LOAD_CONST]             = &&label_RAK_OP_LOAD_CONST,
+    [RAK_OP_LOAD_GLOBAL]            = &&label_RAK_OP_LOAD_GLOBAL,
+    [RAK_OP_LOAD_LOCAL]             = &&label_RAK_OP_LOAD_LOCAL,
+    [RAK_OP_STORE_LOCAL]            = &&label_RAK_OP_STORE_LOCAL,
+    [RAK_OP_FETCH_LOCAL]            = &&label_RAK_OP_FETCH_LOCAL,
+    [RAK_OP_REF_LOCAL]              = &&label_RAK_OP_REF_LOCAL,
+    [RAK_OP_LOAD_LOCAL_REF]         = &&label_RAK_OP_LOAD_LOCAL_REF,
+    [RAK_OP_STORE_LOCAL_REF]        = &&label_RAK_OP_STORE_LOCAL_REF,
+    [RAK_OP_NEW_ARRAY]              = &&label_RAK_OP_NEW_ARRAY,
+    [RAK_OP_NEW_RANGE]              = &&label_RAK_OP_NEW_RANGE,
+    [RAK_OP_NEW_RECORD]             = &&label_RAK_OP_NEW_RECORD,
+    [RAK_OP_NEW_CLOSURE]            = &&label_RAK_OP_NEW_CLOSURE,
+    [RAK_OP_MOVE]                   = &&label_RAK_OP_MOVE,
+    [RAK_OP_POP]                    = &&label_RAK_OP_POP,
+    [RAK_OP_GET_ELEMENT]            = &&label_RAK_OP_GET_ELEMENT,
+    [RAK_OP_SET_ELEMENT]            = &&label_RAK_OP_SET_ELEMENT,
+    [RAK_OP_LOAD_ELEMENT]           = &&label_RAK_OP_LOAD_ELEMENT,
+    [RAK_OP_FETCH_ELEMENT]          = &&label_RAK_OP_FETCH_ELEMENT,
+    [RAK_OP_UPDATE_ELEMENT]         = &&label_RAK_OP_UPDATE_ELEMENT,
+    [RAK_OP_GET_FIELD]              = &&label_RAK_OP_GET_FIELD,
+    [RAK_OP_PUT_FIELD]              = &&label_RAK_OP_PUT_FIELD,
+    [RAK_OP_LOAD_FIELD]             = &&label_RAK_OP_LOAD_FIELD,
+    [RAK_OP_FETCH_FIELD]            = &&label_RAK_OP_FETCH_FIELD,
+    [RAK_OP_UPDATE_FIELD]           = &&label_RAK_OP_UPDATE_FIELD,
+    [RAK_OP_UNPACK_ELEMENTS]        = &&label_RAK_OP_UNPACK_ELEMENTS,
+    [RAK_OP_UNPACK_FIELDS]          = &&label_RAK_OP_UNPACK_FIELDS,
+    [RAK_OP_JUMP]                   = &&label_RAK_OP_JUMP,
+    [RAK_OP_JUMP_IF_FALSE]          = &&label_RAK_OP_JUMP_IF_FALSE,
+    [RAK_OP_JUMP_IF_FALSE_OR_POP]   = &&label_RAK_OP_JUMP_IF_FALSE_OR_POP,
+    [RAK_OP_JUMP_IF_TRUE_OR_POP]    = &&label_RAK_OP_JUMP_IF_TRUE_OR_POP,
+    [RAK_OP_EQ]                     = &&label_RAK_OP_EQ,
+    [RAK_OP_NE]                     = &&label_RAK_OP_NE,
+    [RAK_OP_GT]                     = &&label_RAK_OP_GT,
+    [RAK_OP_GE]                     = &&label_RAK_OP_GE,
+    [RAK_OP_LT]                     = &&label_RAK_OP_LT,
+    [RAK_OP_LE]                     = &&label_RAK_OP_LE,
+    [RAK_OP_EQ_LOCALS_JUMP_IF_FALSE]= &&label_RAK_OP_EQ_LOCALS_JUMP_IF_FALSE,
+    [RAK_OP_EQ_CONST_JUMP_IF_FALSE] = &&label_RAK_OP_EQ_CONST_JUMP_IF_FALSE,
+    [RAK_OP_EQ_INT_JUMP_IF_FALSE]   = &&label_RAK_OP_EQ_INT_JUMP_IF_FALSE,
+    [RAK_OP_NE_LOCALS_JUMP_IF_FALSE]= &&label_RAK_OP_NE_LOCALS_JUMP_IF_FALSE,
+    [RAK_OP_NE_CONST_JUMP_IF_FALSE] = &&label_RAK_OP_NE_CONST_JUMP_IF_FALSE,
+    [RAK_OP_NE_INT_JUMP_IF_FALSE]   = &&label_RAK_OP_NE_INT_JUMP_IF_FALSE,
+    [RAK_OP_GT_LOCALS_JUMP_IF_FALSE]= &&label_RAK_OP_GT_LOCALS_JUMP_IF_FALSE,
+    [RAK_OP_GT_CONST_JUMP_IF_FALSE] = &&label_RAK_OP_GT_CONST_JUMP_IF_FALSE,
+    [RAK_OP_GT_INT_JUMP_IF_FALSE]   = &&label_RAK_OP_GT_INT_JUMP_IF_FALSE,
+    [RAK_OP_GE_LOCALS_JUMP_IF_FALSE]= &&label_RAK_OP_GE_LOCALS_JUMP_IF_FALSE,
+    [RAK_OP_GE_CONST_JUMP_IF_FALSE] = &&label_RAK_OP_GE_CONST_JUMP_IF_FALSE,
+    [RAK_OP_GE_INT_JUMP_IF_FALSE]   = &&label_RAK_OP_GE_INT_JUMP_IF_FALSE,
+    [RAK_OP_LT_LOCALS_JUMP_IF_FALSE]= &&label_RAK_OP_LT_LOCALS_JUMP_IF_FALSE,
+    [RAK_OP_LT_CONST_JUMP_IF_FALSE] = &&label_RAK_OP_LT_CONST_JUMP_IF_FALSE,
+    [RAK_OP_LT_INT_JUMP_IF_FALSE]   = &&label_RAK_OP_LT_INT_JUMP_IF_FALSE,
+    [RAK_OP_LE_LOCALS_JUMP_IF_FALSE]= &&label_RAK_OP_LE_LOCALS_JUMP_IF_FALSE,
+    [RAK_OP_LE_CONST_JUMP_IF_FALSE] = &&label_RAK_OP_LE_CONST_JUMP_IF_FALSE,
+    [RAK_OP_LE_INT_JUMP_IF_FALSE]   = &&label_RAK_OP_LE_INT_JUMP_IF_FALSE,
+    [RAK_OP_ADD]                    = &&label_RAK_OP_ADD,
+    [RAK_OP_ADD2]                   = &&label_RAK_OP_ADD2,
+    [RAK_OP_ADD3]                   = &&label_RAK_OP_ADD3,
+    [RAK_OP_SUB]                    = &&label_RAK_OP_SUB,
+    [RAK_OP_SUB2]                   = &&label_RAK_OP_SUB2,
+    [RAK_OP_SUB3]                   = &&label_RAK_OP_SUB3,
+    [RAK_OP_MUL]                    = &&label_RAK_OP_MUL,
+    [RAK_OP_MUL2]                   = &&label_RAK_OP_MUL2,
+    [RAK_OP_MUL3]                   = &&label_RAK_OP_MUL3,
+    [RAK_OP_DIV]                    = &&label_RAK_OP_DIV,
+    [RAK_OP_DIV2]                   = &&label_RAK_OP_DIV2,
+    [RAK_OP_DIV3]                   = &&label_RAK_OP_DIV3,
+    [RAK_OP_MOD]                    = &&label_RAK_OP_MOD,
+    [RAK_OP_MOD2]                   = &&label_RAK_OP_MOD2,
+    [RAK_OP_MOD3]                   = &&label_RAK_OP_MOD3,
+    [RAK_OP_NOT]                    = &&label_RAK_OP_NOT,
+    [RAK_OP_NEG]                    = &&label_RAK_OP_NEG,
+    [RAK_OP_CALL]                   = &&label_RAK_OP_CALL,
+    [RAK_OP_TAIL_CALL]              = &&label_RAK_OP_TAIL_CALL,
+    [RAK_OP_YIELD]                  = &&label_RAK_OP_YIELD,
+    [RAK_OP_RETURN]                 = &&label_RAK_OP_RETURN,
+    [RAK_OP_RETURN_NIL]             = &&label_RAK_OP_RETURN_NIL,
+    [RAK_OP_EQ_NUM]                 = &&label_RAK_OP_EQ_NUM,
+    [RAK_OP_NE_NUM]                 = &&label_RAK_OP_NE_NUM,
+    [RAK_OP_GT_NUM]                 = &&label_RAK_OP_GT_NUM,
+    [RAK_OP_GE_NUM]                 = &&label_RAK_OP_GE_NUM,
+    [RAK_OP_LT_NUM]                 = &&label_RAK_OP_LT_NUM,
+    [RAK_OP_LE_NUM]                 = &&label_RAK_OP_LE_NUM,
+    [RAK_OP_ADD_NUM]                = &&label_RAK_OP_ADD_NUM,
+    [RAK_OP_ADD2_NUM]               = &&label_RAK_OP_ADD2_NUM,
+    [RAK_OP_ADD3_NUM]               = &&label_RAK_OP_ADD3_NUM,
+  };
+  static void *hookLabels[] = {
+    [0 ... (sizeof(labels) / sizeof(*labels)) - 1] = &&label_hook
+  };
+  // Selecting the table once per entry keeps the hook off the plain path.
+  void **table = hook ? hookLabels : labels;
+#endif
+  vm_next();
+enter:
+  {
+    RakCallFrame *frame = &rak_stack_get(&fiber->cstk, 0);
+    if (frame->cl->type != RAK_CALLABLE_TYPE_FUNCTION) return;
+    cl = frame->cl;
+    ip = (uint32_t *) frame->state;
+    slots = frame->slots;
+  }
+  vm_next();
+#ifdef RAK_VM_COMPUTED_GOTO
+label_hook:
+  hook(fiber, cl, ip, err);
+  if (!rak_is_ok(err)) return;
+  goto *labels[rak_instr_opcode(*ip)];
+#else
+dispatch:
+#endif
+  switch (rak_instr_opcode(*ip))
+  {
+  vm_case(RAK_OP_NOP):
+    ++ip;
+    vm_next();
+
+  vm_case(RAK_OP_PUSH_NIL):
+    rak_vm_push_nil(fiber, cl, ip, slots, err);
+    if (!rak_is_ok(err)) return;
+    ++ip;
+    vm_next();
+
+  vm_case(RAK_OP_PUSH_FALSE):
+    rak_vm_push_false(fiber, cl, ip, slots, err);
+    if (!rak_is_ok(err)) return;
+    ++ip;
+    vm_next();
+
+  vm_case(RAK_OP_PUSH_TRUE):
+    rak_vm_push_true(fiber, cl, ip, slots, err);
+    if (!rak_is_ok(err)) return;
+    ++ip;
+    vm_next();
+
+  vm_case(RAK_OP_PUSH_INT):
+    rak_vm_push_int(fiber, cl, ip, slots, err);
+    if (!rak_is_ok(err)) return;
+    ++ip;
+    vm_next();
+
+  vm_case(RAK_OP_LOAD_CONST):
+    rak_vm_load_const(fiber, cl, ip, slots, err);
+    if (!rak_is_ok(err)) return;
+    ++ip;
+    vm_next();
+
+  vm_case(RAK_OP_LOAD_GLOBAL):
+    rak_vm_load_global(fiber, cl, ip, slots, err);
+    if (!rak_is_ok(err)) return;
+    ++ip;
+    vm_next();
+
+  vm_case(RAK_OP_LOAD_LOCAL):
+    rak_vm_load_local(fiber, cl, ip, slots, err);
+    if (!rak_is_ok(err)) return;
+    ++ip;
+    vm_next();
+
+  vm_case(RAK_OP_STORE_LOCAL):
+    rak_vm_store_local(fiber, cl, ip, slots, err);
+    ++ip;
+    vm_next();
+
+  vm_case(RAK_OP_FETCH_LOCAL):
+    rak_vm_fetch_local(fiber, cl, ip, slots, err);
+    if (!rak_is_ok(err)) return;
+    ++ip;
+    vm_next();
+
+  vm_case(RAK_OP_REF_LOCAL):
+    rak_vm_ref_local(fiber, cl, ip, slots, err);
+    if (!rak_is_ok(err)) return;
+    ++ip;
+    vm_next();
+
+  vm_case(RAK_OP_LOAD_LOCAL_REF):
+    rak_vm_load_local_ref(fiber, cl, ip, slots, err);
+    if (!rak_is_ok(err)) return;
+    ++ip;
+    vm_next();
+
+  vm_case(RAK_OP_STORE_LOCAL_REF):
+    rak_vm_store_local_ref(fiber, cl, ip, slots, err);
+    ++ip;
+    vm_next();
+
+  vm_case(RAK_OP_NEW_ARRAY):
+    rak_vm_new_array(fiber, cl, ip, slots, err);
+    if (!rak_is_ok(err)) return;
+    ++ip;
+    vm_next();
+
+  vm_case(RAK_OP_NEW_RANGE):
+    rak_vm_new_range(fiber, cl, ip, slots, err);
+    if (!rak_is_ok(err)) return;
+    ++ip;
+    vm_next();
+
+  vm_case(RAK_OP_NEW_RECORD):
+    rak_vm_new_record(fiber, cl, ip, slots, err);
+    if (!rak_is_ok(err)) return;
+    ++ip;
+    vm_next();
+
+  vm_case(RAK_OP_NEW_CLOSURE):
+    rak_vm_new_closure(fiber, cl, ip, slots, err);
+    if (!rak_is_ok(err)) return;
+    ++ip;
+    vm_next();
+
+  vm_case(RAK_OP_MOVE):
+    rak_vm_move(fiber, cl, ip, slots, err);
+    ++ip;
+    vm_next();
+
+  vm_case(RAK_OP_POP):
+    rak_vm_pop(fiber, cl, ip, slots, err);
+    ++ip;
+    vm_next();
+
+  vm_case(RAK_OP_GET_ELEMENT):
+    rak_vm_get_element(fiber, cl, ip, slots, err);
+    if (!rak_is_ok(err)) return;
+    ++ip;
+    vm_next();
+
+  vm_case(RAK_OP_SET_ELEMENT):
+    rak_vm_set_element(fiber, cl, ip, slots, err);
+    if (!rak_is_ok(err)) return;
+    ++ip;
+    vm_next();
+
+  vm_case(RAK_OP_LOAD_ELEMENT):
+    rak_vm_load_element(fiber, cl, ip, slots, err);
+    if (!rak_is_ok(err)) return;
+    ++ip;
+    vm_next();
+
+  vm_case(RAK_OP_FETCH_ELEMENT):
+    rak_vm_fetch_element(fiber, cl, ip, slots, err);
+    if (!rak_is_ok(err)) return;
+    ++ip;
+    vm_next();
+
+  vm_case(RAK_OP_UPDATE_ELEMENT):
+    rak_vm_update_element(fiber, cl, ip, slots, err);
+    if (!rak_is_ok(err)) return;
+    ++ip;
+    vm_next();
+
+  vm_case(RAK_OP_GET_FIELD):
+    rak_vm_get_field(fiber, cl, ip, slots, err);
+    if (!rak_is_ok(err)) return;
+    ++ip;
+    vm_next();
+
+  vm_case(RAK_OP_PUT_FIELD):
+    rak_vm_put_field(fiber, cl, ip, slots, err);
+    if (!rak_is_ok(err)) return;
+    ++ip;
+    vm_next();
+
+  vm_case(RAK_OP_LOAD_FIELD):
+    rak_vm_load_field(fiber, cl, ip, slots, err);
+    if (!rak_is_ok(err)) return;
+    ++ip;
+    vm_next();
+
+  vm_case(RAK_OP_FETCH_FIELD):
+    rak_vm_fetch_field(fiber, cl, ip, slots, err);
+    if (!rak_is_ok(err)) return;
+    ++ip;
+    vm_next();
+
+  vm_case(RAK_OP_UPDATE_FIELD):
+    rak_vm_update_field(fiber, cl, ip, slots, err);
+    if (!rak_is_ok(err)) return;
+    ++ip;
+    vm_next();
+
+  vm_case(RAK_OP_UNPACK_ELEMENTS):
+    rak_vm_unpack_elements(fiber, cl, ip, slots, err);
+    if (!rak_is_ok(err)) return;
+    ++ip;
+    vm_next();
+
+  vm_case(RAK_OP_UNPACK_FIELDS):
+    rak_vm_unpack_fields(fiber, cl, ip, slots, err);
+    if (!rak_is_ok(err)) return;
+    ++ip;
+    vm_next();
+
+  vm_case(RAK_OP_JUMP):
+    rak_vm_jump(fiber, cl, ip, slots, err);
+    ip = (uint32_t *) rak_stack_get(&fiber->cstk, 0).state;
+    vm_next();
+
+  vm_case(RAK_OP_JUMP_IF_FALSE):
+    rak_vm_jump_if_false(fiber, cl, ip, slots, err);
+    ip = (uint32_t *) rak_stack_get(&fiber->cstk, 0).state;
+    vm_next();
+
+  vm_case(RAK_OP_JUMP_IF_FALSE_OR_POP):
+    rak_vm_jump_if_false_or_pop(fiber, cl, ip, slots, err);
+    ip = (uint32_t *) rak_stack_get(&fiber->cstk, 0).state;
+    vm_next();
+
+  vm_case(RAK_OP_JUMP_IF_TRUE_OR_POP):
+    rak_vm_jump_if_true_or_pop(fiber, cl, ip, slots, err);
+    ip = (uint32_t *) rak_stack_get(&fiber->cstk, 0).state;
+    vm_next();
+
+  vm_case(RAK_OP_EQ):
+    rak_vm_eq(fiber, cl, ip, slots, err);
+    ++ip;
+    vm_next();
+
+  vm_case(RAK_OP_NE):
+    rak_vm_ne(fiber, cl, ip, slots, err);
+    ++ip;
+    vm_next();
+
+  vm_case(RAK_OP_GT):
+    rak_vm_gt(fiber, cl, ip, slots, err);
+    if (!rak_is_ok(err)) return;
+    ++ip;
+    vm_next();
+
+  vm_case(RAK_OP_GE):
+    rak_vm_ge(fiber, cl, ip, slots, err);
+    if (!rak_is_ok(err)) return;
+    ++ip;
+    vm_next();
+
+  vm_case(RAK_OP_LT):
+    rak_vm_lt(fiber, cl, ip, slots, err);
+    if (!rak_is_ok(err)) return;
+    ++ip;
+    vm_next();
+
+  vm_case(RAK_OP_LE):
+    rak_vm_le(fiber, cl, ip, slots, err);
+    if (!rak_is_ok(err)) return;
+    ++ip;
+    vm_next();
+
+  vm_case(RAK_OP_EQ_LOCALS_JUMP_IF_FALSE):
+    rak_vm_eq_locals_jump_if_false(fiber, cl, ip, slots, err);
+    if (!rak_is_ok(err)) return;
+    ip = (uint32_t *) rak_stack_get(&fiber->cstk, 0).state;
+    vm_next();
+
+  vm_case(RAK_OP_EQ_CONST_JUMP_IF_FALSE):
+    rak_vm_eq_const_jump_if_false(fiber, cl, ip, slots, err);
+    if (!rak_is_ok(err)) return;
+    ip = (uint32_t *) rak_stack_get(&fiber->cstk, 0).state;
+    vm_next();
+
+  vm_case(RAK_OP_EQ_INT_JUMP_IF_FALSE):
+    rak_vm_eq_int_jump_if_false(fiber, cl, ip, slots, err);
+    if (!rak_is_ok(err)) return;
+    ip = (uint32_t *) rak_stack_get(&fiber->cstk, 0).state;
+    vm_next();
+
+  vm_case(RAK_OP_NE_LOCALS_JUMP_IF_FALSE):
+    rak_vm_ne_locals_jump_if_false(fiber, cl, ip, slots, err);
+    if (!rak_is_ok(err)) return;
+    ip = (uint32_t *) rak_stack_get(&fiber->cstk, 0).state;
+    vm_next();
+
+  vm_case(RAK_OP_NE_CONST_JUMP_IF_FALSE):
+    rak_vm_ne_const_jump_if_false(fiber, cl, ip, slots, err);
+    if (!rak_is_ok(err)) return;
+    ip = (uint32_t *) rak_stack_get(&fiber->cstk, 0).state;
+    vm_next();
+
+  vm_case(RAK_OP_NE_INT_JUMP_IF_FALSE):
+    rak_vm_ne_int_jump_if_false(fiber, cl, ip, slots, err);
+    if (!rak_is_ok(err)) return;
+    ip = (uint32_t *) rak_stack_get(&fiber->cstk, 0).state;
+    vm_next();
+
+  vm_case(RAK_OP_GT_LOCALS_JUMP_IF_FALSE):
+    rak_vm_gt_locals_jump_if_false(fiber, cl, ip, slots, err);
+    if (!rak_is_ok(err)) return;
+    ip = (uint32_t *) rak_stack_get(&fiber->cstk, 0).state;
+    vm_next();
+
+  vm_case(RAK_OP_GT_CONST_JUMP_IF_FALSE):
+    rak_vm_gt_const_jump_if_false(fiber, cl, ip, slots, err);
+    if (!rak_is_ok(err)) return;
+    ip = (uint32_t *) rak_stack_get(&fiber->cstk, 0).state;
+    vm_next();
+
+  vm_case(RAK_OP_GT_INT_JUMP_IF_FALSE):
+    rak_vm_gt_int_jump_if_false(fiber, cl, ip, slots, err);
+    if (!rak_is_ok(err)) return;
+    ip = (uint32_t *) rak_stack_get(&fiber->cstk, 0).state;
+    vm_next();
+
+  vm_case(RAK_OP_GE_LOCALS_JUMP_IF_FALSE):
+    rak_vm_ge_locals_jump_if_false(fiber, cl, ip, slots, err);
+    if (!rak_is_ok(err)) return;
+    ip = (uint32_t *) rak_stack_get(&fiber->cstk, 0).state;
+    vm_next();
+
+  vm_case(RAK_OP_GE_CONST_JUMP_IF_FALSE):
+    rak_vm_ge_const_jump_if_false(fiber, cl, ip, slots, err);
+    if (!rak_is_ok(err)) return;
+    ip = (uint32_t *) rak_stack_get(&fiber->cstk, 0).state;
+    vm_next();
+
+  vm_case(RAK_OP_GE_INT_JUMP_IF_FALSE):
+    rak_vm_ge_int_jump_if_false(fiber, cl, ip, slots, err);
+    if (!rak_is_ok(err)) return;
+    ip = (uint32_t *) rak_stack_get(&fiber->cstk, 0).state;
+    vm_next();
+
+  vm_case(RAK_OP_LT_LOCALS_JUMP_IF_FALSE):
+    rak_vm_lt_locals_jump_if_false(fiber, cl, ip, slots, err);
+    if (!rak_is_ok(err)) return;
+    ip = (uint32_t *) rak_stack_get(&fiber->cstk, 0).state;
+    vm_next();
+
+  vm_case(RAK_OP_LT_CONST_JUMP_IF_FALSE):
+    rak_vm_lt_const_jump_if_false(fiber, cl, ip, slots, err);
+    if (!rak_is_ok(err)) return;
+    ip = (uint32_t *) rak_stack_get(&fiber->cstk, 0).state;
+    vm_next();
+
+  vm_case(RAK_OP_LT_INT_JUMP_IF_FALSE):
+    rak_vm_lt_int_jump_if_false(fiber, cl, ip, slots, err);
+    if (!rak_is_ok(err)) return;
+    ip = (uint32_t *) rak_stack_get(&fiber->cstk, 0).state;
+    vm_next();
+
+  vm_case(RAK_OP_LE_LOCALS_JUMP_IF_FALSE):
+    rak_vm_le_locals_jump_if_false(fiber, cl, ip, slots, err);
+    if (!rak_is_ok(err)) return;
+    ip = (uint32_t *) rak_stack_get(&fiber->cstk, 0).state;
+    vm_next();
+
+  vm_case(RAK_OP_LE_CONST_JUMP_IF_FALSE):
+    rak_vm_le_const_jump_if_false(fiber, cl, ip, slots, err);
+    if (!rak_is_ok(err)) return;
+    ip = (uint32_t *) rak_stack_get(&fiber->cstk, 0).state;
+    vm_next();
+
+  vm_case(RAK_OP_LE_INT_JUMP_IF_FALSE):
+    rak_vm_le_int_jump_if_false(fiber, cl, ip, slots, err);
+    if (!rak_is_ok(err)) return;
+    ip = (uint32_t *) rak_stack_get(&fiber->cstk, 0).state;
+    vm_next();
+
+  vm_case(RAK_OP_ADD):
+    rak_vm_add(fiber, cl, ip, slots, err);
+    if (!rak_is_ok(err)) return;
+    ++ip;
+    vm_next();
+
+  vm_case(RAK_OP_ADD2):
+    rak_vm_add2(fiber, cl, ip, slots, err);
+    if (!rak_is_ok(err)) return;
+    ++ip;
+    vm_next();
+
+  vm_case(RAK_OP_ADD3):
+    rak_vm_add3(fiber, cl, ip, slots, err);
+    if (!rak_is_ok(err)) return;
+    ++ip;
+    vm_next();
+
+  vm_case(RAK_OP_SUB):
+    rak_vm_sub(fiber, cl, ip, slots, err);
+    if (!rak_is_ok(err)) return;
+    ++ip;
+    vm_next();
+
+  vm_case(RAK_OP_SUB2):
+    rak_vm_sub2(fiber, cl, ip, slots, err);
+    if (!rak_is_ok(err)) return;
+    ++ip;
+    vm_next();
+
+  vm_case(RAK_OP_SUB3):
+    rak_vm_sub3(fiber, cl, ip, slots, err);
+    if (!rak_is_ok(err)) return;
+    ++ip;
+    vm_next();
+
+  vm_case(RAK_OP_MUL):
+    rak_vm_mul(fiber, cl, ip, slots, err);
+    if (!rak_is_ok(err)) return;
+    ++ip;
+    vm_next();
+
+  vm_case(RAK_OP_MUL2):
+    rak_vm_mul2(fiber, cl, ip, slots, err);
+    if (!rak_is_ok(err)) return;
+    ++ip;
+    vm_next();
+
+  vm_case(RAK_OP_MUL3):
+    rak_vm_mul3(fiber, cl, ip, slots, err);
+    if (!rak_is_ok(err)) return;
+    ++ip;
+    vm_next();
+
+  vm_case(RAK_OP_DIV):
+    rak_vm_div(fiber, cl, ip, slots, err);
+    if (!rak_is_ok(err)) return;
+    ++ip;
+    vm_next();
+
+  vm_case(RAK_OP_DIV2):
+    rak_vm_div2(fiber, cl, ip, slots, err);
+    if (!rak_is_ok(err)) return;
+    ++ip;
+    vm_next();
+
+  vm_case(RAK_OP_DIV3):
+    rak_vm_div3(fiber, cl, ip, slots, err);
+    if (!rak_is_ok(err)) return;
+    ++ip;
+    vm_next();
+
+  vm_case(RAK_OP_MOD):
+    rak_vm_mod(fiber, cl, ip, slots, err);
+    if (!rak_is_ok(err)) return;
+    ++ip;
+    vm_next();
+
+  vm_case(RAK_OP_MOD2):
+    rak_vm_mod2(fiber, cl, ip, slots, err);
+    if (!rak_is_ok(err)) return;
+    ++ip;
+    vm_next();
+
+  vm_case(RAK_OP_MOD3):
+    rak_vm_mod3(fiber, cl, ip, slots, err);
+    if (!rak_is_ok(err)) return;
+    ++ip;
+    vm_next();
+
+  vm_case(RAK_OP_NOT):
+    rak_vm_not(fiber, cl, ip, slots, err);
+    ++ip;
+    vm_next();
+
+  vm_case(RAK_OP_NEG):
+    rak_vm_neg(fiber, cl, ip, slots, err);
+    if (!rak_is_ok(err)) return;
+    ++ip;
+    vm_next();
+
+  vm_case(RAK_OP_CALL):
+    rak_vm_call(fiber, cl, ip, slots, err);
+    if (!rak_is_ok(err)) return;
+    goto enter;
+
+  vm_case(RAK_OP_TAIL_CALL):
+    rak_vm_tail_call(fiber, cl, ip, slots, err);
+    if (!rak_is_ok(err)) return;
+    goto enter;
+
+  vm_case(RAK_OP_YIELD):
+    rak_vm_yield(fiber, cl, ip, slots, err);
+    return;
+
+  vm_case(RAK_OP_RETURN):
+    rak_vm_return(fiber, cl, ip, slots, err);
+    if (!rak_is_ok(err)) return;
+    if (rak_stack_is_empty(&fiber->cstk)) return;
+    goto enter;
+
+  vm_case(RAK_OP_RETURN_NIL):
+    rak_vm_return_nil(fiber, cl, ip, slots, err);
+    if (!rak_is_ok(err)) return;
+    if (rak_stack_is_empty(&fiber->cstk)) return;
+    goto enter;
+
+  vm_case(RAK_OP_EQ_NUM):
+    rak_vm_eq_num(fiber, cl, ip, slots, err);
+    ++ip;
+    vm_next();
+
+  vm_case(RAK_OP_NE_NUM):
+    rak_vm_ne_num(fiber, cl, ip, slots, err);
+    ++ip;
+    vm_next();
+
+  vm_case(RAK_OP_GT_NUM):
+    rak_vm_gt_num(fiber, cl, ip, slots, err);
+    if (!rak_is_ok(err)) return;
+    ++ip;
+    vm_next();
+
+  vm_case(RAK_OP_GE_NUM):
+    rak_vm_ge_num(fiber, cl, ip, slots, err);
+    if (!rak_is_ok(err)) return;
+    ++ip;
+    vm_next();
+
+  vm_case(RAK_OP_LT_NUM):
+    rak_vm_lt_num(fiber, cl, ip, slots, err);
+    if (!rak_is_ok(err)) return;
+    ++ip;
+    vm_next();
+
+  vm_case(RAK_OP_LE_NUM):
+    rak_vm_le_num(fiber, cl, ip, slots, err);
+    if (!rak_is_ok(err)) return;
+    ++ip;
+    vm_next();
+
+  vm_case(RAK_OP_ADD_NUM):
+    rak_vm_add_num(fiber, cl, ip, slots, err);
+    if (!rak_is_ok(err)) return;
+    ++ip;
+    vm_next();
+
+  vm_case(RAK_OP_ADD2_NUM):
+    rak_vm_add2_num(fiber, cl, ip, slots, err);
+    if (!rak_is_ok(err)) return;
+    ++ip;
+    vm_next();
+
+  vm_case(RAK_OP_ADD3_NUM):
+    rak_vm_add3_num(fiber, cl, ip, slots, err);
+    if (!rak_is_ok(err)) return;
+    ++ip;
+    vm_next();
+  }
+}
+
+#ifdef RAK_VM_COMPUTED_GOTO
+  #pragma GCC diagnostic pop
+#endif
+
+bool rak_vm_set_hook(RakVmHook _hook)
+{
+#ifdef RAK_VM_COMPUTED_GOTO
+  hook = _hook;
+  return true;
+#else
+  return !_hook;
+#endif
+}
+
+#else
 
 typedef void (*InstrHandler)(RakFiber *, RakClosure *, uint32_t *, RakValue *, RakError *);
 
@@ -55,6 +827,24 @@ static void do_gt(RakFiber *fiber, RakClosure *cl, uint32_t *ip, RakValue *slots
 static void do_ge(RakFiber *fiber, RakClosure *cl, uint32_t *ip, RakValue *slots, RakError *err);
 static void do_lt(RakFiber *fiber, RakClosure *cl, uint32_t *ip, RakValue *slots, RakError *err);
 static void do_le(RakFiber *fiber, RakClosure *cl, uint32_t *ip, RakValue *slots, RakError *err);
+static void do_eq_locals_jump_if_false(RakFiber *fiber, RakClosure *cl, uint32_t *ip, RakValue *slots, RakError *err);
+static void do_eq_const_jump_if_false(RakFiber *fiber, RakClosure *cl, uint32_t *ip, RakValue *slots, RakError *err);
+static void do_eq_int_jump_if_false(RakFiber *fiber, RakClosure *cl, uint32_t *ip, RakValue *slots, RakError *err);
+static void do_ne_locals_jump_if_false(RakFiber *fiber, RakClosure *cl, uint32_t *ip, RakValue *slots, RakError *err);
+static void do_ne_const_jump_if_false(RakFiber *fiber, RakClosure *cl, uint32_t *ip, RakValue *slots, RakError *err);
+static void do_ne_int_jump_if_false(RakFiber *fiber, RakClosure *cl, uint32_t *ip, RakValue *slots, RakError *err);
+static void do_gt_locals_jump_if_false(RakFiber *fiber, RakClosure *cl, uint32_t *ip, RakValue *slots, RakError *err);
+static void do_gt_const_jump_if_false(RakFiber *fiber, RakClosure *cl, uint32_t *ip, RakValue *slots, RakError *err);
+static void do_gt_int_jump_if_false(RakFiber *fiber, RakClosure *cl, uint32_t *ip, RakValue *slots, RakError *err);
+static void do_ge_locals_jump_if_false(RakFiber *fiber, RakClosure *cl, uint32_t *ip, RakValue *slots, RakError *err);
+static void do_ge_const_jump_if_false(RakFiber *fiber, RakClosure *cl, uint32_t *ip, RakValue *slots, RakError *err);
+static void do_ge_int_jump_if_false(RakFiber *fiber, RakClosure *cl, uint32_t *ip, RakValue *slots, RakError *err);
+static void do_lt_locals_jump_if_false(RakFiber *fiber, RakClosure *cl, uint32_t *ip, RakValue *slots, RakError *err);
+static void do_lt_const_jump_if_false(RakFiber *fiber, RakClosure *cl, uint32_t *ip, RakValue *slots, RakError *err);
+static void do_lt_int_jump_if_false(RakFiber *fiber, RakClosure *cl, uint32_t *ip, RakValue *slots, RakError *err);
+static void do_le_locals_jump_if_false(RakFiber *fiber, RakClosure *cl, uint32_t *ip, RakValue *slots, RakError *err);
+static void do_le_const_jump_if_false(RakFiber *fiber, RakClosure *cl, uint32_t *ip, RakValue *slots, RakError *err);
+static void do_le_int_jump_if_false(RakFiber *fiber, RakClosure *cl, uint32_t *ip, RakValue *slots, RakError *err);
 static void do_add(RakFiber *fiber, RakClosure *cl, uint32_t *ip, RakValue *slots, RakError *err);
 static void do_add2(RakFiber *fiber, RakClosure *cl, uint32_t *ip, RakValue *slots, RakError *err);
 static void do_add3(RakFiber *fiber, RakClosure *cl, uint32_t *ip, RakValue *slots, RakError *err);
@@ -77,77 +867,126 @@ static void do_tail_call(RakFiber *fiber, RakClosure *cl, uint32_t *ip, RakValue
 static void do_yield(RakFiber *fiber, RakClosure *cl, uint32_t *ip, RakValue *slots, RakError *err);
 static void do_return(RakFiber *fiber, RakClosure *cl, uint32_t *ip, RakValue *slots, RakError *err);
 static void do_return_nil(RakFiber *fiber, RakClosure *cl, uint32_t *ip, RakValue *slots, RakError *err);
+static void do_eq_num(RakFiber *fiber, RakClosure *cl, uint32_t *ip, RakValue *slots, RakError *err);
+static void do_ne_num(RakFiber *fiber, RakClosure *cl, uint32_t *ip, RakValue *slots, RakError *err);
+static void do_gt_num(RakFiber *fiber, RakClosure *cl, uint32_t *ip, RakValue *slots, RakError *err);
+static void do_ge_num(RakFiber *fiber, RakClosure *cl, uint32_t *ip, RakValue *slots, RakError *err);
+static void do_lt_num(RakFiber *fiber, RakClosure *cl, uint32_t *ip, RakValue *slots, RakError *err);
+static void do_le_num(RakFiber *fiber, RakClosure *cl, uint32_t *ip, RakValue *slots, RakError *err);
+static void do_add_num(RakFiber *fiber, RakClosure *cl, uint32_t *ip, RakValue *slots, RakError *err);
+static void do_add2_num(RakFiber *fiber, RakClosure *cl, uint32_t *ip, RakValue *slots, RakError *err);
+static void do_add3_num(RakFiber *fiber, RakClosure *cl, uint32_t *ip, RakValue *slots, RakError *err);
 
 static InstrHandler dispatchTable[] = {
-  [RAK_OP_NOP]                  = do_nop,
-  [RAK_OP_PUSH_NIL]             = do_push_nil,
-  [RAK_OP_PUSH_FALSE]           = do_push_false,
-  [RAK_OP_PUSH_TRUE]            = do_push_true,
-  [RAK_OP_PUSH_INT]             = do_push_int,
-  [RAK_OP_LOAD_CONST]           = do_load_const,
-  [RAK_OP_LOAD_GLOBAL]          = do_load_global,
-  [RAK_OP_LOAD_LOCAL]           = do_load_local,
-  [RAK_OP_STORE_LOCAL]          = do_store_local,
-  [RAK_OP_FETCH_LOCAL]          = do_fetch_local,
-  [RAK_OP_REF_LOCAL]            = do_ref_local,
-  [RAK_OP_LOAD_LOCAL_REF]       = do_load_local_ref,
-  [RAK_OP_STORE_LOCAL_REF]      = do_store_local_ref,
-  [RAK_OP_NEW_ARRAY]            = do_new_array,
-  [RAK_OP_NEW_RANGE]            = do_new_range,
-  [RAK_OP_NEW_RECORD]           = do_new_record,
-  [RAK_OP_NEW_CLOSURE]          = do_new_closure,
-  [RAK_OP_MOVE]                 = do_move,
-  [RAK_OP_POP]                  = do_pop,
-  [RAK_OP_GET_ELEMENT]          = do_get_element,
-  [RAK_OP_SET_ELEMENT]          = do_set_element,
-  [RAK_OP_LOAD_ELEMENT]         = do_load_element,
-  [RAK_OP_FETCH_ELEMENT]        = do_fetch_element,
-  [RAK_OP_UPDATE_ELEMENT]       = do_update_element,
-  [RAK_OP_GET_FIELD]            = do_get_field,
-  [RAK_OP_PUT_FIELD]            = do_put_field,
-  [RAK_OP_LOAD_FIELD]           = do_load_field,
-  [RAK_OP_FETCH_FIELD]          = do_fetch_field,
-  [RAK_OP_UPDATE_FIELD]         = do_update_field,
-  [RAK_OP_UNPACK_ELEMENTS]      = do_unpack_elements,
-  [RAK_OP_UNPACK_FIELDS]        = do_unpack_fields,
-  [RAK_OP_JUMP]                 = do_jump,
-  [RAK_OP_JUMP_IF_FALSE]        = do_jump_if_false,
-  [RAK_OP_JUMP_IF_FALSE_OR_POP] = do_jump_if_false_or_pop,
-  [RAK_OP_JUMP_IF_TRUE_OR_POP]  = do_jump_if_true_or_pop,
-  [RAK_OP_EQ]                   = do_eq,
-  [RAK_OP_NE]                   = do_ne,
-  [RAK_OP_GT]                   = do_gt,
-  [RAK_OP_GE]                   = do_ge,
-  [RAK_OP_LT]                   = do_lt,
-  [RAK_OP_LE]                   = do_le,
-  [RAK_OP_ADD]                  = do_add,
-  [RAK_OP_ADD2]                 = do_add2,
-  [RAK_OP_ADD3]                 = do_add3,
-  [RAK_OP_SUB]                  = do_sub,
-  [RAK_OP_SUB2]                 = do_sub2,
-  [RAK_OP_SUB3]                 = do_sub3,
-  [RAK_OP_MUL]                  = do_mul,
-  [RAK_OP_MUL2]                 = do_mul2,
-  [RAK_OP_MUL3]                 = do_mul3,
-  [RAK_OP_DIV]                  = do_div,
-  [RAK_OP_DIV2]                 = do_div2,
-  [RAK_OP_DIV3]                 = do_div3,
-  [RAK_OP_MOD]                  = do_mod,
-  [RAK_OP_MOD2]                 = do_mod2,
-  [RAK_OP_MOD3]                 = do_mod3,
-  [RAK_OP_NOT]                  = do_not,
-  [RAK_OP_NEG]                  = do_neg,
-  [RAK_OP_CALL]                 = do_call,
-  [RAK_OP_TAIL_CALL]            = do_tail_call,
-  [RAK_OP_YIELD]                = do_yield,
-  [RAK_OP_RETURN]               = do_return,
-  [RAK_OP_RETURN_NIL]           = do_return_nil
+  [RAK_OP_NOP]                    = do_nop,
+  [RAK_OP_PUSH_NIL]               = do_push_nil,
+  [RAK_OP_PUSH_FALSE]             = do_push_false,
+  [RAK_OP_PUSH_TRUE]              = do_push_true,
+  [RAK_OP_PUSH_INT]               = do_push_int,
+  [RAK_OP_LOAD_CONST]             = do_load_const,
+  [RAK_OP_LOAD_GLOBAL]            = do_load_global,
+  [RAK_OP_LOAD_LOCAL]             = do_load_local,
+  [RAK_OP_STORE_LOCAL]            = do_store_local,
+  [RAK_OP_FETCH_LOCAL]            = do_fetch_local,
+  [RAK_OP_REF_LOCAL]              = do_ref_local,
+  [RAK_OP_LOAD_LOCAL_REF]         = do_load_local_ref,
+  [RAK_OP_STORE_LOCAL_REF]        = do_store_local_ref,
+  [RAK_OP_NEW_ARRAY]              = do_new_array,
+  [RAK_OP_NEW_RANGE]              = do_new_range,
+  [RAK_OP_NEW_RECORD]             = do_new_record,
+  [RAK_OP_NEW_CLOSURE]            = do_new_closure,
+  [RAK_OP_MOVE]                   = do_move,
+  [RAK_OP_POP]                    = do_pop,
+  [RAK_OP_GET_ELEMENT]            = do_get_element,
+  [RAK_OP_SET_ELEMENT]            = do_set_element,
+  [RAK_OP_LOAD_ELEMENT]           = do_load_element,
+  [RAK_OP_FETCH_ELEMENT]          = do_fetch_element,
+  [RAK_OP_UPDATE_ELEMENT]         = do_update_element,
+  [RAK_OP_GET_FIELD]              = do_get_field,
+  [RAK_OP_PUT_FIELD]              = do_put_field,
+  [RAK_OP_LOAD_FIELD]             = do_load_field,
+  [RAK_OP_FETCH_FIELD]            = do_fetch_field,
+  [RAK_OP_UPDATE_FIELD]           = do_update_field,
+  [RAK_OP_UNPACK_ELEMENTS]        = do_unpack_elements,
+  [RAK_OP_UNPACK_FIELDS]          = do_unpack_fields,
+  [RAK_OP_JUMP]                   = do_jump,
+  [RAK_OP_JUMP_IF_FALSE]          = do_jump_if_false,
+  [RAK_OP_JUMP_IF_FALSE_OR_POP]   = do_jump_if_false_or_pop,
+  [RAK_OP_JUMP_IF_TRUE_OR_POP]    = do_jump_if_true_or_pop,
+  [RAK_OP_EQ]                     = do_eq,
+  [RAK_OP_NE]                     = do_ne,
+  [RAK_OP_GT]                     = do_gt,
+  [RAK_OP_GE]                     = do_ge,
+  [RAK_OP_LT]                     = do_lt,
+  [RAK_OP_LE]                     = do_le,
+  [RAK_OP_EQ_LOCALS_JUMP_IF_FALSE]= do_eq_locals_jump_if_false,
+  [RAK_OP_EQ_CONST_JUMP_IF_FALSE] = do_eq_const_jump_if_false,
+  [RAK_OP_EQ_INT_JUMP_IF_FALSE]   = do_eq_int_jump_if_false,
+  [RAK_OP_NE_LOCALS_JUMP_IF_FALSE]= do_ne_locals_jump_if_false,
+  [RAK_OP_NE_CONST_JUMP_IF_FALSE] = do_ne_const_jump_if_false,
+  [RAK_OP_NE_INT_JUMP_IF_FALSE]   = do_ne_int_jump_if_false,
+  [RAK_OP_GT_LOCALS_JUMP_IF_FALSE]= do_gt_locals_jump_if_false,
+  [RAK_OP_GT_CONST_JUMP_IF_FALSE] = do_gt_const_jump_if_false,
+  [RAK_OP_GT_INT_JUMP_IF_FALSE]   = do_gt_int_jump_if_false,
+  [RAK_OP_GE_LOCALS_JUMP_IF_FALSE]= do_ge_locals_jump_if_false,
+  [RAK_OP_GE_CONST_JUMP_IF_FALSE] = do_ge_const_jump_if_false,
+  [RAK_OP_GE_INT_JUMP_IF_FALSE]   = do_ge_int_jump_if_false,
+  [RAK_OP_LT_LOCALS_JUMP_IF_FALSE]= do_lt_locals_jump_if_false,
+  [RAK_OP_LT_CONST_JUMP_IF_FALSE] = do_lt_const_jump_if_false,
+  [RAK_OP_LT_INT_JUMP_IF_FALSE]   = do_lt_int_jump_if_false,
+  [RAK_OP_LE_LOCALS_JUMP_IF_FALSE]= do_le_locals_jump_if_false,
+  [RAK_OP_LE_CONST_JUMP_IF_FALSE] = do_le_const_jump_if_false,
+  [RAK_OP_LE_INT_JUMP_IF_FALSE]   = do_le_int_jump_if_false,
+  [RAK_OP_ADD]                    = do_add,
+  [RAK_OP_ADD2]                   = do_add2,
+  [RAK_OP_ADD3]                   = do_add3,
+  [RAK_OP_SUB]                    = do_sub,
+  [RAK_OP_SUB2]                   = do_sub2,
+  [RAK_OP_SUB3]                   = do_sub3,
+  [RAK_OP_MUL]                    = do_mul,
+  [RAK_OP_MUL2]                   = do_mul2,
+  [RAK_OP_MUL3]                   = do_mul3,
+  [RAK_OP_DIV]                    = do_div,
+  [RAK_OP_DIV2]                   = do_div2,
+  [RAK_OP_DIV3]                   = do_div3,
+  [RAK_OP_MOD]                    = do_mod,
+  [RAK_OP_MOD2]                   = do_mod2,
+  [RAK_OP_MOD3]                   = do_mod3,
+  [RAK_OP_NOT]                    = do_not,
+  [RAK_OP_NEG]                    = do_neg,
+  [RAK_OP_CALL]                   = do_call,
+  [RAK_OP_TAIL_CALL]              = do_tail_call,
+  [RAK_OP_YIELD]                  = do_yield,
+  [RAK_OP_RETURN]                 = do_return,
+  [RAK_OP_RETURN_NIL]             = do_return_nil,
+  [RAK_OP_EQ_NUM]                 = do_eq_num,
+  [RAK_OP_NE_NUM]                 = do_ne_num,
+  [RAK_OP_GT_NUM]                 = do_gt_num,
+  [RAK_OP_GE_NUM]                 = do_ge_num,
+  [RAK_OP_LT_NUM]                 = do_lt_num,
+  [RAK_OP_LE_NUM]                 = do_le_num,
+  [RAK_OP_ADD_NUM]                = do_add_num,
+  [RAK_OP_ADD2_NUM]               = do_add2_num,
+  [RAK_OP_ADD3_NUM]               = do_add3_num
 };
 
+static RakVmHook hook = NULL;
+static InstrHandler hookedTable[sizeof(dispatchTable) / sizeof(*dispatchTable)];
+
+static void do_hook(RakFiber *fiber, RakClosure *cl, uint32_t *ip, RakValue *slots, RakError *err)
+{
+  hook(fiber, cl, ip, err);
+  if (!rak_is_ok(err)) return;
+  hookedTable[rak_instr_opcode(*ip)](fiber, cl, ip, slots, err);
+}
+
 static inline void dispatch(RakFiber *fiber, RakClosure *cl, uint32_t *ip, RakValue *slots, RakError *err)
 {
   uint32_t instr = *ip;
   RakOpcode op = rak_instr_opcode(instr);
+#ifdef RAK_VM_STATS
+  count_op(op);
+#endif
   InstrHandler handler = dispatchTable[op];
   handler(fiber, cl, ip, slots, err);
 }
@@ -423,6 +1262,132 @@ static void do_le(RakFiber *fiber, RakClosure *cl, uint32_t *ip, RakValue *slots
   dispatch(fiber, cl, ip + 1, slots, err);
 }
 
+static void do_eq_locals_jump_if_false(RakFiber *fiber, RakClosure *cl, uint32_t *ip, RakValue *slots, RakError *err)
+{
+  rak_vm_eq_locals_jump_if_false(fiber, cl, ip, slots, err);
+  if (!rak_is_ok(err)) return;
+  dispatch(fiber, cl, (uint32_t *) rak_stack_get(&fiber->cstk, 0).state, slots, err);
+}
+
+static void do_eq_const_jump_if_false(RakFiber *fiber, RakClosure *cl, uint32_t *ip, RakValue *slots, RakError *err)
+{
+  rak_vm_eq_const_jump_if_false(fiber, cl, ip, slots, err);
+  if (!rak_is_ok(err)) return;
+  dispatch(fiber, cl, (uint32_t *) rak_stack_get(&fiber->cstk, 0).state, slots, err);
+}
+
+static void do_eq_int_jump_if_false(RakFiber *fiber, RakClosure *cl, uint32_t *ip, RakValue *slots, RakError *err)
+{
+  rak_vm_eq_int_jump_if_false(fiber, cl, ip, slots, err);
+  if (!rak_is_ok(err)) return;
+  dispatch(fiber, cl, (uint32_t *) rak_stack_get(&fiber->cstk, 0).state, slots, err);
+}
+
+static void do_ne_locals_jump_if_false(RakFiber *fiber, RakClosure *cl, uint32_t *ip, RakValue *slots, RakError *err)
+{
+  rak_vm_ne_locals_jump_if_false(fiber, cl, ip, slots, err);
+  if (!rak_is_ok(err)) return;
+  dispatch(fiber, cl, (uint32_t *) rak_stack_get(&fiber->cstk, 0).state, slots, err);
+}
+
+static void do_ne_const_jump_if_false(RakFiber *fiber, RakClosure *cl, uint32_t *ip, RakValue *slots, RakError *err)
+{
+  rak_vm_ne_const_jump_if_false(fiber, cl, ip, slots, err);
+  if (!rak_is_ok(err)) return;
+  dispatch(fiber, cl, (uint32_t *) rak_stack_get(&fiber->cstk, 0).state, slots, err);
+}
+
+static void do_ne_int_jump_if_false(RakFiber *fiber, RakClosure *cl, uint32_t *ip, RakValue *slots, RakError *err)
+{
+  rak_vm_ne_int_jump_if_false(fiber, cl, ip, slots, err);
+  if (!rak_is_ok(err)) return;
+  dispatch(fiber, cl, (uint32_t *) rak_stack_get(&fiber->cstk, 0).state, slots, err);
+}
+
+static void do_gt_locals_jump_if_false(RakFiber *fiber, RakClosure *cl, uint32_t *ip, RakValue *slots, RakError *err)
+{
+  rak_vm_gt_locals_jump_if_false(fiber, cl, ip, slots, err);
+  if (!rak_is_ok(err)) return;
+  dispatch(fiber, cl, (uint32_t *) rak_stack_get(&fiber->cstk, 0).state, slots, err);
+}
+
+static void do_gt_const_jump_if_false(RakFiber *fiber, RakClosure *cl, uint32_t *ip, RakValue *slots, RakError *err)
+{
+  rak_vm_gt_const_jump_if_false(fiber, cl, ip, slots, err);
+  if (!rak_is_ok(err)) return;
+  dispatch(fiber, cl, (uint32_t *) rak_stack_get(&fiber->cstk, 0).state, slots, err);
+}
+
+static void do_gt_int_jump_if_false(RakFiber *fiber, RakClosure *cl, uint32_t *ip, RakValue *slots, RakError *err)
+{
+  rak_vm_gt_int_jump_if_false(fiber, cl, ip, slots, err);
+  if (!rak_is_ok(err)) return;
+  dispatch(fiber, cl, (uint32_t *) rak_stack_get(&fiber->cstk, 0).state, slots, err);
+}
+
+static void do_ge_locals_jump_if_false(RakFiber *fiber, RakClosure *cl, uint32_t *ip, RakValue *slots, RakError *err)
+{
+  rak_vm_ge_locals_jump_if_false(fiber, cl, ip, slots, err);
+  if (!rak_is_ok(err)) return;
+  dispatch(fiber, cl, (uint32_t *) rak_stack_get(&fiber->cstk, 0).state, slots, err);
+}
+
+static void do_ge_const_jump_if_false(RakFiber *fiber, RakClosure *cl, uint32_t *ip, RakValue *slots, RakError *err)
+{
+  rak_vm_ge_const_jump_if_false(fiber, cl, ip, slots, err);
+  if (!rak_is_ok(err)) return;
+  dispatch(fiber, cl, (uint32_t *) rak_stack_get(&fiber->cstk, 0).state, slots, err);
+}
+
+static void do_ge_int_jump_if_false(RakFiber *fiber, RakClosure *cl, uint32_t *ip, RakValue *slots, RakError *err)
+{
+  rak_vm_ge_int_jump_if_false(fiber, cl, ip, slots, err);
+  if (!rak_is_ok(err)) return;
+  dispatch(fiber, cl, (uint32_t *) rak_stack_get(&fiber->cstk, 0).state, slots, err);
+}
+
+static void do_lt_locals_jump_if_false(RakFiber *fiber, RakClosure *cl, uint32_t *ip, RakValue *slots, RakError *err)
+{
+  rak_vm_lt_locals_jump_if_false(fiber, cl, ip, slots, err);
+  if (!rak_is_ok(err)) return;
+  dispatch(fiber, cl, (uint32_t *) rak_stack_get(&fiber->cstk, 0).state, slots, err);
+}
+
+static void do_lt_const_jump_if_false(RakFiber *fiber, RakClosure *cl, uint32_t *ip, RakValue *slots, RakError *err)
+{
+  rak_vm_lt_const_jump_if_false(fiber, cl, ip, slots, err);
+  if (!rak_is_ok(err)) return;
+  dispatch(fiber, cl, (uint32_t *) rak_stack_get(&fiber->cstk, 0).state, slots, err);
+}
+
+static void do_lt_int_jump_if_false(RakFiber *fiber, RakClosure *cl, uint32_t *ip, RakValue *slots, RakError *err)
+{
+  rak_vm_lt_int_jump_if_false(fiber, cl, ip, slots, err);
+  if (!rak_is_ok(err)) return;
+  dispatch(fiber, cl, (uint32_t *) rak_stack_get(&fiber->cstk, 0).state, slots, err);
+}
+
+static void do_le_locals_jump_if_false(RakFiber *fiber, RakClosure *cl, uint32_t *ip, RakValue *slots, RakError *err)
+{
+  rak_vm_le_locals_jump_if_false(fiber, cl, ip, slots, err);
+  if (!rak_is_ok(err)) return;
+  dispatch(fiber, cl, (uint32_t *) rak_stack_get(&fiber->cstk, 0).state, slots, err);
+}
+
+static void do_le_const_jump_if_false(RakFiber *fiber, RakClosure *cl, uint32_t *ip, RakValue *slots, RakError *err)
+{
+  rak_vm_le_const_jump_if_false(fiber, cl, ip, slots, err);
+  if (!rak_is_ok(err)) return;
+  dispatch(fiber, cl, (uint32_t *) rak_stack_get(&fiber->cstk, 0).state, slots, err);
+}
+
+static void do_le_int_jump_if_false(RakFiber *fiber, RakClosure *cl, uint32_t *ip, RakValue *slots, RakError *err)
+{
+  rak_vm_le_int_jump_if_false(fiber, cl, ip, slots, err);
+  if (!rak_is_ok(err)) return;
+  dispatch(fiber, cl, (uint32_t *) rak_stack_get(&fiber->cstk, 0).state, slots, err);
+}
+
 static void do_add(RakFiber *fiber, RakClosure *cl, uint32_t *ip, RakValue *slots, RakError *err)
 {
   rak_vm_add(fiber, cl, ip, slots, err);
@@ -566,7 +1531,84 @@ static void do_return_nil(RakFiber *fiber, RakClosure *cl, uint32_t *ip, RakValu
   rak_vm_return_nil(fiber, cl, ip, slots, err);
 }
 
+static void do_eq_num(RakFiber *fiber, RakClosure *cl, uint32_t *ip, RakValue *slots, RakError *err)
+{
+  rak_vm_eq_num(fiber, cl, ip, slots, err);
+  dispatch(fiber, cl, ip + 1, slots, err);
+}
+
+static void do_ne_num(RakFiber *fiber, RakClosure *cl, uint32_t *ip, RakValue *slots, RakError *err)
+{
+  rak_vm_ne_num(fiber, cl, ip, slots, err);
+  dispatch(fiber, cl, ip + 1, slots, err);
+}
+
+static void do_gt_num(RakFiber *fiber, RakClosure *cl, uint32_t *ip, RakValue *slots, RakError *err)
+{
+  rak_vm_gt_num(fiber, cl, ip, slots, err);
+  if (!rak_is_ok(err)) return;
+  dispatch(fiber, cl, ip + 1, slots, err);
+}
+
+static void do_ge_num(RakFiber *fiber, RakClosure *cl, uint32_t *ip, RakValue *slots, RakError *err)
+{
+  rak_vm_ge_num(fiber, cl, ip, slots, err);
+  if (!rak_is_ok(err)) return;
+  dispatch(fiber, cl, ip + 1, slots, err);
+}
+
+static void do_lt_num(RakFiber *fiber, RakClosure *cl, uint32_t *ip, RakValue *slots, RakError *err)
+{
+  rak_vm_lt_num(fiber, cl, ip, slots, err);
+  if (!rak_is_ok(err)) return;
+  dispatch(fiber, cl, ip + 1, slots, err);
+}
+
+static void do_le_num(RakFiber *fiber, RakClosure *cl, uint32_t *ip, RakValue *slots, RakError *err)
+{
+  rak_vm_le_num(fiber, cl, ip, slots, err);
+  if (!rak_is_ok(err)) return;
+  dispatch(fiber, cl, ip + 1, slots, err);
+}
+
+static void do_add_num(RakFiber *fiber, RakClosure *cl, uint32_t *ip, RakValue *slots, RakError *err)
+{
+  rak_vm_add_num(fiber, cl, ip, slots, err);
+  if (!rak_is_ok(err)) return;
+  dispatch(fiber, cl, ip + 1, slots, err);
+}
+
+static void do_add2_num(RakFiber *fiber, RakClosure *cl, uint32_t *ip, RakValue *slots, RakError *err)
+{
+  rak_vm_add2_num(fiber, cl, ip, slots, err);
+  if (!rak_is_ok(err)) return;
+  dispatch(fiber, cl, ip + 1, slots, err);
+}
+
+static void do_add3_num(RakFiber *fiber, RakClosure *cl, uint32_t *ip, RakValue *slots, RakError *err)
+{
+  rak_vm_add3_num(fiber, cl, ip, slots, err);
+  if (!rak_is_ok(err)) return;
+  dispatch(fiber, cl, ip + 1, slots, err);
+}
+
 void rak_vm_dispatch(RakFiber *fiber, RakClosure *cl, uint32_t *ip, RakValue *slots, RakError *err)
 {
+#ifdef RAK_JIT
+  if (rak_jit_dispatch(fiber, cl, ip, slots, err)) return;
+#endif
   dispatch(fiber, cl, ip, slots, err);
 }
+
+bool rak_vm_set_hook(RakVmHook _hook)
+{
+  int len = (int) (sizeof(dispatchTable) / sizeof(*dispatchTable));
+  if (!hook)
+    memcpy(hookedTable, dispatchTable, sizeof(dispatchTable));
+  hook = _hook;
+  for (int i = 0; i < len; ++i)
+    dispatchTable[i] = hook ? do_hook : hookedTable[i];
+  return true;
+}
+
+#endif
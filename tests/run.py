@@ -17,6 +17,7 @@ except ImportError:
     )
 
 executable_path = None
+executable_args = []
 
 
 def run_one_test(test_case: dict) -> dict:
@@ -39,7 +40,7 @@ def run_one_test(test_case: dict) -> dict:
 
     try:
         process = subprocess.Popen(
-            [executable_path] + command_args.split(),
+            [executable_path] + executable_args + command_args.split(),
             stdin=subprocess.PIPE,
             stdout=subprocess.PIPE,
             stderr=subprocess.PIPE,
@@ -120,6 +121,7 @@ def run_test_file(test_file: str) -> list[tuple[bool, str, str]]:
 
 def main():
     global executable_path
+    global executable_args
 
     parser = argparse.ArgumentParser(description="Integration test runner -- rak")
     parser.add_argument(
@@ -128,9 +130,16 @@ def main():
     parser.add_argument(
         "-e", "--executable", required=True, help="Path to executable to test"
     )
+    parser.add_argument(
+        "-a",
+        "--args",
+        default="",
+        help="Extra arguments passed to every run, e.g. --args=--jit",
+    )
     parser.add_argument("filter", nargs="?", default=None, help="Testfiles filter")
     args = parser.parse_args()
     executable_path = args.executable
+    executable_args = args.args.split()
 
     if not os.path.isfile(executable_path):
         sys.stderr.write(